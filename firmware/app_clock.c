@@ -0,0 +1,142 @@
+#include "app_clock.h"
+#include "on_off_switch.h"
+
+#include <ti/drivers/dpl/ClockP.h>
+#include "tlog.h"
+
+/* ZCL time is seconds since 2000-01-01; both are captured at the same sync */
+static zb_bool_t clock_valid = ZB_FALSE;
+static zb_uint32_t clock_utc_s;
+static zb_uint32_t clock_local_s;
+static zb_uint32_t clock_sync_ms;
+
+/* Tick count at the last app_uptime_s() and the wraps seen before it */
+static zb_uint32_t uptime_ticks;
+static zb_uint32_t uptime_wraps;
+
+zb_uint32_t app_time_ms(void)
+{
+    /* Wraps modulo 2^32 ms; callers only look at differences */
+    return ClockP_getSystemTicks() * (ClockP_getSystemTickPeriod() / 1000U);
+}
+
+zb_uint32_t app_uptime_s(void)
+{
+    zb_uint32_t ticks = ClockP_getSystemTicks();
+
+    if (ticks < uptime_ticks)
+    {
+        uptime_wraps++;
+    }
+    uptime_ticks = ticks;
+    return (zb_uint32_t)(((((uint64_t)uptime_wraps) << 32) | ticks) *
+                         ClockP_getSystemTickPeriod() / 1000000U);
+}
+
+void app_uptime_tick(zb_uint8_t param)
+{
+    ZVUNUSED(param);
+    (void)app_uptime_s();
+    ZB_SCHEDULE_APP_ALARM(app_uptime_tick, 0, APP_UPTIME_TICK_S * ZB_TIME_ONE_SECOND);
+}
+
+void app_clock_sync(zb_uint8_t param)
+{
+    zb_uint8_t *cmd_ptr;
+
+    if (!param)
+    {
+        zb_buf_get_out_delayed(app_clock_sync);
+        return;
+    }
+
+    ZB_ZCL_GENERAL_INIT_READ_ATTR_REQ(param, cmd_ptr, ZB_ZCL_ENABLE_DEFAULT_RESPONSE);
+    ZB_ZCL_GENERAL_ADD_ID_READ_ATTR_REQ(cmd_ptr, ZB_ZCL_ATTR_TIME_TIME_ID);
+    ZB_ZCL_GENERAL_ADD_ID_READ_ATTR_REQ(cmd_ptr, ZB_ZCL_ATTR_TIME_LOCAL_TIME_ID);
+    ZB_ZCL_GENERAL_SEND_READ_ATTR_REQ(param, cmd_ptr, APP_CLOCK_SERVER_ADDR,
+        ZB_APS_ADDR_MODE_16_ENDP_PRESENT, APP_CLOCK_SERVER_EP, ZB_SWITCH_ENDPOINT,
+        ZB_AF_HA_PROFILE_ID, ZB_ZCL_CLUSTER_ID_TIME, NULL);
+
+    /* Retry soon until the first answer, then drift-correct occasionally */
+    ZB_SCHEDULE_APP_ALARM_CANCEL(app_clock_sync, ZB_ALARM_ANY_PARAM);
+    ZB_SCHEDULE_APP_ALARM(app_clock_sync, 0,
+        (clock_valid ? APP_CLOCK_RESYNC_S : APP_CLOCK_RETRY_S) * ZB_TIME_ONE_SECOND);
+}
+
+zb_bool_t app_clock_handle_read_resp(zb_uint8_t param)
+{
+    zb_zcl_parsed_hdr_t *cmd_info = ZB_BUF_GET_PARAM(param, zb_zcl_parsed_hdr_t);
+    zb_zcl_read_attr_res_t *res;
+    zb_uint32_t utc = 0;
+    zb_uint32_t local = 0;
+    zb_uint8_t found = 0;
+
+    if (cmd_info->cluster_id != ZB_ZCL_CLUSTER_ID_TIME ||
+        cmd_info->cmd_direction != ZB_ZCL_FRAME_DIRECTION_TO_CLI ||
+        cmd_info->cmd_id != ZB_ZCL_CMD_READ_ATTRIB_RESP)
+    {
+        return ZB_FALSE;
+    }
+
+    ZB_ZCL_GENERAL_GET_NEXT_READ_ATTR_RES(param, res);
+    while (res != NULL)
+    {
+        if (res->status == ZB_ZCL_STATUS_SUCCESS)
+        {
+            zb_uint32_t v;
+            ZB_LETOH32(&v, res->attr_value);
+            if (res->attr_id == ZB_ZCL_ATTR_TIME_TIME_ID)
+            {
+                utc = v;
+                found |= 1;
+            }
+            else if (res->attr_id == ZB_ZCL_ATTR_TIME_LOCAL_TIME_ID)
+            {
+                local = v;
+                found |= 2;
+            }
+        }
+        ZB_ZCL_GENERAL_GET_NEXT_READ_ATTR_RES(param, res);
+    }
+
+    if (found & 1)
+    {
+        clock_utc_s = utc;
+        /* Servers without a time zone may not serve LocalTime */
+        clock_local_s = (found & 2) ? local : utc;
+        clock_sync_ms = app_time_ms();
+        if (!clock_valid)
+        {
+            clock_valid = ZB_TRUE;
+            ZB_SCHEDULE_APP_ALARM_CANCEL(app_clock_sync, ZB_ALARM_ANY_PARAM);
+            ZB_SCHEDULE_APP_ALARM(app_clock_sync, 0, APP_CLOCK_RESYNC_S * ZB_TIME_ONE_SECOND);
+        }
+        TLOG_INFO("clock synced: utc=%u local=%u", clock_utc_s, clock_local_s);
+    }
+
+    zb_buf_free(param);
+    return ZB_TRUE;
+}
+
+static zb_uint32_t app_clock_elapsed_s(void)
+{
+    return (app_time_ms() - clock_sync_ms) / 1000U;
+}
+
+zb_bool_t app_clock_utc(zb_uint32_t *utc_s)
+{
+    if (clock_valid)
+    {
+        *utc_s = clock_utc_s + app_clock_elapsed_s();
+    }
+    return clock_valid;
+}
+
+zb_bool_t app_clock_local(zb_uint32_t *local_s)
+{
+    if (clock_valid)
+    {
+        *local_s = clock_local_s + app_clock_elapsed_s();
+    }
+    return clock_valid;
+}
@@ -0,0 +1,26 @@
+#ifndef APP_CLOCK_H
+#define APP_CLOCK_H
+
+#include "zboss_api.h"
+
+/* Time cluster server to sync from: the coordinator's first endpoint */
+#define APP_CLOCK_SERVER_ADDR       0x0000
+#define APP_CLOCK_SERVER_EP         1
+#define APP_CLOCK_RESYNC_S          (6U * 3600U)
+#define APP_CLOCK_RETRY_S           60U
+/* app_uptime_tick() period, well inside the 2^32 ms tick wrap */
+#define APP_UPTIME_TICK_S           (24U * 3600U)
+
+zb_uint32_t app_time_ms(void);
+/*
+ * Seconds since boot, carried past the tick counter's wrap. ZBOSS thread
+ * only; app_uptime_tick() keeps it sampled at least once per wrap.
+ */
+zb_uint32_t app_uptime_s(void);
+void app_uptime_tick(zb_uint8_t param);
+void app_clock_sync(zb_uint8_t param);
+zb_bool_t app_clock_handle_read_resp(zb_uint8_t param);
+zb_bool_t app_clock_utc(zb_uint32_t *utc_s);
+zb_bool_t app_clock_local(zb_uint32_t *local_s);
+
+#endif /* APP_CLOCK_H */
@@ -0,0 +1,138 @@
+#include "automation.h"
+#include "app_clock.h"
+#include "on_off_switch.h"
+
+#include "tlog.h"
+
+#include <string.h>
+
+#define AUTOMATION_VERSION          2
+
+/* Persisted as ZB_NVRAM_APP_DATA3; bump AUTOMATION_VERSION on layout changes */
+typedef struct {
+    zb_uint8_t version;
+    zb_uint8_t len;
+    zb_uint8_t data[RULES_BYTES];
+} automation_store_t;
+
+zb_uint8_t attr_rules[1 + RULES_BYTES];
+
+static automation_store_t store;
+static rules_t rules;
+
+static void automation_apply(void)
+{
+    rules_load(&rules, store.data, store.len, app_time_ms());
+    attr_rules[0] = store.len;
+    memcpy(&attr_rules[1], store.data, store.len);
+}
+
+static void automation_nvram_read(zb_uint8_t page, zb_uint32_t pos, zb_uint16_t payload_length)
+{
+    if (payload_length != sizeof(store) ||
+        zb_nvram_read_data(page, pos, (zb_uint8_t *)&store, sizeof(store)) != RET_OK ||
+        store.version != AUTOMATION_VERSION || !rules_check(store.data, store.len))
+    {
+        memset(&store, 0, sizeof(store));
+        store.version = AUTOMATION_VERSION;
+    }
+    automation_apply();
+}
+
+static zb_ret_t automation_nvram_write(zb_uint8_t page, zb_uint32_t pos)
+{
+    return zb_nvram_write_data(page, pos, (zb_uint8_t *)&store, sizeof(store));
+}
+
+static zb_uint16_t automation_nvram_size(void)
+{
+    return sizeof(store);
+}
+
+void automation_init(void)
+{
+    rules_init(&rules);
+    store.version = AUTOMATION_VERSION;
+    zb_nvram_register_app3_read_cb(automation_nvram_read);
+    zb_nvram_register_app3_write_cb(automation_nvram_write, automation_nvram_size);
+}
+
+zb_bool_t automation_active(void)
+{
+    return rules.count > 0 ? ZB_TRUE : ZB_FALSE;
+}
+
+zb_bool_t automation_check(const zb_uint8_t *zcl_str)
+{
+    return rules_check(&zcl_str[1], zcl_str[0]) ? ZB_TRUE : ZB_FALSE;
+}
+
+void automation_set(const zb_uint8_t *zcl_str)
+{
+    store.len = zcl_str[0];
+    memcpy(store.data, &zcl_str[1], store.len);
+    automation_apply();
+    zb_nvram_write_dataset(ZB_NVRAM_APP_DATA3);
+    TLOG_INFO("automation: %d rules", rules.count);
+}
+
+/* Sends a Level or Scene rule's command; param arrives from zb_buf_get_out_delayed_ext() */
+static void automation_send(zb_uint8_t param, zb_uint16_t index)
+{
+    zb_uint16_t addr = 0;
+    const rule_t *rule = index < rules.count ? &rules.rules[index] : NULL;
+
+    if (rule == NULL || !ZB_JOINED())
+    {
+        zb_buf_free(param);
+        return;
+    }
+
+    if (rule->action == RULES_ACT_LEVEL)
+    {
+        ZB_ZCL_LEVEL_CONTROL_SEND_MOVE_TO_LEVEL_WITH_ON_OFF_REQ(param, addr,
+            ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT, 0, ZB_SWITCH_ENDPOINT, ZB_AF_HA_PROFILE_ID,
+            ZB_ZCL_DISABLE_DEFAULT_RESPONSE, NULL, rule->arg, rule->arg2);
+    }
+    else if (rule->arg2 != 0)
+    {
+        /* Scenes usually live on a group: send to it rather than to the bound lights */
+        addr = rule->arg2;
+        ZB_ZCL_SCENES_SEND_RECALL_SCENE_REQ(param, addr, ZB_APS_ADDR_MODE_16_GROUP_ENDP_NOT_PRESENT,
+            0, ZB_SWITCH_ENDPOINT, ZB_AF_HA_PROFILE_ID, ZB_ZCL_DISABLE_DEFAULT_RESPONSE, NULL,
+            rule->arg2, rule->arg);
+    }
+    else
+    {
+        ZB_ZCL_SCENES_SEND_RECALL_SCENE_REQ(param, addr, ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT,
+            0, ZB_SWITCH_ENDPOINT, ZB_AF_HA_PROFILE_ID, ZB_ZCL_DISABLE_DEFAULT_RESPONSE, NULL,
+            0, rule->arg);
+    }
+}
+
+static void automation_fire(zb_uint8_t index, const rule_t *rule, void *ctx)
+{
+    ZVUNUSED(ctx);
+
+    TLOG_INFO("rule %d fired, action %d", index, rule->action);
+    if (rule->action == RULES_ACT_LEVEL || rule->action == RULES_ACT_SCENE)
+    {
+        zb_buf_get_out_delayed_ext(automation_send, index, 0);
+    }
+}
+
+zb_uint8_t automation_update(zb_uint8_t occupied)
+{
+    zb_uint32_t now_ms = app_time_ms();
+    zb_uint16_t minute = RULES_MINUTE_UNKNOWN;
+    zb_uint32_t local_s;
+
+    if (app_clock_local(&local_s))
+    {
+        minute = (zb_uint16_t)((local_s % 86400U) / 60U);
+    }
+
+    rules_edge(&rules, occupied, now_ms);
+    rules_run(&rules, now_ms, minute, automation_fire, NULL);
+    return rules.light;
+}
@@ -0,0 +1,37 @@
+#ifndef AUTOMATION_H
+#define AUTOMATION_H
+
+#include "zboss_api.h"
+#include "rules.h"
+
+/*
+ * Runs the rule table (rules.h) on the device:
+ * - keeps the table in the ZB_NVRAM_APP_DATA3 dataset
+ * - mirrors it in the rules attribute
+ * - sends the Level and Scene commands that rules emit
+ * On and Off go through the regular light driving in on_off_switch.c, which
+ * retries and respects manual switching. automation_update() tells it what
+ * state to aim for.
+ *
+ * With an empty table the sensor keeps its built-in behaviour.
+ */
+
+/* ZCL octet string: length byte + wire-format table */
+extern zb_uint8_t attr_rules[1 + RULES_BYTES];
+
+/* Registers the NVRAM dataset; call before zboss_start_no_autostart() */
+void automation_init(void);
+zb_bool_t automation_active(void);
+
+zb_bool_t automation_check(const zb_uint8_t *zcl_str);
+/* Replaces the table, persists it and arms it for the current occupancy */
+void automation_set(const zb_uint8_t *zcl_str);
+
+/*
+ * Feeds an occupancy update and fires the rules that are due. Returns the
+ * RULES_LIGHT_* state the lights should be driven to; RULES_LIGHT_UNKNOWN
+ * leaves them alone.
+ */
+zb_uint8_t automation_update(zb_uint8_t occupied);
+
+#endif /* AUTOMATION_H */
@@ -0,0 +1,54 @@
+#include "backoff.h"
+
+void backoff_rng_seed(backoff_rng_t *rng, const uint8_t ieee_addr[8])
+{
+    uint32_t hash = 2166136261U;
+    uint8_t i;
+
+    /* FNV-1a spreads addresses that differ only in the last bytes */
+    for (i = 0; i < 8; i++)
+    {
+        hash ^= ieee_addr[i];
+        hash *= 16777619U;
+    }
+    rng->state = hash ? hash : 1U;
+}
+
+uint32_t backoff_jitter_ms(backoff_rng_t *rng, uint32_t max_ms)
+{
+    uint32_t x = rng->state;
+
+    /* xorshift32 */
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rng->state = x;
+
+    return max_ms ? x % max_ms : 0;
+}
+
+uint32_t backoff_next_ms(backoff_t *backoff, backoff_rng_t *rng)
+{
+    uint32_t window = backoff->base_ms;
+    uint8_t i;
+
+    for (i = 0; i < backoff->attempts && window < backoff->cap_ms; i++)
+    {
+        window <<= 1;
+    }
+    if (window > backoff->cap_ms)
+    {
+        window = backoff->cap_ms;
+    }
+    if (backoff->attempts < UINT8_MAX)
+    {
+        backoff->attempts++;
+    }
+
+    return window / 2U + backoff_jitter_ms(rng, window / 2U + 1U);
+}
+
+void backoff_reset(backoff_t *backoff)
+{
+    backoff->attempts = 0;
+}
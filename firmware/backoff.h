@@ -0,0 +1,35 @@
+#ifndef BACKOFF_H
+#define BACKOFF_H
+
+#include <stdint.h>
+
+/*
+ * Per-device random offsets for network activity. Seeded from the IEEE
+ * address, so sensors that power up together spread out the same way on
+ * every boot without needing an entropy source before the radio is up.
+ */
+typedef struct {
+    uint32_t state;
+} backoff_rng_t;
+
+void backoff_rng_seed(backoff_rng_t *rng, const uint8_t ieee_addr[8]);
+/* Uniform in 0 .. max_ms-1; 0 when max_ms is 0 */
+uint32_t backoff_jitter_ms(backoff_rng_t *rng, uint32_t max_ms);
+
+/*
+ * Capped exponential backoff with jitter for retry loops. The n-th
+ * consecutive retry waits between half and all of min(cap, base * 2^n),
+ * so a fleet that failed together drifts apart instead of retrying in sync.
+ */
+typedef struct {
+    uint32_t base_ms;
+    uint32_t cap_ms;
+    uint8_t attempts;           /* Consecutive failures since the last reset */
+} backoff_t;
+
+#define BACKOFF_INIT(base_ms, cap_ms) { (base_ms), (cap_ms), 0 }
+
+uint32_t backoff_next_ms(backoff_t *backoff, backoff_rng_t *rng);
+void backoff_reset(backoff_t *backoff);
+
+#endif /* BACKOFF_H */
@@ -0,0 +1,206 @@
+#include "ble_adv.h"
+
+#ifdef BLE_ADV_ENABLE
+
+#include "dmm_policy.h"
+#include "tlog.h"
+
+#include <ti/drivers/dpl/HwiP.h>
+#include <ti/drivers/rcl/RCL.h>
+#include <ti/drivers/rcl/commands/ble5.h>
+#include <ti/devices/DeviceFamily.h>
+#include DeviceFamily_constructPath(inc/hw_types.h)
+#include DeviceFamily_constructPath(inc/hw_memmap.h)
+#include DeviceFamily_constructPath(inc/hw_systim.h)
+#include <rcl_stub_dmm.h>
+#include "ti_radio_config.h"
+
+#include <string.h>
+
+/* Bluetooth SIG test company ID; products must use their assigned ID */
+#define BLE_ADV_COMPANY_ID          0xFFFFU
+#define BLE_ADV_FORMAT              1
+
+#define BLE_ADV_NONCONN_IND         0x02
+#define BLE_ADV_TXADD_RANDOM        0x40
+#define BLE_ADV_ADDR_LEN            6
+#define BLE_ADV_DATA_LEN            10
+#define BLE_ADV_PDU_LEN             (BLE_ADV_ADDR_LEN + BLE_ADV_DATA_LEN)
+#define BLE_ADV_NUM_PAD             1
+#define BLE_ADV_HDR_LEN             2
+
+static RCL_Client client;
+static RCL_Handle handle;
+static RCL_CmdBle5Advertiser adv_cmd;
+static RCL_CtxAdvertiser adv_ctx;
+static uint32_t adv_buf[RCL_TxBuffer_len_u32(BLE_ADV_NUM_PAD, BLE_ADV_HDR_LEN, BLE_ADV_PDU_LEN)];
+static zb_uint8_t adv_addr[BLE_ADV_ADDR_LEN];
+
+/* Shared with the RCL callback and the MAC: access with interrupts disabled */
+static dmm_policy_t policy;
+/* Last Zigbee transmission, polled for its end */
+static RCL_CmdIeee_TxAction *zb_tx;
+
+static uint32_t ble_adv_now(void)
+{
+    return HWREG(SYSTIM_BASE + SYSTIM_O_TIME1U);
+}
+
+static zb_bool_t ble_adv_cmd_busy(void)
+{
+    return adv_cmd.common.status != RCL_CommandStatus_Idle &&
+           adv_cmd.common.status < RCL_CommandStatus_Finished ? ZB_TRUE : ZB_FALSE;
+}
+
+static void ble_adv_pdu(void)
+{
+    RCL_Buffer_TxBuffer *buf = (RCL_Buffer_TxBuffer *)adv_buf;
+    zb_uint8_t *p = RCL_TxBuffer_init(buf, BLE_ADV_NUM_PAD, BLE_ADV_HDR_LEN, BLE_ADV_PDU_LEN);
+
+    *p++ = BLE_ADV_NONCONN_IND | BLE_ADV_TXADD_RANDOM;
+    *p++ = BLE_ADV_PDU_LEN;
+    memcpy(p, adv_addr, BLE_ADV_ADDR_LEN);
+    p += BLE_ADV_ADDR_LEN;
+
+    *p++ = 0x02;
+    *p++ = 0x01;                        /* Flags */
+    *p++ = 0x04;
+    *p++ = 0x06;
+    *p++ = 0xFF;                        /* Manufacturer specific data */
+    *p++ = (zb_uint8_t)(BLE_ADV_COMPANY_ID & 0xFF);
+    *p++ = (zb_uint8_t)(BLE_ADV_COMPANY_ID >> 8);
+    *p++ = BLE_ADV_FORMAT;
+    *p++ = policy.occupied;
+    *p = policy.seq;
+
+    List_clearAll(&adv_ctx.txBuffers);
+    RCL_TxBuffer_put(&adv_ctx.txBuffers, buf);
+}
+
+/* Interrupts disabled */
+static void ble_adv_stop(void)
+{
+    RCL_Command_stop((RCL_Command_Handle)&adv_cmd, RCL_StopType_Hard);
+    dmm_policy_ble_done(&policy, 0, ble_adv_now());
+}
+
+static void ble_adv_rcl_cb(RCL_Command *cmd, LRF_Events lrfEvents, RCL_Events rclEvents)
+{
+    uintptr_t key;
+
+    ZVUNUSED(cmd);
+    ZVUNUSED(lrfEvents);
+
+    if (rclEvents.lastCmdDone)
+    {
+        key = HwiP_disable();
+        /* Not on air any more when ble_adv_stop() already reported it */
+        if (policy.ble_on_air)
+        {
+            dmm_policy_ble_done(&policy, adv_cmd.common.status == RCL_CommandStatus_Finished,
+                                ble_adv_now());
+        }
+        HwiP_restore(key);
+    }
+}
+
+/* Runs on ZBOSS alarms: starts the advertising events the policy grants */
+static void ble_adv_service(zb_uint8_t param)
+{
+    uint32_t wait_us;
+    uintptr_t key;
+
+    ZVUNUSED(param);
+
+    key = HwiP_disable();
+    /* Noticed late rather than at its end: that only lengthens the guard */
+    if (policy.zigbee_busy && zb_tx != NULL && zb_tx->txStatus >= RCL_CommandStatus_Finished)
+    {
+        dmm_policy_zigbee(&policy, 0, ble_adv_now());
+    }
+    wait_us = ble_adv_cmd_busy() ? DMM_BLE_EVENT_US : dmm_policy_ble_request(&policy, ble_adv_now());
+    if (wait_us == 0)
+    {
+        ble_adv_pdu();
+        if (RCL_Command_submit(handle, (RCL_Command_Handle)&adv_cmd) >= RCL_CommandStatus_Finished)
+        {
+            dmm_policy_ble_done(&policy, 0, ble_adv_now());
+        }
+        wait_us = DMM_BLE_EVENT_US + DMM_BURST_INTERVAL_MS * 1000U;
+    }
+    HwiP_restore(key);
+
+    if (wait_us != DMM_NOTHING)
+    {
+        zb_time_t delay = ZB_MILLISECONDS_TO_BEACON_INTERVAL((wait_us + 999U) / 1000U);
+        ZB_SCHEDULE_APP_ALARM(ble_adv_service, 0, delay ? delay : 1);
+    }
+}
+
+void ble_adv_init(void)
+{
+    zb_ieee_addr_t ieee;
+
+    zb_get_long_address(ieee);
+    /* Static random address: the two top bits of the MSB set */
+    memcpy(adv_addr, ieee, BLE_ADV_ADDR_LEN);
+    adv_addr[BLE_ADV_ADDR_LEN - 1] |= 0xC0;
+
+    dmm_policy_init(&policy, ((uint32_t)ieee[0] << 24) | ((uint32_t)ieee[1] << 16) |
+                    ((uint32_t)ieee[2] << 8) | ieee[3], ble_adv_now());
+
+    handle = RCL_open(&client, &LRF_configBle);
+    adv_cmd = RCL_CmdBle5Advertiser_DefaultRuntime();
+    adv_cmd.common.scheduling = RCL_Schedule_Now;
+    /* Preempts the IEEE background receive, never a running transmission */
+    adv_cmd.common.conflictPolicy = RCL_ConflictPolicy_Polite;
+    adv_cmd.common.runtime.callback = ble_adv_rcl_cb;
+    adv_cmd.common.runtime.rclCallbackMask.value = RCL_EventLastCmdDone.value;
+    adv_cmd.chanMap = 0x07;
+    adv_cmd.ctx = &adv_ctx;
+    TLOG_INFO("ble_adv: broadcasting occupancy");
+}
+
+void ble_adv_update(zb_uint8_t occupied)
+{
+    uintptr_t key = HwiP_disable();
+    zb_uint8_t edge = dmm_policy_occupancy(&policy, occupied, ble_adv_now());
+
+    HwiP_restore(key);
+    if (edge)
+    {
+        ZB_SCHEDULE_APP_ALARM_CANCEL(ble_adv_service, ZB_ALARM_ANY_PARAM);
+        ble_adv_service(0);
+    }
+}
+
+/*
+ * Strong versions of the weak DMM wrappers in dmm/rcl_stub_dmm.c: the
+ * ZBOSS MAC reaches the radio through these, so Zigbee always gets it.
+ */
+RCL_CommandStatus OVRDE_RCL_Command_submit(RCL_Handle h, RCL_Command_Handle c)
+{
+    uintptr_t key = HwiP_disable();
+
+    if (policy.ble_on_air)
+    {
+        ble_adv_stop();
+    }
+    HwiP_restore(key);
+    return RCL_Command_submit(h, c);
+}
+
+RCL_CommandStatus OVRDE_RCL_IEEE_Tx_submit(RCL_CmdIeeeRxTx *cmd, RCL_CmdIeee_TxAction *txAction)
+{
+    uintptr_t key = HwiP_disable();
+
+    zb_tx = txAction;
+    if (dmm_policy_zigbee(&policy, 1, ble_adv_now()))
+    {
+        ble_adv_stop();
+    }
+    HwiP_restore(key);
+    return RCL_IEEE_Tx_submit(cmd, txAction);
+}
+
+#endif /* BLE_ADV_ENABLE */
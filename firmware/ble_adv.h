@@ -0,0 +1,34 @@
+#ifndef BLE_ADV_H
+#define BLE_ADV_H
+
+#include "zboss_api.h"
+
+/*
+ * Optional BLE broadcast of occupancy, built with BLE_ADV_ENABLE. BLE
+ * gateways and phones can follow a room without a Zigbee route. The sensor
+ * sends non-connectable advertisements (ADV_NONCONN_IND) from a static
+ * random address derived from its IEEE address. Advertising data:
+ *
+ *   02 01 04                   Flags: BR/EDR not supported
+ *   06 FF cc cc 01 oo ss       Manufacturer data: company ID cc cc
+ *                              (little-endian), format 1, occupancy oo
+ *                              (0/1), sequence number ss (+1 per edge)
+ *
+ * Each edge is sent in a burst of advertising events, then repeated every
+ * second. The radio is shared with Zigbee under dmm_policy.h, which never
+ * lets BLE delay a Zigbee transmission.
+ *
+ * Without BLE_ADV_ENABLE the calls compile to nothing.
+ */
+
+#ifdef BLE_ADV_ENABLE
+/* Opens the BLE radio client; call once the long address is set */
+void ble_adv_init(void);
+/* Call with every occupancy update; edges start a burst */
+void ble_adv_update(zb_uint8_t occupied);
+#else
+#define ble_adv_init()              ((void)0)
+#define ble_adv_update(occupied)    ((void)(occupied))
+#endif
+
+#endif /* BLE_ADV_H */
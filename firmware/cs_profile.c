@@ -0,0 +1,58 @@
+#include "cs_profile.h"
+
+#include <string.h>
+
+volatile cs_profile_t cs_profile;
+
+static uint8_t cs_profile_bucket(uint32_t hold_us)
+{
+    uint8_t bucket = 0;
+
+    while (hold_us != 0U && bucket < CS_PROFILE_BUCKETS - 1U)
+    {
+        hold_us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void cs_profile_record(uint32_t hold_us, uint32_t caller)
+{
+    cs_profile.count++;
+    cs_profile.buckets[cs_profile_bucket(hold_us)]++;
+    if (hold_us > cs_profile.max_us)
+    {
+        cs_profile.max_us = hold_us;
+        cs_profile.max_caller = caller;
+    }
+}
+
+uint32_t cs_profile_percentile_us(uint8_t percent)
+{
+    /* Read without the lock: a hold recorded meanwhile only skews the estimate by one */
+    uint32_t total = cs_profile.count;
+    uint32_t target = (uint32_t)(((uint64_t)total * percent + 99U) / 100U);
+    uint32_t seen = 0;
+    uint8_t i;
+
+    if (total == 0U)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < CS_PROFILE_BUCKETS - 1U; i++)
+    {
+        seen += cs_profile.buckets[i];
+        if (seen >= target)
+        {
+            return 1UL << i;
+        }
+    }
+    /* Open-ended last bucket: the maximum is the best bound we have */
+    return cs_profile.max_us;
+}
+
+void cs_profile_reset(void)
+{
+    memset((void *)&cs_profile, 0, sizeof(cs_profile));
+}
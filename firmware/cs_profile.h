@@ -0,0 +1,35 @@
+#ifndef CS_PROFILE_H
+#define CS_PROFILE_H
+
+#include <stdint.h>
+
+/*
+ * Hold-time profile of the OSIF global interrupt lock
+ * (zb_ti_f3_disable_all_inter / zb_ti_f3_enable_all_inter), collected when
+ * the firmware is built with ZB_OSIF_CS_PROFILE. Only the outermost
+ * disable/enable pair is timed, in 1 us SYSTIM ticks. Bucket n counts holds
+ * of [2^(n-1), 2^n) us; bucket 0 counts holds under 1 us and the last bucket
+ * everything longer.
+ *
+ * cs_profile is a plain global so it can be dumped from the debugger
+ * ("cs_profile" in the expressions view) without the Zigbee stack running.
+ */
+
+#define CS_PROFILE_BUCKETS          16
+
+typedef struct {
+    uint32_t count;                         /* Outermost holds recorded */
+    uint32_t max_us;
+    uint32_t max_caller;                    /* Return address of the disable call that began the longest hold */
+    uint32_t buckets[CS_PROFILE_BUCKETS];
+} cs_profile_t;
+
+extern volatile cs_profile_t cs_profile;
+
+/* Called by the OSIF with interrupts still disabled */
+void cs_profile_record(uint32_t hold_us, uint32_t caller);
+/* Upper bound of the bucket the given percentile falls in, in us; 0 before any hold */
+uint32_t cs_profile_percentile_us(uint8_t percent);
+void cs_profile_reset(void);
+
+#endif /* CS_PROFILE_H */
@@ -0,0 +1,186 @@
+#include "diag.h"
+#include "mem_profile.h"
+#include "on_off_switch.h"
+#include "sensor.h"
+#include "sensor_worker.h"
+#include "stack_mon.h"
+#ifdef ZB_OSIF_CS_PROFILE
+#include "cs_profile.h"
+#endif
+
+#include "tlog.h"
+
+/* Standard Diagnostics attributes */
+#define DIAG_ATTR_NUMBER_OF_RESETS_ID       0x0000
+#define DIAG_ATTR_MAC_TX_UCAST_RETRY_ID     0x0104
+#define DIAG_ATTR_MAC_TX_UCAST_FAIL_ID      0x0105
+#define DIAG_ATTR_APS_TX_UCAST_SUCCESS_ID   0x0109
+#define DIAG_ATTR_APS_TX_UCAST_RETRY_ID     0x010A
+#define DIAG_ATTR_APS_TX_UCAST_FAIL_ID      0x010B
+#define DIAG_ATTR_BUF_ALLOC_FAILURES_ID     0x0117
+#define DIAG_ATTR_AVG_MAC_RETRY_ID          0x011B
+#define DIAG_ATTR_LAST_LQI_ID               0x011C
+#define DIAG_ATTR_LAST_RSSI_ID              0x011D
+
+static zb_uint16_t diag_cluster_revision = 1;
+static zb_uint16_t number_of_resets;
+static zb_uint16_t mac_tx_ucast_retry;
+static zb_uint16_t mac_tx_ucast_fail;
+static zb_uint16_t aps_tx_ucast_success;
+static zb_uint16_t aps_tx_ucast_retry;
+static zb_uint16_t aps_tx_ucast_fail;
+static zb_uint16_t buf_alloc_failures;
+static zb_uint16_t avg_mac_retry;
+static zb_uint8_t last_lqi;
+static zb_int8_t last_rssi;
+
+static zb_uint16_t parent_changes;
+static zb_uint16_t onoff_timeouts;
+static zb_uint32_t buf_low_s;           /* Seconds the buffer pool spent near exhaustion */
+static zb_uint32_t uart_frames;
+static zb_uint32_t uart_errors;
+static zb_uint16_t config_last_ms;
+static zb_uint16_t config_max_ms;
+static zb_uint16_t radar_silences;
+#ifdef ZB_OSIF_CS_PROFILE
+static zb_uint32_t cs_max_us;
+static zb_uint32_t cs_p99_us;
+static zb_uint32_t cs_max_caller;
+#endif
+static zb_uint16_t stack_min_free = STACK_MON_UNKNOWN;
+static zb_uint16_t stack_zboss = STACK_MON_UNKNOWN;
+static zb_uint16_t stack_worker = STACK_MON_UNKNOWN;
+static zb_uint16_t stack_idle = STACK_MON_UNKNOWN;
+static zb_uint16_t stack_timer = STACK_MON_UNKNOWN;
+static zb_uint16_t heap_min_free = STACK_MON_UNKNOWN;
+static zb_uint16_t heap_largest = STACK_MON_UNKNOWN;
+
+#define DIAG_RO                 ZB_ZCL_ATTR_ACCESS_READ_ONLY
+#define DIAG_RO_REPORT          (ZB_ZCL_ATTR_ACCESS_READ_ONLY | ZB_ZCL_ATTR_ACCESS_REPORTING)
+
+zb_zcl_attr_t diag_attr_list[DIAG_ATTR_COUNT] = {
+    { ZB_ZCL_ATTR_GLOBAL_CLUSTER_REVISION_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &diag_cluster_revision },
+    { DIAG_ATTR_NUMBER_OF_RESETS_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &number_of_resets },
+    { DIAG_ATTR_MAC_TX_UCAST_RETRY_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &mac_tx_ucast_retry },
+    { DIAG_ATTR_MAC_TX_UCAST_FAIL_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &mac_tx_ucast_fail },
+    { DIAG_ATTR_APS_TX_UCAST_SUCCESS_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &aps_tx_ucast_success },
+    { DIAG_ATTR_APS_TX_UCAST_RETRY_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &aps_tx_ucast_retry },
+    { DIAG_ATTR_APS_TX_UCAST_FAIL_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO_REPORT, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &aps_tx_ucast_fail },
+    { DIAG_ATTR_BUF_ALLOC_FAILURES_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &buf_alloc_failures },
+    { DIAG_ATTR_AVG_MAC_RETRY_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &avg_mac_retry },
+    { DIAG_ATTR_LAST_LQI_ID, ZB_ZCL_ATTR_TYPE_U8, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &last_lqi },
+    { DIAG_ATTR_LAST_RSSI_ID, ZB_ZCL_ATTR_TYPE_S8, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &last_rssi },
+    /* Manufacturer extensions */
+    { DIAG_ATTR_PARENT_CHANGES_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO_REPORT, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &parent_changes },
+    { DIAG_ATTR_ONOFF_TIMEOUTS_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO_REPORT, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &onoff_timeouts },
+    { DIAG_ATTR_BUF_LOW_S_ID, ZB_ZCL_ATTR_TYPE_U32, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &buf_low_s },
+    { DIAG_ATTR_UART_FRAMES_ID, ZB_ZCL_ATTR_TYPE_U32, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &uart_frames },
+    { DIAG_ATTR_UART_ERRORS_ID, ZB_ZCL_ATTR_TYPE_U32, DIAG_RO_REPORT, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &uart_errors },
+    { DIAG_ATTR_CONFIG_LAST_MS_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &config_last_ms },
+    { DIAG_ATTR_CONFIG_MAX_MS_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &config_max_ms },
+    { DIAG_ATTR_RADAR_SILENCES_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO_REPORT, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &radar_silences },
+#ifdef ZB_OSIF_CS_PROFILE
+    { DIAG_ATTR_CS_MAX_US_ID, ZB_ZCL_ATTR_TYPE_U32, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &cs_max_us },
+    { DIAG_ATTR_CS_P99_US_ID, ZB_ZCL_ATTR_TYPE_U32, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &cs_p99_us },
+    { DIAG_ATTR_CS_MAX_CALLER_ID, ZB_ZCL_ATTR_TYPE_U32, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &cs_max_caller },
+#endif
+    { DIAG_ATTR_STACK_MIN_FREE_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO_REPORT, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &stack_min_free },
+    { DIAG_ATTR_STACK_ZBOSS_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &stack_zboss },
+    { DIAG_ATTR_STACK_WORKER_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &stack_worker },
+    { DIAG_ATTR_STACK_IDLE_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &stack_idle },
+    { DIAG_ATTR_STACK_TIMER_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &stack_timer },
+    { DIAG_ATTR_HEAP_MIN_FREE_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &heap_min_free },
+    { DIAG_ATTR_HEAP_LARGEST_ID, ZB_ZCL_ATTR_TYPE_U16, DIAG_RO, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &heap_largest },
+    { ZB_ZCL_NULL_ID, 0, 0, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, NULL } /* terminator */
+};
+
+/* Reportable counters go through ZCL so a change can trigger their report */
+static void diag_set16(zb_uint16_t attr_id, zb_uint16_t *attr, zb_uint16_t value)
+{
+    if (*attr != value)
+    {
+        ZB_ZCL_SET_ATTRIBUTE(ZB_SWITCH_ENDPOINT, ZB_ZCL_CLUSTER_ID_DIAGNOSTICS, ZB_ZCL_CLUSTER_SERVER_ROLE,
+                             attr_id, (zb_uint8_t *)&value, ZB_FALSE);
+    }
+}
+
+static void diag_set32(zb_uint16_t attr_id, zb_uint32_t *attr, zb_uint32_t value)
+{
+    if (*attr != value)
+    {
+        ZB_ZCL_SET_ATTRIBUTE(ZB_SWITCH_ENDPOINT, ZB_ZCL_CLUSTER_ID_DIAGNOSTICS, ZB_ZCL_CLUSTER_SERVER_ROLE,
+                             attr_id, (zb_uint8_t *)&value, ZB_FALSE);
+    }
+}
+
+static void diag_stats_cb(zb_uint8_t param)
+{
+    zdo_diagnostics_full_stats_t *stats = (zdo_diagnostics_full_stats_t *)zb_buf_begin(param);
+
+    number_of_resets = stats->zdo_stats.number_of_resets;
+    mac_tx_ucast_retry = (zb_uint16_t)stats->mac_stats.mac_tx_ucast_retries;
+    mac_tx_ucast_fail = (zb_uint16_t)stats->mac_stats.mac_tx_ucast_failures;
+    aps_tx_ucast_success = stats->zdo_stats.aps_tx_ucast_success;
+    aps_tx_ucast_retry = stats->zdo_stats.aps_tx_ucast_retry;
+    diag_set16(DIAG_ATTR_APS_TX_UCAST_FAIL_ID, &aps_tx_ucast_fail, stats->zdo_stats.aps_tx_ucast_fail);
+    buf_alloc_failures = stats->zdo_stats.packet_buffer_allocate_failures;
+    avg_mac_retry = stats->zdo_stats.average_mac_retry_per_aps_message_sent;
+    last_lqi = stats->mac_stats.last_msg_lqi;
+    last_rssi = stats->mac_stats.last_msg_rssi;
+
+    zb_buf_free(param);
+}
+
+void diag_refresh(zb_uint8_t param)
+{
+    const sensor_rx_stats_t *rx = sensor_get_rx_stats();
+    const sensor_worker_stats_t *worker = sensor_worker_get_stats();
+    const stack_mon_stats_t *mon = stack_mon_get_stats();
+
+    ZVUNUSED(param);
+
+    uart_frames = rx->presence_frames + rx->telemetry_frames;
+    diag_set32(DIAG_ATTR_UART_ERRORS_ID, &uart_errors, rx->parse_errors + rx->presence_dropped);
+    config_last_ms = worker->config_last_ms;
+    config_max_ms = worker->config_max_ms;
+    diag_set16(DIAG_ATTR_RADAR_SILENCES_ID, &radar_silences, worker->silences);
+#ifdef ZB_OSIF_CS_PROFILE
+    cs_max_us = cs_profile.max_us;
+    cs_max_caller = cs_profile.max_caller;
+    cs_p99_us = cs_profile_percentile_us(99);
+#endif
+    stack_mon_sample();
+    diag_set16(DIAG_ATTR_STACK_MIN_FREE_ID, &stack_min_free, mon->min_free);
+    stack_zboss = mon->free[STACK_TASK_ZBOSS];
+    stack_worker = mon->free[STACK_TASK_WORKER];
+    stack_idle = mon->free[STACK_TASK_IDLE];
+    stack_timer = mon->free[STACK_TASK_TIMER];
+    heap_min_free = mon->heap_min_free;
+    heap_largest = mon->heap_largest;
+
+    if (zdo_diagnostics_get_stats(diag_stats_cb, ZB_PIB_ATTRIBUTE_IEEE_DIAGNOSTIC_INFO) != RET_OK)
+    {
+        TLOG_WARNING("diag: ZBOSS counters not available");
+    }
+
+    ZB_SCHEDULE_APP_ALARM(diag_refresh, 0, DIAG_REFRESH_S * ZB_TIME_ONE_SECOND);
+}
+
+void diag_poll(void)
+{
+    if (zb_buf_memory_low())
+    {
+        buf_low_s++;
+    }
+    mem_profile_sample();
+}
+
+void diag_parent_changed(void)
+{
+    diag_set16(DIAG_ATTR_PARENT_CHANGES_ID, &parent_changes, (zb_uint16_t)(parent_changes + 1U));
+}
+
+void diag_cmd_timeout(void)
+{
+    diag_set16(DIAG_ATTR_ONOFF_TIMEOUTS_ID, &onoff_timeouts, (zb_uint16_t)(onoff_timeouts + 1U));
+}
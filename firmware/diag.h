@@ -0,0 +1,53 @@
+#ifndef DIAG_H
+#define DIAG_H
+
+#include "zboss_api.h"
+
+/*
+ * Diagnostics cluster (0x0B05) server. The standard attributes are pulled
+ * from the ZBOSS MAC/ZDO counters every DIAG_REFRESH_S; the manufacturer
+ * extensions come from the application and the sensor worker.
+ */
+
+/* Manufacturer extensions */
+#define DIAG_ATTR_PARENT_CHANGES_ID     0xE000
+#define DIAG_ATTR_ONOFF_TIMEOUTS_ID     0xE001
+#define DIAG_ATTR_BUF_LOW_S_ID          0xE002
+#define DIAG_ATTR_UART_FRAMES_ID        0xE003
+#define DIAG_ATTR_UART_ERRORS_ID        0xE004
+#define DIAG_ATTR_CONFIG_LAST_MS_ID     0xE005
+#define DIAG_ATTR_CONFIG_MAX_MS_ID      0xE006
+#define DIAG_ATTR_RADAR_SILENCES_ID     0xE007
+/* Interrupt lock hold times, only with ZB_OSIF_CS_PROFILE (see cs_profile.h) */
+#define DIAG_ATTR_CS_MAX_US_ID          0xE008
+#define DIAG_ATTR_CS_P99_US_ID          0xE009
+#define DIAG_ATTR_CS_MAX_CALLER_ID      0xE00A
+/* Stack and heap high-water marks in bytes (see stack_mon.h) */
+#define DIAG_ATTR_STACK_MIN_FREE_ID     0xE00B
+#define DIAG_ATTR_STACK_ZBOSS_ID        0xE00C
+#define DIAG_ATTR_STACK_WORKER_ID       0xE00D
+#define DIAG_ATTR_STACK_IDLE_ID         0xE00E
+#define DIAG_ATTR_STACK_TIMER_ID        0xE00F
+#define DIAG_ATTR_HEAP_MIN_FREE_ID      0xE010
+#define DIAG_ATTR_HEAP_LARGEST_ID       0xE011
+
+#ifdef ZB_OSIF_CS_PROFILE
+#define DIAG_ATTR_COUNT                 30      /* diag_attr_list entries, terminator included */
+#else
+#define DIAG_ATTR_COUNT                 27
+#endif
+/* Reportable attributes: APS failures, parent changes, On/Off timeouts, UART errors, radar silences,
+ * least free stack */
+#define DIAG_REPORTING_SLOTS            6
+#define DIAG_REFRESH_S                  60
+
+extern zb_zcl_attr_t diag_attr_list[DIAG_ATTR_COUNT];
+
+/* Pulls the ZBOSS counters and stack marks and reschedules itself; schedule once after joining */
+void diag_refresh(zb_uint8_t param);
+/* Call once a second: samples the buffer pool, and all pools with ZB_MEM_PROFILE */
+void diag_poll(void);
+void diag_parent_changed(void);
+void diag_cmd_timeout(void);
+
+#endif /* DIAG_H */
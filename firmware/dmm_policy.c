@@ -0,0 +1,122 @@
+#include "dmm_policy.h"
+
+#include <string.h>
+
+static uint32_t dmm_rand(dmm_policy_t *p)
+{
+    /* xorshift32 */
+    p->rng ^= p->rng << 13;
+    p->rng ^= p->rng >> 17;
+    p->rng ^= p->rng << 5;
+    return p->rng;
+}
+
+static uint32_t dmm_adv_delay_us(dmm_policy_t *p)
+{
+    return dmm_rand(p) % (DMM_ADV_DELAY_MAX_US + 1U);
+}
+
+void dmm_policy_init(dmm_policy_t *p, uint32_t seed, uint32_t now_us)
+{
+    memset(p, 0, sizeof(*p));
+    p->rng = seed ? seed : 1U;
+    p->zigbee_idle_us = now_us - DMM_ZB_GUARD_US;
+    p->window_us = now_us;
+}
+
+uint8_t dmm_policy_occupancy(dmm_policy_t *p, uint8_t occupied, uint32_t now_us)
+{
+    occupied = occupied ? 1 : 0;
+    if (p->valid && occupied == p->occupied)
+    {
+        return 0;
+    }
+    p->valid = 1;
+    p->occupied = occupied;
+    p->seq++;
+    /* The first event goes out at once; the burst follows it */
+    p->burst_left = DMM_BURST_EVENTS - 1U;
+    p->next_us = now_us;
+    return 1;
+}
+
+uint8_t dmm_policy_zigbee(dmm_policy_t *p, uint8_t busy, uint32_t now_us)
+{
+    p->zigbee_busy = busy ? 1 : 0;
+    if (!busy)
+    {
+        p->zigbee_idle_us = now_us;
+        return 0;
+    }
+    return p->ble_on_air;
+}
+
+uint32_t dmm_policy_ble_request(dmm_policy_t *p, uint32_t now_us)
+{
+    uint32_t since;
+
+    if (!p->valid || p->ble_on_air)
+    {
+        return DMM_NOTHING;
+    }
+    if ((int32_t)(p->next_us - now_us) > 0)
+    {
+        return p->next_us - now_us;
+    }
+
+    if (p->zigbee_busy)
+    {
+        p->deferred++;
+        return DMM_ZB_GUARD_US;
+    }
+    since = now_us - p->zigbee_idle_us;
+    if (since < DMM_ZB_GUARD_US)
+    {
+        p->deferred++;
+        return DMM_ZB_GUARD_US - since;
+    }
+
+    if (now_us - p->window_us >= DMM_BLE_WINDOW_US)
+    {
+        p->window_us = now_us;
+        p->used_us = 0;
+    }
+    if (p->used_us + DMM_BLE_EVENT_US > DMM_BLE_BUDGET_US)
+    {
+        p->deferred++;
+        return DMM_BLE_WINDOW_US - (now_us - p->window_us);
+    }
+
+    p->used_us += DMM_BLE_EVENT_US;
+    p->ble_on_air = 1;
+    p->air_seq = p->seq;
+    return 0;
+}
+
+void dmm_policy_ble_done(dmm_policy_t *p, uint8_t completed, uint32_t now_us)
+{
+    p->ble_on_air = 0;
+    if (!completed)
+    {
+        /* Stopped by Zigbee: the same event again, once Zigbee is done */
+        p->preempted++;
+        p->next_us = now_us;
+        return;
+    }
+
+    p->events++;
+    if (p->air_seq != p->seq)
+    {
+        /* An edge came during the event: its burst has not started yet */
+        p->next_us = now_us;
+    }
+    else if (p->burst_left > 0)
+    {
+        p->burst_left--;
+        p->next_us = now_us + DMM_BURST_INTERVAL_MS * 1000U + dmm_adv_delay_us(p);
+    }
+    else
+    {
+        p->next_us = now_us + DMM_SLOW_INTERVAL_MS * 1000U + dmm_adv_delay_us(p);
+    }
+}
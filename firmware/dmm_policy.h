@@ -0,0 +1,81 @@
+#ifndef DMM_POLICY_H
+#define DMM_POLICY_H
+
+#include <stdint.h>
+
+/*
+ * Radio sharing between the Zigbee MAC and the BLE occupancy advertiser
+ * (ble_adv.h). The rules, in order:
+ * - Zigbee always wins. BLE may only take the radio from the IEEE
+ *   background receive, never from a transmission, its CSMA backoffs or its
+ *   MAC ack wait. A Zigbee transmission submitted during a BLE event stops
+ *   the event.
+ * - After a Zigbee transmission BLE waits DMM_ZB_GUARD_US, so the replies
+ *   (APS ack, ZCL response) find the radio listening. Without it the burst
+ *   after an edge lands right on them.
+ * - BLE gets at most DMM_BLE_BUDGET_US of airtime per DMM_BLE_WINDOW_US.
+ *   Receive loss stays small enough for MAC retries to absorb it.
+ * - An occupancy edge starts a burst of DMM_BURST_EVENTS advertising events
+ *   DMM_BURST_INTERVAL_MS apart. The advertiser then repeats the state every
+ *   DMM_SLOW_INTERVAL_MS.
+ *
+ * The policy only keeps time and state. The caller owns the radio: it
+ * reports Zigbee activity, asks before each advertising event and reports
+ * when the event ends. Times are microseconds on a free-running 32-bit clock
+ * (wrap-safe). The sim drives the same code with a stand-in radio
+ * (sim --ble).
+ */
+
+#define DMM_BLE_EVENT_US            1500U   /* ADV_NONCONN_IND on channels 37, 38 and 39 */
+#define DMM_BLE_WINDOW_US           100000U
+#define DMM_BLE_BUDGET_US           5000U
+#define DMM_ZB_GUARD_US             40000U  /* APS ack and ZCL response of a 1-3 hop route */
+#define DMM_BURST_EVENTS            4U
+#define DMM_BURST_INTERVAL_MS       20U
+#define DMM_SLOW_INTERVAL_MS        1000U
+#define DMM_ADV_DELAY_MAX_US        10000U  /* Core spec advDelay: random 0-10 ms per event */
+
+/* Returned by dmm_policy_ble_request() when there is nothing to advertise */
+#define DMM_NOTHING                 0xFFFFFFFFU
+
+typedef struct {
+    uint8_t valid;              /* Occupancy known: advertising has started */
+    uint8_t occupied;
+    uint8_t seq;                /* Incremented on every edge */
+    uint8_t air_seq;            /* Sequence number of the granted event */
+    uint8_t burst_left;
+    uint8_t zigbee_busy;
+    uint8_t ble_on_air;
+    uint32_t zigbee_idle_us;    /* When Zigbee last released the radio */
+    uint32_t next_us;           /* Next advertising event is due */
+    uint32_t window_us;         /* Start of the current budget window */
+    uint32_t used_us;           /* BLE airtime granted in the window */
+    uint32_t rng;
+    /* Counters */
+    uint32_t events;            /* Advertising events completed */
+    uint32_t deferred;          /* Requests refused: Zigbee busy or budget spent */
+    uint32_t preempted;         /* Events stopped by a Zigbee transmission */
+} dmm_policy_t;
+
+/* seed varies advDelay between devices; any value but 0 */
+void dmm_policy_init(dmm_policy_t *p, uint32_t seed, uint32_t now_us);
+/*
+ * Call with every occupancy update. A change, or the first update, takes a
+ * new sequence number and starts a burst. Returns 1 in that case.
+ */
+uint8_t dmm_policy_occupancy(dmm_policy_t *p, uint8_t occupied, uint32_t now_us);
+/*
+ * The Zigbee MAC starts (busy = 1) or finishes (busy = 0) a transmission.
+ * Returns 1 when a BLE event is on air and must be stopped first; the caller
+ * then reports it with dmm_policy_ble_done(p, 0, ...).
+ */
+uint8_t dmm_policy_zigbee(dmm_policy_t *p, uint8_t busy, uint32_t now_us);
+/*
+ * Asks for the radio for one advertising event. Returns 0 when granted,
+ * otherwise the microseconds to wait before asking again, or DMM_NOTHING.
+ */
+uint32_t dmm_policy_ble_request(dmm_policy_t *p, uint32_t now_us);
+/* The granted event ended; completed = 0 when it was stopped */
+void dmm_policy_ble_done(dmm_policy_t *p, uint8_t completed, uint32_t now_us);
+
+#endif /* DMM_POLICY_H */
@@ -0,0 +1,226 @@
+#include "history.h"
+
+#include <string.h>
+
+#define HISTORY_VERSION             1
+#define HISTORY_VARINT_MAX          5
+#define HISTORY_DELTA_MAX           0x3FFFFFFFU
+
+/* Persisted as ZB_NVRAM_APP_DATA2 when HISTORY_NVRAM is set */
+typedef struct {
+    zb_uint8_t version;
+    zb_uint8_t reserved;
+    zb_uint16_t len;            /* Bytes used in data */
+    zb_uint16_t count;          /* Records in data */
+    zb_uint16_t reserved2;
+    zb_uint32_t first_seq;
+    zb_uint32_t newest_utc;     /* Time cluster time of the newest record, if it was known */
+    zb_uint8_t data[HISTORY_BYTES];
+} history_store_t;
+
+static history_store_t store;
+/* last_ms is the uptime of the newest record; false until the first record after boot */
+static zb_bool_t have_last = ZB_FALSE;
+static zb_uint32_t last_ms;
+
+static zb_uint8_t history_encode(zb_uint32_t value, zb_uint8_t *out)
+{
+    zb_uint8_t n = 0;
+
+    while (value >= 0x80)
+    {
+        out[n++] = (zb_uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (zb_uint8_t)value;
+    return n;
+}
+
+static zb_uint32_t history_decode(const zb_uint8_t *in, zb_uint8_t *len)
+{
+    zb_uint32_t value = 0;
+    zb_uint8_t n = 0;
+
+    do
+    {
+        value |= (zb_uint32_t)(in[n] & 0x7F) << (7 * n);
+    } while (in[n++] & 0x80);
+
+    *len = n;
+    return value;
+}
+
+static void history_reset(void)
+{
+    memset(&store, 0, sizeof(store));
+    store.version = HISTORY_VERSION;
+    store.newest_utc = HISTORY_UTC_UNKNOWN;
+}
+
+static void history_drop_oldest(void)
+{
+    zb_uint8_t n;
+
+    history_decode(store.data, &n);
+    memmove(store.data, &store.data[n], store.len - n);
+    store.len -= n;
+    store.count--;
+    store.first_seq++;
+}
+
+#if HISTORY_NVRAM
+static zb_bool_t save_scheduled = ZB_FALSE;
+
+static void history_nvram_read(zb_uint8_t page, zb_uint32_t pos, zb_uint16_t payload_length)
+{
+    if (payload_length != sizeof(store) ||
+        zb_nvram_read_data(page, pos, (zb_uint8_t *)&store, sizeof(store)) != RET_OK ||
+        store.version != HISTORY_VERSION || store.len > HISTORY_BYTES)
+    {
+        history_reset();
+    }
+}
+
+static zb_ret_t history_nvram_write(zb_uint8_t page, zb_uint32_t pos)
+{
+    return zb_nvram_write_data(page, pos, (zb_uint8_t *)&store, sizeof(store));
+}
+
+static zb_uint16_t history_nvram_size(void)
+{
+    return sizeof(store);
+}
+
+static void history_save(zb_uint8_t param)
+{
+    ZVUNUSED(param);
+    save_scheduled = ZB_FALSE;
+    zb_nvram_write_dataset(ZB_NVRAM_APP_DATA2);
+}
+#endif
+
+void history_init(void)
+{
+    history_reset();
+#if HISTORY_NVRAM
+    zb_nvram_register_app2_read_cb(history_nvram_read);
+    zb_nvram_register_app2_write_cb(history_nvram_write, history_nvram_size);
+#endif
+}
+
+void history_record(zb_uint8_t state, zb_uint32_t now_ms, const zb_uint32_t *utc_s)
+{
+    zb_uint8_t buf[HISTORY_VARINT_MAX];
+    zb_uint32_t delta = 0;
+    zb_uint32_t gap = 0;
+    zb_uint8_t n;
+
+    if (have_last)
+    {
+        delta = (now_ms - last_ms) / 100U;
+    }
+    else if (store.count > 0)
+    {
+        /* Records restored from NVRAM: bridge the reboot with Time cluster time if we can */
+        if (utc_s != NULL && store.newest_utc != HISTORY_UTC_UNKNOWN && *utc_s >= store.newest_utc)
+        {
+            delta = (*utc_s - store.newest_utc) * 10U;
+        }
+        else
+        {
+            gap = 1;
+        }
+    }
+    if (delta > HISTORY_DELTA_MAX)
+    {
+        delta = HISTORY_DELTA_MAX;
+    }
+
+    n = history_encode(delta << 2 | gap << 1 | (state ? 1U : 0U), buf);
+    while (store.len + n > HISTORY_BYTES)
+    {
+        history_drop_oldest();
+    }
+    memcpy(&store.data[store.len], buf, n);
+    store.len += n;
+    store.count++;
+    store.newest_utc = utc_s != NULL ? *utc_s : HISTORY_UTC_UNKNOWN;
+
+    last_ms = now_ms;
+    have_last = ZB_TRUE;
+
+#if HISTORY_NVRAM
+    if (!save_scheduled)
+    {
+        save_scheduled = ZB_TRUE;
+        ZB_SCHEDULE_APP_ALARM(history_save, 0, HISTORY_SAVE_S * ZB_TIME_ONE_SECOND);
+    }
+#endif
+}
+
+void history_read(zb_uint32_t since_seq, zb_uint32_t now_ms, const zb_uint32_t *utc_s, history_chunk_t *chunk)
+{
+    zb_uint32_t skip = since_seq > store.first_seq ? since_seq - store.first_seq : 0;
+    zb_uint32_t age;
+    zb_uint16_t pos = 0;
+    zb_uint16_t i;
+    zb_uint8_t n;
+
+    memset(chunk, 0, sizeof(*chunk));
+    chunk->first_seq = store.first_seq + (skip < store.count ? skip : store.count);
+    chunk->last_age_ds = HISTORY_AGE_UNKNOWN;
+
+    for (i = 0; i < store.count; i++)
+    {
+        history_decode(&store.data[pos], &n);
+        if (i >= skip)
+        {
+            if (chunk->len + n > HISTORY_CHUNK_BYTES)
+            {
+                chunk->more = ZB_TRUE;
+                break;
+            }
+            memcpy(&chunk->data[chunk->len], &store.data[pos], n);
+            chunk->len += n;
+            chunk->count++;
+        }
+        pos += n;
+    }
+
+    if (chunk->count == 0)
+    {
+        return;
+    }
+
+    /* Age of the newest record, then back through the records after the chunk */
+    if (have_last)
+    {
+        age = (now_ms - last_ms) / 100U;
+    }
+    else if (utc_s != NULL && store.newest_utc != HISTORY_UTC_UNKNOWN && *utc_s >= store.newest_utc)
+    {
+        age = (*utc_s - store.newest_utc) * 10U;
+    }
+    else
+    {
+        return;
+    }
+
+    for (; i < store.count; i++)
+    {
+        zb_uint32_t value = history_decode(&store.data[pos], &n);
+
+        if (value & 2U)
+        {
+            return;
+        }
+        age += value >> 2;
+        pos += n;
+    }
+    chunk->last_age_ds = age;
+}
+
+zb_uint32_t history_next_seq(void)
+{
+    return store.first_seq + store.count;
+}
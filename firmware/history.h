@@ -0,0 +1,55 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "zboss_api.h"
+
+/*
+ * Occupancy transitions, oldest first, one varint per record:
+ *
+ *   value = delta << 2 | gap << 1 | state
+ *
+ * delta is the time since the previous record in 100 ms steps. gap marks
+ * a record whose delta is unknown: the first one after a reboot that could
+ * not be bridged with Time cluster time. A 1 byte record covers up to
+ * 3.1 s and a 3 byte record up to 14 h. When the buffer is full the oldest
+ * records are dropped.
+ */
+
+/* The end device's stack pools (zb_mem_config_sensor.h) leave room for twice the history */
+#if defined ZB_CONFIGURABLE_MEM && !defined ZB_ROUTER_ROLE
+#define HISTORY_BYTES               1024
+#else
+#define HISTORY_BYTES               512
+#endif
+#define HISTORY_CHUNK_BYTES         64      /* Record bytes per bulk response */
+#define HISTORY_AGE_UNKNOWN         0xFFFFFFFFU
+#define HISTORY_UTC_UNKNOWN         0xFFFFFFFFU
+
+/* Keep the history in ZB_NVRAM_APP_DATA2 across reboots */
+#ifndef HISTORY_NVRAM
+#define HISTORY_NVRAM               0
+#endif
+#define HISTORY_SAVE_S              600     /* At most one NVRAM write per this many seconds */
+
+typedef struct {
+    zb_uint32_t first_seq;      /* Sequence number of the first record in data */
+    zb_uint8_t count;
+    zb_bool_t more;             /* Newer records did not fit */
+    zb_uint32_t last_age_ds;    /* Age of the last record in data, HISTORY_AGE_UNKNOWN across an unbridged reboot */
+    zb_uint8_t len;
+    zb_uint8_t data[HISTORY_CHUNK_BYTES];
+} history_chunk_t;
+
+/* Registers the NVRAM dataset when HISTORY_NVRAM is set; call before zboss_start_no_autostart() */
+void history_init(void);
+
+/* utc_s is the current Time cluster time, or NULL while the clock is not synced */
+void history_record(zb_uint8_t state, zb_uint32_t now_ms, const zb_uint32_t *utc_s);
+
+/* Records with sequence number >= since_seq, as many as fit in one chunk */
+void history_read(zb_uint32_t since_seq, zb_uint32_t now_ms, const zb_uint32_t *utc_s, history_chunk_t *chunk);
+
+/* Sequence number the next record will get */
+zb_uint32_t history_next_seq(void);
+
+#endif /* HISTORY_H */
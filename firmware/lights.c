@@ -0,0 +1,292 @@
+#include "lights.h"
+#include "on_off_switch.h"
+
+#include "tlog.h"
+
+#define LIGHTS_NONE                 0xFF
+
+/* Setup steps run per light after finding & binding, one buffer each */
+enum {
+    LIGHT_STEP_BIND = 0,        /* Light -> us binding for its On/Off reports */
+    LIGHT_STEP_REPORTING,       /* Report OnOff on change */
+    LIGHT_STEP_READ,            /* Current state, until the first report */
+    LIGHT_STEP_COUNT,
+};
+
+typedef struct {
+    zb_ieee_addr_t ieee;
+    zb_uint8_t ep;
+    zb_uint8_t state;           /* light_state_t */
+    zb_bool_t manual;           /* Switched by hand since the last presence edge */
+    zb_uint8_t timeouts;        /* Commands in a row that got no answer */
+} light_t;
+
+static light_t lights[LIGHTS_MAX];
+static zb_uint8_t light_count;
+/* Light the outstanding On/Off command went to, and the state it asked for */
+static zb_uint8_t pending = LIGHTS_NONE;
+static zb_uint8_t pending_state;
+/* Round-robin start so one unresponsive light does not starve the others */
+static zb_uint8_t next_light;
+
+static zb_uint8_t lights_find(const zb_ieee_addr_t ieee, zb_uint8_t ep)
+{
+    zb_uint8_t i;
+
+    for (i = 0; i < light_count; i++)
+    {
+        if (lights[i].ep == ep && ZB_IEEE_ADDR_CMP(lights[i].ieee, ieee))
+        {
+            return i;
+        }
+    }
+    return LIGHTS_NONE;
+}
+
+static zb_uint8_t lights_find_short(zb_uint16_t short_addr, zb_uint8_t ep)
+{
+    zb_ieee_addr_t ieee;
+
+    if (zb_address_ieee_by_short(short_addr, ieee) != RET_OK)
+    {
+        return LIGHTS_NONE;
+    }
+    return lights_find(ieee, ep);
+}
+
+zb_bool_t lights_add(const zb_ieee_addr_t ieee, zb_uint8_t ep)
+{
+    if (lights_find(ieee, ep) != LIGHTS_NONE)
+    {
+        return ZB_TRUE;
+    }
+    if (light_count == LIGHTS_MAX)
+    {
+        TLOG_WARNING("light table full, ep %d not bound", ep);
+        return ZB_FALSE;
+    }
+
+    ZB_IEEE_ADDR_COPY(lights[light_count].ieee, ieee);
+    lights[light_count].ep = ep;
+    lights[light_count].state = LIGHT_UNKNOWN;
+    lights[light_count].manual = ZB_FALSE;
+    lights[light_count].timeouts = 0;
+    light_count++;
+    return ZB_TRUE;
+}
+
+zb_uint8_t lights_count(void)
+{
+    return light_count;
+}
+
+static void lights_setup(zb_uint8_t param, zb_uint16_t arg)
+{
+    zb_uint8_t idx = (zb_uint8_t)(arg / LIGHT_STEP_COUNT);
+    zb_uint8_t step = (zb_uint8_t)(arg % LIGHT_STEP_COUNT);
+    light_t *light = &lights[idx];
+    zb_addr_u dst;
+    zb_uint8_t *cmd_ptr;
+
+    ZB_IEEE_ADDR_COPY(dst.addr_long, light->ieee);
+
+    switch (step)
+    {
+        case LIGHT_STEP_BIND:
+        {
+            zb_zdo_bind_req_param_t *req = ZB_BUF_GET_PARAM(param, zb_zdo_bind_req_param_t);
+            zb_uint16_t short_addr = zb_address_short_by_ieee(light->ieee);
+
+            if (short_addr == ZB_UNKNOWN_SHORT_ADDR)
+            {
+                zb_buf_free(param);
+                break;
+            }
+            ZB_IEEE_ADDR_COPY(req->src_address, light->ieee);
+            req->src_endp = light->ep;
+            req->cluster_id = ZB_ZCL_CLUSTER_ID_ON_OFF;
+            req->dst_addr_mode = ZB_APS_ADDR_MODE_64_ENDP_PRESENT;
+            zb_get_long_address(req->dst_address.addr_long);
+            req->dst_endp = ZB_SWITCH_ENDPOINT;
+            req->req_dst_addr = short_addr;
+            zb_zdo_bind_req(param, NULL);
+            break;
+        }
+
+        case LIGHT_STEP_REPORTING:
+            ZB_ZCL_GENERAL_INIT_CONFIGURE_REPORTING_SRV_REQ(param, cmd_ptr, ZB_ZCL_DISABLE_DEFAULT_RESPONSE);
+            ZB_ZCL_GENERAL_ADD_SEND_REPORT_CONFIGURE_REPORTING_REQ(cmd_ptr, ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID,
+                ZB_ZCL_ATTR_TYPE_BOOL, 0, LIGHTS_REPORT_MAX_S, 0);
+            ZB_ZCL_GENERAL_SEND_CONFIGURE_REPORTING_REQ(param, cmd_ptr, dst, ZB_APS_ADDR_MODE_64_ENDP_PRESENT,
+                light->ep, ZB_SWITCH_ENDPOINT, ZB_AF_HA_PROFILE_ID, ZB_ZCL_CLUSTER_ID_ON_OFF, NULL);
+            break;
+
+        default:
+            ZB_ZCL_GENERAL_INIT_READ_ATTR_REQ(param, cmd_ptr, ZB_ZCL_DISABLE_DEFAULT_RESPONSE);
+            ZB_ZCL_GENERAL_ADD_ID_READ_ATTR_REQ(cmd_ptr, ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID);
+            ZB_ZCL_GENERAL_SEND_READ_ATTR_REQ(param, cmd_ptr, dst, ZB_APS_ADDR_MODE_64_ENDP_PRESENT,
+                light->ep, ZB_SWITCH_ENDPOINT, ZB_AF_HA_PROFILE_ID, ZB_ZCL_CLUSTER_ID_ON_OFF, NULL);
+            break;
+    }
+
+    if (arg + 1U < (zb_uint16_t)light_count * LIGHT_STEP_COUNT)
+    {
+        zb_buf_get_out_delayed_ext(lights_setup, (zb_uint16_t)(arg + 1U), 0);
+    }
+}
+
+void lights_subscribe(void)
+{
+    if (light_count > 0)
+    {
+        zb_buf_get_out_delayed_ext(lights_setup, 0, 0);
+    }
+}
+
+zb_bool_t lights_drive(zb_uint8_t param, zb_bool_t on)
+{
+    zb_uint8_t want = on ? LIGHT_ON : LIGHT_OFF;
+    zb_uint8_t n;
+
+    for (n = 0; n < light_count; n++)
+    {
+        zb_uint8_t idx = (zb_uint8_t)((next_light + n) % light_count);
+        light_t *light = &lights[idx];
+        zb_addr_u dst;
+
+        if (light->manual || light->state == want || light->timeouts >= LIGHTS_MAX_TIMEOUTS)
+        {
+            continue;
+        }
+
+        ZB_IEEE_ADDR_COPY(dst.addr_long, light->ieee);
+        if (on)
+        {
+            ZB_ZCL_ON_OFF_SEND_ON_REQ(param, dst, ZB_APS_ADDR_MODE_64_ENDP_PRESENT, light->ep,
+                ZB_SWITCH_ENDPOINT, ZB_AF_HA_PROFILE_ID, ZB_FALSE, NULL);
+        }
+        else
+        {
+            ZB_ZCL_ON_OFF_SEND_OFF_REQ(param, dst, ZB_APS_ADDR_MODE_64_ENDP_PRESENT, light->ep,
+                ZB_SWITCH_ENDPOINT, ZB_AF_HA_PROFILE_ID, ZB_FALSE, NULL);
+        }
+        TLOG_INFO("light %d ep %d -> %d", idx, light->ep, on);
+
+        pending = idx;
+        pending_state = want;
+        next_light = (zb_uint8_t)((idx + 1U) % light_count);
+        return ZB_TRUE;
+    }
+    return ZB_FALSE;
+}
+
+void lights_presence_edge(void)
+{
+    zb_uint8_t i;
+
+    for (i = 0; i < light_count; i++)
+    {
+        lights[i].manual = ZB_FALSE;
+        lights[i].timeouts = 0;
+    }
+}
+
+void lights_cmd_done(zb_uint8_t param)
+{
+    zb_zcl_parsed_hdr_t *cmd_info = ZB_BUF_GET_PARAM(param, zb_zcl_parsed_hdr_t);
+    zb_zcl_default_resp_payload_t *resp = ZB_ZCL_READ_DEFAULT_RESP(param);
+
+    if (pending == LIGHTS_NONE ||
+        lights_find_short(ZB_ZCL_PARSED_HDR_SHORT_DATA(cmd_info).source.u.short_addr,
+                          ZB_ZCL_PARSED_HDR_SHORT_DATA(cmd_info).src_endpoint) != pending)
+    {
+        return;
+    }
+
+    lights[pending].state = (resp != NULL && resp->status == ZB_ZCL_STATUS_SUCCESS) ? pending_state : LIGHT_UNKNOWN;
+    lights[pending].timeouts = 0;
+    pending = LIGHTS_NONE;
+}
+
+void lights_cmd_timeout(void)
+{
+    if (pending != LIGHTS_NONE)
+    {
+        light_t *light = &lights[pending];
+
+        light->state = LIGHT_UNKNOWN;
+        if (++light->timeouts == LIGHTS_MAX_TIMEOUTS)
+        {
+            TLOG_WARNING("light %d unreachable, left until the next presence edge", pending);
+        }
+        pending = LIGHTS_NONE;
+    }
+}
+
+zb_bool_t lights_handle_read_resp(zb_uint8_t param)
+{
+    zb_zcl_parsed_hdr_t *cmd_info = ZB_BUF_GET_PARAM(param, zb_zcl_parsed_hdr_t);
+    zb_zcl_read_attr_res_t *res;
+    zb_uint8_t idx;
+
+    if (cmd_info->cluster_id != ZB_ZCL_CLUSTER_ID_ON_OFF ||
+        cmd_info->cmd_direction != ZB_ZCL_FRAME_DIRECTION_TO_CLI ||
+        cmd_info->cmd_id != ZB_ZCL_CMD_READ_ATTRIB_RESP)
+    {
+        return ZB_FALSE;
+    }
+
+    idx = lights_find_short(ZB_ZCL_PARSED_HDR_SHORT_DATA(cmd_info).source.u.short_addr,
+                            ZB_ZCL_PARSED_HDR_SHORT_DATA(cmd_info).src_endpoint);
+    ZB_ZCL_GENERAL_GET_NEXT_READ_ATTR_RES(param, res);
+    while (res != NULL && idx != LIGHTS_NONE)
+    {
+        if (res->status == ZB_ZCL_STATUS_SUCCESS && res->attr_id == ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID)
+        {
+            lights[idx].state = res->attr_value[0] ? LIGHT_ON : LIGHT_OFF;
+            lights[idx].timeouts = 0;
+        }
+        ZB_ZCL_GENERAL_GET_NEXT_READ_ATTR_RES(param, res);
+    }
+
+    zb_buf_free(param);
+    return ZB_TRUE;
+}
+
+void lights_report_cb(zb_zcl_addr_t *addr, zb_uint8_t ep, zb_uint16_t cluster_id,
+                      zb_uint16_t attr_id, zb_uint8_t attr_type, zb_uint8_t *value)
+{
+    zb_ieee_addr_t ieee;
+    zb_uint8_t idx;
+    zb_uint8_t state;
+
+    ZVUNUSED(attr_type);
+
+    if (cluster_id != ZB_ZCL_CLUSTER_ID_ON_OFF || attr_id != ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID ||
+        zb_address_ieee_by_short(addr->u.short_addr, ieee) != RET_OK)
+    {
+        return;
+    }
+
+    /* Reporting outlives our RAM: relearn lights configured before a reboot */
+    idx = lights_find(ieee, ep);
+    if (idx == LIGHTS_NONE)
+    {
+        if (!lights_add(ieee, ep))
+        {
+            return;
+        }
+        idx = lights_find(ieee, ep);
+    }
+
+    state = value[0] ? LIGHT_ON : LIGHT_OFF;
+    if (state != lights[idx].state && idx != pending && lights[idx].state != LIGHT_UNKNOWN)
+    {
+        /* Nobody asked for this change: a wall switch or another controller */
+        lights[idx].manual = ZB_TRUE;
+        TLOG_INFO("light %d switched externally -> %d", idx, state == LIGHT_ON);
+    }
+    lights[idx].state = state;
+    /* It answers again */
+    lights[idx].timeouts = 0;
+}
@@ -0,0 +1,45 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include "zboss_api.h"
+
+/* On/Off servers found by finding & binding; further ones are not bound (zb_mem_config_sensor.h) */
+#define LIGHTS_MAX                  4
+/* Reporting asked of each light: on change, and at least this often (s) */
+#define LIGHTS_REPORT_MAX_S         600U
+/* Unanswered commands in a row before a light is left alone until the next presence edge */
+#define LIGHTS_MAX_TIMEOUTS         3
+
+typedef enum {
+    LIGHT_UNKNOWN = 0,
+    LIGHT_OFF,
+    LIGHT_ON,
+} light_state_t;
+
+/* Remembers an On/Off server; call from the finding & binding callback. ZB_FALSE when the table is full */
+zb_bool_t lights_add(const zb_ieee_addr_t ieee, zb_uint8_t ep);
+/* Binds each light's On/Off reports to us, configures reporting and reads the current state */
+void lights_subscribe(void);
+zb_uint8_t lights_count(void);
+
+/*
+ * Sends On or Off to the next light that is not already in that state, was
+ * not switched by hand since the last presence edge and has not timed out
+ * LIGHTS_MAX_TIMEOUTS times in a row. Returns ZB_FALSE and leaves param
+ * alone when every light is where it should be or given up on.
+ */
+zb_bool_t lights_drive(zb_uint8_t param, zb_bool_t on);
+/* A presence edge hands control of manually switched lights back to the sensor and retries unreachable ones */
+void lights_presence_edge(void);
+/* Default response to the command sent by lights_drive(); does not consume param */
+void lights_cmd_done(zb_uint8_t param);
+/* That command got no answer: its light's state is unknown again */
+void lights_cmd_timeout(void);
+
+/* On/Off read responses; consumes param when it returns ZB_TRUE */
+zb_bool_t lights_handle_read_resp(zb_uint8_t param);
+/* Register with ZB_ZCL_SET_REPORT_ATTR_CB() */
+void lights_report_cb(zb_zcl_addr_t *addr, zb_uint8_t ep, zb_uint16_t cluster_id,
+                      zb_uint16_t attr_id, zb_uint8_t attr_type, zb_uint8_t *value);
+
+#endif /* LIGHTS_H */
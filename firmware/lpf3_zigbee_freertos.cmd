@@ -90,6 +90,18 @@ _SECONDARY_SLOT_SIZE = ti_utils_build_GenMap_MCUBOOT_APP_SLOT_SIZE;
 
 #endif // defined(OTA_ONCHIP) || defined(OTA_OFFCHIP)
 
+#if defined(OTA_ONCHIP) || defined(OTA_OFFCHIP)
+#define APP_FLASH_SIZE          FLASH_SIZE
+#else
+/* The last application sector holds the per-unit production config block   */
+/* (prodcfg.h). It is written by tools/prodcfg_gen.py, not by the build.     */
+#define PRODCFG_SIZE            0x800
+#define PRODCFG_BASE            (FLASH_BASE + FLASH_SIZE - PRODCFG_SIZE)
+#define APP_FLASH_SIZE          (FLASH_SIZE - PRODCFG_SIZE)
+
+prodcfg_block = PRODCFG_BASE;
+#endif
+
 #define NVRAM_BASE             ti_utils_build_GenMap_NVS_CONFIG_NVSINTERNAL_ZB_BASE
 #define NVRAM_SIZE             ti_utils_build_GenMap_NVS_CONFIG_NVSINTERNAL_ZB_SIZE
 
@@ -117,7 +129,7 @@ _SECONDARY_SLOT_SIZE = ti_utils_build_GenMap_MCUBOOT_APP_SLOT_SIZE;
 MEMORY
 {
     /* Application stored in and executes from internal flash */
-    FLASH (RX) : origin = FLASH_BASE, length = FLASH_SIZE
+    FLASH (RX) : origin = FLASH_BASE, length = APP_FLASH_SIZE
     NVRAM (RX) : origin = NVRAM_BASE, length = NVRAM_SIZE
     /* Application uses internal RAM for data */
     SRAM (RWX) : origin = RAM_BASE, length = RAM_SIZE
@@ -147,6 +159,8 @@ MEMORY
      * ARM memory map: https://developer.arm.com/documentation/ddi0337/e/memory-map/about-the-memory-map*/
     LOG_DATA (R) : origin = 0x90000000, length = 0x40000        /* 256 KB */
     LOG_PTR  (R) : origin = 0x94000008, length = 0x40000        /* 256 KB */
+    /* tlog format strings: their addresses are the tokens, see tlog.h */
+    TLOG_FMT (R) : origin = 0x98000000, length = 0x40000        /* 256 KB */
 }
 
 /* Section allocation in memory */
@@ -188,4 +202,5 @@ SECTIONS
 
     .log_data       :   > LOG_DATA, type = COPY
     .log_ptr        : { *(.log_ptr*) } > LOG_PTR align 4, type = COPY
+    .tlog_fmt       :   > TLOG_FMT, type = COPY
 }
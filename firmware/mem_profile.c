@@ -0,0 +1,80 @@
+#include "mem_profile.h"
+
+#ifdef ZB_MEM_PROFILE
+
+/* Stack internals: the pool counters are not in the public API */
+#include "zb_common.h"
+
+#include "tlog.h"
+
+#include <string.h>
+
+volatile mem_profile_t mem_profile;
+
+/*
+ * Fields of the ZBOSS globals (ZG) in the SDK's zb_common.h. Check them
+ * when moving to another SDK release.
+ */
+static uint16_t mem_addr_map_used(void)
+{
+    uint16_t used = 0;
+    uint16_t i;
+
+    for (i = 0; i < ZB_IEEE_ADDR_TABLE_SIZE; i++)
+    {
+        if (ZG->addr.addr_map[i].used)
+        {
+            used++;
+        }
+    }
+    return used;
+}
+
+static uint16_t mem_aps_retrans_used(void)
+{
+    uint16_t used = 0;
+    uint16_t i;
+
+    for (i = 0; i < ZB_N_APS_RETRANS_ENTRIES; i++)
+    {
+        if (ZG->aps.retrans.hash[i].state != ZB_APS_RETRANS_ENT_FREE)
+        {
+            used++;
+        }
+    }
+    return used;
+}
+
+static void mem_pool_set(mem_pool_id_t id, uint16_t used, uint16_t size)
+{
+    volatile mem_pool_t *pool = &mem_profile.pools[id];
+
+    pool->used = used;
+    pool->size = size;
+    if (used > pool->peak)
+    {
+        pool->peak = used;
+        TLOG_INFO("mem: pool %d peak %d of %d", id, used, size);
+    }
+}
+
+void mem_profile_sample(void)
+{
+    mem_profile.samples++;
+    mem_pool_set(MEM_POOL_BUFFERS, (uint16_t)(ZG->bpool.bufs_allocated[0] + ZG->bpool.bufs_allocated[1]),
+                 ZB_IOBUF_POOL_SIZE);
+    mem_pool_set(MEM_POOL_ALARMS, ZG->sched.tm_buffer_usage, ZB_SCHEDULER_Q_SIZE);
+    mem_pool_set(MEM_POOL_CALLBACKS, (uint16_t)ZB_RING_BUFFER_USED(&ZG->sched.cb_q), ZB_SCHEDULER_Q_SIZE);
+    mem_pool_set(MEM_POOL_SRC_BINDINGS, ZG->aps.binding.src_n_elements, ZB_APS_SRC_BINDING_TABLE_SIZE);
+    mem_pool_set(MEM_POOL_DST_BINDINGS, ZG->aps.binding.dst_n_elements, ZB_APS_DST_BINDING_TABLE_SIZE);
+    mem_pool_set(MEM_POOL_GROUPS, ZG->aps.group.n_groups, ZB_APS_GROUP_TABLE_SIZE);
+    mem_pool_set(MEM_POOL_ADDR_MAP, mem_addr_map_used(), ZB_IEEE_ADDR_TABLE_SIZE);
+    mem_pool_set(MEM_POOL_APS_RETRANS, mem_aps_retrans_used(), ZB_N_APS_RETRANS_ENTRIES);
+}
+
+void mem_profile_reset(void)
+{
+    memset((void *)&mem_profile, 0, sizeof(mem_profile));
+}
+
+#endif /* ZB_MEM_PROFILE */
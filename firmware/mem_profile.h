@@ -0,0 +1,54 @@
+#ifndef MEM_PROFILE_H
+#define MEM_PROFILE_H
+
+#include <stdint.h>
+
+/*
+ * Peak usage of the ZBOSS pools sized in zb_mem_config_sensor.h, collected
+ * when the firmware is built with ZB_MEM_PROFILE. mem_profile_sample() is
+ * called once a second and right after each occupancy edge has queued its
+ * commands, which is when the most buffers are held. Short-lived peaks
+ * between samples are missed. Soak long enough and leave plenty of
+ * headroom.
+ *
+ * Each new peak is logged through tlog ("mem: pool %d peak %d of %d", pool
+ * numbers as in mem_pool_id_t). The full table is in the mem_profile
+ * global, which can be read from the debugger.
+ *
+ * Without ZB_MEM_PROFILE the calls compile to nothing.
+ */
+
+typedef enum {
+    MEM_POOL_BUFFERS,
+    MEM_POOL_ALARMS,
+    MEM_POOL_CALLBACKS,
+    MEM_POOL_SRC_BINDINGS,
+    MEM_POOL_DST_BINDINGS,
+    MEM_POOL_GROUPS,
+    MEM_POOL_ADDR_MAP,
+    MEM_POOL_APS_RETRANS,
+    MEM_POOL_COUNT
+} mem_pool_id_t;
+
+typedef struct {
+    uint16_t used;                          /* At the last sample */
+    uint16_t peak;
+    uint16_t size;
+} mem_pool_t;
+
+typedef struct {
+    uint32_t samples;
+    mem_pool_t pools[MEM_POOL_COUNT];
+} mem_profile_t;
+
+#ifdef ZB_MEM_PROFILE
+extern volatile mem_profile_t mem_profile;
+
+void mem_profile_sample(void);
+void mem_profile_reset(void);
+#else
+#define mem_profile_sample()        ((void)0)
+#define mem_profile_reset()         ((void)0)
+#endif
+
+#endif /* MEM_PROFILE_H */
@@ -0,0 +1,31 @@
+#include "net_retry.h"
+#include "on_off_switch.h"
+
+#include <string.h>
+
+void net_retry_init(net_retry_t *retry)
+{
+    static const backoff_t steering = BACKOFF_INIT(NET_STEERING_BACKOFF_MS, NET_BACKOFF_CAP_MS);
+    static const backoff_t rejoin = BACKOFF_INIT(NET_REJOIN_BACKOFF_MS, NET_BACKOFF_CAP_MS);
+
+    memset(retry, 0, sizeof(*retry));
+    retry->backoff[NET_RETRY_STEERING] = steering;
+    retry->backoff[NET_RETRY_REJOIN] = rejoin;
+}
+
+uint32_t net_retry_failed(net_retry_t *retry, net_retry_op_t op, backoff_rng_t *rng, uint32_t now_s)
+{
+    uint32_t delay_ms = backoff_next_ms(&retry->backoff[op], rng);
+
+    retry->count[op]++;
+    /* Whole seconds, rounded up: the attempt is not due before this */
+    retry->next_s = now_s + (delay_ms + 999U) / 1000U;
+    return delay_ms;
+}
+
+void net_retry_joined(net_retry_t *retry)
+{
+    backoff_reset(&retry->backoff[NET_RETRY_STEERING]);
+    backoff_reset(&retry->backoff[NET_RETRY_REJOIN]);
+    retry->next_s = 0;
+}
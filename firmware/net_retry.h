@@ -0,0 +1,32 @@
+#ifndef NET_RETRY_H
+#define NET_RETRY_H
+
+#include <stdint.h>
+#include "backoff.h"
+
+/*
+ * Retries of a failed network start: steering and TC rejoin back off
+ * separately (NET_*_BACKOFF_MS in on_off_switch.h), and the counts and due
+ * time are what 0xE014-0xE016 show. Plain state with no ZBOSS calls, so the
+ * fleet simulator retries as the sensor does.
+ */
+
+typedef enum {
+    NET_RETRY_STEERING = 0,
+    NET_RETRY_REJOIN,
+    NET_RETRY_OPS
+} net_retry_op_t;
+
+typedef struct {
+    backoff_t backoff[NET_RETRY_OPS];
+    uint16_t count[NET_RETRY_OPS];  /* Retries since boot */
+    uint32_t next_s;                /* Uptime second the next attempt is due, 0 when none is pending */
+} net_retry_t;
+
+void net_retry_init(net_retry_t *retry);
+/* Counts a failed attempt of op; returns the delay before the next one */
+uint32_t net_retry_failed(net_retry_t *retry, net_retry_op_t op, backoff_rng_t *rng, uint32_t now_s);
+/* On the network again: the next failure of either starts from its base delay */
+void net_retry_joined(net_retry_t *retry);
+
+#endif /* NET_RETRY_H */
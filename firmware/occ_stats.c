@@ -0,0 +1,93 @@
+#include "occ_stats.h"
+
+#include <string.h>
+
+void occ_stats_init(occ_stats_t *stats, uint8_t occupied, uint32_t now_ms)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->occupied = occupied ? 1 : 0;
+    stats->last_ms = now_ms;
+    stats->since_ms = now_ms;
+    stats->hour_start_ms = now_ms;
+}
+
+/* Adds the time up to until_ms to the running hour */
+static void occ_stats_accrue(occ_stats_t *stats, uint32_t until_ms)
+{
+    if (stats->occupied)
+    {
+        stats->hour_ms += until_ms - stats->last_ms;
+    }
+    stats->last_ms = until_ms;
+}
+
+/* Closes the running hour into the bucket ring and the day totals */
+static void occ_stats_close_hour(occ_stats_t *stats)
+{
+    uint8_t i = stats->bucket_head;
+
+    stats->hour_s = (uint16_t)(stats->hour_ms / 1000U);
+    stats->day_s += stats->hour_s - stats->bucket_s[i];
+    stats->day_sessions = (uint16_t)(stats->day_sessions + stats->hour_sessions - stats->bucket_sessions[i]);
+    stats->bucket_s[i] = stats->hour_s;
+    stats->bucket_sessions[i] = stats->hour_sessions;
+    stats->bucket_head = (uint8_t)((i + 1U) % OCC_STATS_HOURS);
+
+    stats->hour_start_ms += OCC_STATS_HOUR_MS;
+    stats->hour_ms = 0;
+    stats->hour_sessions = 0;
+}
+
+uint8_t occ_stats_update(occ_stats_t *stats, uint8_t occupied, uint32_t now_ms)
+{
+    uint8_t changed = 0;
+    uint8_t hours = 0;
+
+    occupied = occupied ? 1 : 0;
+
+    while (now_ms - stats->hour_start_ms >= OCC_STATS_HOUR_MS)
+    {
+        occ_stats_accrue(stats, stats->hour_start_ms + OCC_STATS_HOUR_MS);
+        occ_stats_close_hour(stats);
+        changed |= OCC_STATS_HOUR_DONE;
+
+        /* After a long stall the remaining hours are all alike; a day of them clears the ring */
+        if (++hours == OCC_STATS_HOURS)
+        {
+            stats->hour_start_ms += (now_ms - stats->hour_start_ms) / OCC_STATS_HOUR_MS * OCC_STATS_HOUR_MS;
+            stats->last_ms = stats->hour_start_ms;
+            break;
+        }
+    }
+    occ_stats_accrue(stats, now_ms);
+
+    if (occupied != stats->occupied)
+    {
+        if (occupied)
+        {
+            stats->hour_sessions++;
+        }
+        else
+        {
+            uint32_t session_s = (now_ms - stats->since_ms) / 1000U;
+
+            stats->session_count++;
+            stats->session_total_s += session_s;
+            stats->session_mean_s = stats->session_total_s / stats->session_count;
+            if (session_s > stats->session_max_s)
+            {
+                stats->session_max_s = session_s;
+            }
+            changed |= OCC_STATS_SESSION_DONE;
+        }
+        stats->occupied = occupied;
+        stats->since_ms = now_ms;
+    }
+
+    return changed;
+}
+
+uint32_t occ_stats_vacant_s(const occ_stats_t *stats, uint32_t now_ms)
+{
+    return stats->occupied ? 0 : (now_ms - stats->since_ms) / 1000U;
+}
@@ -0,0 +1,48 @@
+#ifndef OCC_STATS_H
+#define OCC_STATS_H
+
+#include <stdint.h>
+
+/*
+ * Rolling occupancy statistics, kept up to date in O(1) per call: occupied
+ * time and sessions per hour in a ring of 24 hourly buckets, with running
+ * day totals that gain the hour just finished and lose the one it replaces.
+ * Hours are counted from boot, not wall-clock hours, so the figures do not
+ * depend on the Time cluster.
+ */
+
+#define OCC_STATS_HOURS             24
+#define OCC_STATS_HOUR_MS           3600000U
+
+/* occ_stats_update() result bits */
+#define OCC_STATS_HOUR_DONE         0x01    /* hour_s / day_s / day_sessions changed */
+#define OCC_STATS_SESSION_DONE      0x02    /* session_mean_s / session_max_s changed */
+
+typedef struct {
+    uint8_t occupied;
+    uint32_t last_ms;           /* Time accrued up to here */
+    uint32_t since_ms;          /* Start of the current session or vacancy */
+    uint32_t hour_start_ms;
+    uint32_t hour_ms;           /* Occupied time in the running hour */
+    uint16_t hour_sessions;     /* Sessions started in the running hour */
+    uint16_t bucket_s[OCC_STATS_HOURS];
+    uint16_t bucket_sessions[OCC_STATS_HOURS];
+    uint8_t bucket_head;        /* Oldest bucket, overwritten next */
+    uint32_t session_count;
+    uint32_t session_total_s;
+
+    /* Results */
+    uint16_t hour_s;            /* Occupied seconds in the last full hour */
+    uint32_t day_s;             /* ... in the last 24 full hours */
+    uint16_t day_sessions;      /* Sessions started in the last 24 full hours */
+    uint32_t session_mean_s;    /* Over finished sessions since boot */
+    uint32_t session_max_s;
+} occ_stats_t;
+
+void occ_stats_init(occ_stats_t *stats, uint8_t occupied, uint32_t now_ms);
+/* Call on every transition and periodically; returns OCC_STATS_* bits */
+uint8_t occ_stats_update(occ_stats_t *stats, uint8_t occupied, uint32_t now_ms);
+/* Seconds since presence last ended, 0 while occupied */
+uint32_t occ_stats_vacant_s(const occ_stats_t *stats, uint32_t now_ms);
+
+#endif /* OCC_STATS_H */
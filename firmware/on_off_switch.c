@@ -42,11 +42,6 @@
 /***** Trace related defines *****/
 #define ZB_TRACE_FILE_ID 40124
 
-/****** Application defines ******/
-#define ZB_SWITCH_ENDPOINT          10
-
-#include <ti/log/Log.h>
-
 #include "ti_zigbee_config.h"
 #include "zboss_api.h"
 #include "zb_led_button.h"
@@ -58,14 +53,46 @@
 /* for button handling */
 #include <ti/drivers/GPIO.h>
 #include "ti_drivers_config.h"
+#include "on_off_switch.h"
+#include "app_clock.h"
+#include "automation.h"
+#include "backoff.h"
+#include "ble_adv.h"
+#include "diag.h"
+#include "history.h"
+#include "lights.h"
+#include "mem_profile.h"
+#include "occ_stats.h"
+#include "prodcfg.h"
+#include "tlog.h"
+#include "profiles.h"
 #include "sensor.h"
+#include "sensor_attrs.h"
+#include "sensor_worker.h"
+#include "sensor_gpio.h"
+#include "stack_mon.h"
+#include "presence.h"
+#include "net_retry.h"
 
 #ifdef ZB_CONFIGURABLE_MEM
+#if defined ZB_ROUTER_ROLE && !defined ZB_COORDINATOR_ROLE
+/* A router holds neighbor, routing and child tables for the devices around
+ * it and relays their traffic; size the pools for the whole floor, which
+ * sim --router-build checks at this size */
+#define ZB_CONFIG_ROLE_ZR
+#define ZB_CONFIG_OVERALL_NETWORK_SIZE NET_ROUTER_NETWORK_SIZE
+#define ZB_CONFIG_HIGH_TRAFFIC
+#define ZB_CONFIG_APPLICATION_SIMPLE
 #include "zb_mem_config_lprf3.h"
+#else
+/* The end device's pools are sized for this application */
+#include "zb_mem_config_sensor.h"
+#endif
 #endif
 
-#if !defined ZB_ED_FUNC
-#error define ZB_ED_ROLE to compile the tests
+/* Builds as an end device or, on mains/USB power, as a router (zigbee.deviceType in the .syscfg) */
+#if defined ZB_COORDINATOR_ROLE || (!defined ZB_ED_FUNC && !defined ZB_ROUTER_ROLE)
+#error define ZB_ED_ROLE or ZB_ROUTER_ROLE to build the sensor
 #endif
 
 #undef ZB_USE_SLEEP
@@ -74,15 +101,22 @@
 /* IEEE address of the device */
 zb_bool_t cmd_in_progress = ZB_FALSE;
 zb_bool_t perform_factory_reset = ZB_FALSE;
+/* Guess for the binding-table fallback, used until a light is known (see lights.h) */
 static zb_bool_t light_is_on = ZB_FALSE;
 
 /****** Application function declarations ******/
 zb_uint8_t zcl_specific_cluster_cmd_handler(zb_uint8_t param);
-void on_off_read_attr_resp_handler(zb_bufid_t cmd_buf);
 void send_on_req(zb_uint8_t param);
 void send_off_req(zb_uint8_t param);
 void send_cmd_timeout(zb_uint8_t param);
 void sensor_poll_handler(zb_uint8_t param);
+void presence_changed_handler(zb_uint8_t param);
+void start_network(zb_uint8_t param);
+void net_settle_done(zb_uint8_t param);
+void sensor_presence_cb(zb_uint8_t param);
+void presence_update(zb_uint8_t param);
+void sensor_config_cb(zb_uint8_t param);
+void profile_schedule_tick(zb_uint8_t param);
 void occupancy_write_attr_hook(zb_uint8_t endpoint, zb_uint16_t attr_id,
                                zb_uint8_t *new_value, zb_uint16_t manuf_code);
 
@@ -98,7 +132,8 @@ ZB_ZCL_DECLARE_ON_OFF_SWITCH_CONFIGURATION_ATTRIB_LIST(switch_cfg_attr_list,
                                                        &attr_switch_actions);
 /* Basic cluster attributes */
 zb_uint8_t attr_zcl_version  = ZB_ZCL_BASIC_ZCL_VERSION_DEFAULT_VALUE;
-zb_uint8_t attr_power_source = ZB_ZCL_BASIC_POWER_SOURCE_DEFAULT_VALUE;
+/* The board is powered from USB-C in either role */
+zb_uint8_t attr_power_source = ZB_ZCL_BASIC_POWER_SOURCE_DC_SOURCE;
 ZB_ZCL_DECLARE_BASIC_ATTRIB_LIST(basic_attr_list, &attr_zcl_version, &attr_power_source);
 /* Identify cluster attributes */
 zb_uint16_t attr_identify_time = 0;
@@ -109,18 +144,51 @@ zb_uint8_t attr_occupancy = 0;
 zb_uint8_t attr_occ_sensor_type = ZB_ZCL_OCCUPANCY_SENSING_OCCUPANCY_SENSOR_TYPE_ULTRASONIC;
 zb_uint8_t attr_occ_sensor_type_bitmap = 0x02; /* ultrasonic bit */
 
-/* Custom sensor config attributes (IDs 0xE000-0xE008 on occupancy cluster) */
-zb_uint16_t attr_range_min_cm = 30;
-zb_uint16_t attr_range_max_cm = 600;
-zb_uint16_t attr_trig_range_cm = 300;
-zb_uint8_t  attr_trig_sensitivity = 5;
-zb_uint8_t  attr_keep_sensitivity = 5;
-zb_uint8_t  attr_trig_delay = 50;
-zb_uint16_t attr_keep_timeout = 10;
-zb_uint8_t  attr_io_polarity = 0;
-zb_uint8_t  attr_fretting = 1;
+/* Custom config attributes (IDs 0xE000-0xE00C) live in sensor_attrs_config */
+zb_uint32_t attr_flaps_suppressed = 0;
+/* Whole sensor config as one ZCL octet string: length byte + packed config */
+zb_uint8_t attr_config_snapshot[1 + SENSOR_ATTRS_SNAPSHOT_LEN] = { SENSOR_ATTRS_SNAPSHOT_LEN };
+/* Profile attributes, mirrored from the NVRAM-backed store in profiles.c */
+zb_uint8_t attr_active_profile = PROFILE_NONE;
+zb_uint8_t attr_profile_save = PROFILE_NONE;
+zb_uint8_t attr_profile_name[1 + PROFILE_NAME_LEN];
+zb_uint8_t attr_profile_schedule[1 + PROFILE_SCHEDULE_LEN * PROFILE_SCHEDULE_ENTRY_LEN];
+/* Presence cross-check between the GPIO line and the UART frames */
+zb_uint32_t attr_source_disagreements = 0;
+/* Network retries; their totals since boot and next due time are the diagnostics attributes */
+static net_retry_t net_retries;
+/* UART receive path counters, copied from sensor_get_rx_stats() */
+zb_uint32_t attr_presence_frames = 0;
+zb_uint32_t attr_presence_dropped = 0;
+/* Sequence number of the next occupancy history record, see history.h */
+zb_uint32_t attr_history_next_seq = 0;
+/* Rolling occupancy statistics, copied from occ_stats */
+zb_uint16_t attr_occ_hour_s = 0;
+zb_uint32_t attr_occ_day_s = 0;
+zb_uint16_t attr_occ_day_sessions = 0;
+zb_uint32_t attr_session_mean_s = 0;
+zb_uint32_t attr_session_max_s = 0;
+zb_uint32_t attr_vacant_s = 0;
+/* Radar settings write-back: seconds without changes before saveConfig, and
+ * 1 while settings are unsaved (writing 1 saves now) */
+zb_uint16_t attr_save_quiet_s = SENSOR_SAVE_QUIET_S;
+zb_uint8_t attr_config_commit = 0;
+/* Schedule entry applied last; the schedule only acts when this changes */
+static zb_uint8_t profile_schedule_entry = PROFILE_NONE;
+
+/* Pin level through the filter, cross-checked against the parsed presence the worker delivers */
+static presence_t presence;
+static occ_stats_t occ_stats;
+/* Boot-storm spreading, see NET_* in on_off_switch.h */
+static backoff_rng_t net_rng;
+static zb_bool_t net_settled = ZB_FALSE;
+static zb_uint32_t net_chanlist = DEFAULT_CHANLIST;
+/* Latest config read back by the sensor worker */
+static sensor_presence_config_t sensor_result_config;
 
 /* Occupancy attribute list (standard + custom) */
+#define OCC_CONFIG_ATTR(id_, type_, field_, min_, max_, cmd_) \
+  { id_, ZB_ZCL_ATTR_TYPE_##type_, ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &sensor_attrs_config.field_ },
 zb_uint16_t occ_cluster_revision = ZB_ZCL_OCCUPANCY_SENSING_CLUSTER_REVISION_DEFAULT;
 zb_zcl_attr_t occupancy_attr_list[] = {
   { ZB_ZCL_ATTR_GLOBAL_CLUSTER_REVISION_ID, ZB_ZCL_ATTR_TYPE_U16, ZB_ZCL_ATTR_ACCESS_READ_ONLY, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &occ_cluster_revision },
@@ -128,16 +196,37 @@ zb_zcl_attr_t occupancy_attr_list[] = {
   { 0x0000, ZB_ZCL_ATTR_TYPE_8BITMAP, ZB_ZCL_ATTR_ACCESS_READ_ONLY | ZB_ZCL_ATTR_ACCESS_REPORTING, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_occupancy },
   { 0x0001, ZB_ZCL_ATTR_TYPE_8BIT_ENUM, ZB_ZCL_ATTR_ACCESS_READ_ONLY, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_occ_sensor_type },
   { 0x0002, ZB_ZCL_ATTR_TYPE_8BITMAP, ZB_ZCL_ATTR_ACCESS_READ_ONLY, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_occ_sensor_type_bitmap },
-  /* Custom config attrs 0xE000-0xE008 (read/write) */
-  { 0xE000, ZB_ZCL_ATTR_TYPE_U16, ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_range_min_cm },
-  { 0xE001, ZB_ZCL_ATTR_TYPE_U16, ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_range_max_cm },
-  { 0xE002, ZB_ZCL_ATTR_TYPE_U16, ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_trig_range_cm },
-  { 0xE003, ZB_ZCL_ATTR_TYPE_U8,  ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_trig_sensitivity },
-  { 0xE004, ZB_ZCL_ATTR_TYPE_U8,  ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_keep_sensitivity },
-  { 0xE005, ZB_ZCL_ATTR_TYPE_U8,  ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_trig_delay },
-  { 0xE006, ZB_ZCL_ATTR_TYPE_U16, ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_keep_timeout },
-  { 0xE007, ZB_ZCL_ATTR_TYPE_U8,  ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_io_polarity },
-  { 0xE008, ZB_ZCL_ATTR_TYPE_BOOL,ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_fretting },
+  /* Custom config attrs 0xE000-0xE00C (read/write), generated from SENSOR_ATTRS_TABLE */
+  SENSOR_ATTRS_TABLE(OCC_CONFIG_ATTR)
+  { ATTR_FLAPS_SUPPRESSED_ID, ZB_ZCL_ATTR_TYPE_U32, ZB_ZCL_ATTR_ACCESS_READ_ONLY, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_flaps_suppressed },
+  { ATTR_CONFIG_SNAPSHOT_ID, ZB_ZCL_ATTR_TYPE_OCTET_STRING, ZB_ZCL_ATTR_ACCESS_READ_ONLY, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, attr_config_snapshot },
+  /* Config profiles */
+  { ATTR_ACTIVE_PROFILE_ID, ZB_ZCL_ATTR_TYPE_U8, ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_active_profile },
+  { ATTR_PROFILE_SAVE_ID, ZB_ZCL_ATTR_TYPE_U8, ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_profile_save },
+  { ATTR_PROFILE_NAME_ID, ZB_ZCL_ATTR_TYPE_CHAR_STRING, ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, attr_profile_name },
+  { ATTR_PROFILE_SCHEDULE_ID, ZB_ZCL_ATTR_TYPE_OCTET_STRING, ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, attr_profile_schedule },
+  { ATTR_SOURCE_DISAGREE_ID, ZB_ZCL_ATTR_TYPE_U32, ZB_ZCL_ATTR_ACCESS_READ_ONLY, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_source_disagreements },
+  /* Network retry diagnostics */
+  { ATTR_STEERING_RETRIES_ID, ZB_ZCL_ATTR_TYPE_U16, ZB_ZCL_ATTR_ACCESS_READ_ONLY, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &net_retries.count[NET_RETRY_STEERING] },
+  { ATTR_REJOIN_RETRIES_ID, ZB_ZCL_ATTR_TYPE_U16, ZB_ZCL_ATTR_ACCESS_READ_ONLY, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &net_retries.count[NET_RETRY_REJOIN] },
+  { ATTR_NEXT_RETRY_ID, ZB_ZCL_ATTR_TYPE_U32, ZB_ZCL_ATTR_ACCESS_READ_ONLY, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &net_retries.next_s },
+  /* Radar UART receive path */
+  { ATTR_PRESENCE_FRAMES_ID, ZB_ZCL_ATTR_TYPE_U32, ZB_ZCL_ATTR_ACCESS_READ_ONLY, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_presence_frames },
+  { ATTR_PRESENCE_DROPPED_ID, ZB_ZCL_ATTR_TYPE_U32, ZB_ZCL_ATTR_ACCESS_READ_ONLY, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_presence_dropped },
+  /* Occupancy history, fetched with SEN0609_CMD_GET_HISTORY */
+  { ATTR_HISTORY_NEXT_SEQ_ID, ZB_ZCL_ATTR_TYPE_U32, ZB_ZCL_ATTR_ACCESS_READ_ONLY, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_history_next_seq },
+  /* Radar settings write-back */
+  { ATTR_SAVE_QUIET_ID, ZB_ZCL_ATTR_TYPE_U16, ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_save_quiet_s },
+  { ATTR_CONFIG_COMMIT_ID, ZB_ZCL_ATTR_TYPE_U8, ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_config_commit },
+  /* Occupancy statistics, reportable with long intervals */
+  { ATTR_OCC_HOUR_S_ID, ZB_ZCL_ATTR_TYPE_U16, ZB_ZCL_ATTR_ACCESS_READ_ONLY | ZB_ZCL_ATTR_ACCESS_REPORTING, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_occ_hour_s },
+  { ATTR_OCC_DAY_S_ID, ZB_ZCL_ATTR_TYPE_U32, ZB_ZCL_ATTR_ACCESS_READ_ONLY | ZB_ZCL_ATTR_ACCESS_REPORTING, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_occ_day_s },
+  { ATTR_OCC_DAY_SESSIONS_ID, ZB_ZCL_ATTR_TYPE_U16, ZB_ZCL_ATTR_ACCESS_READ_ONLY | ZB_ZCL_ATTR_ACCESS_REPORTING, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_occ_day_sessions },
+  { ATTR_SESSION_MEAN_S_ID, ZB_ZCL_ATTR_TYPE_U32, ZB_ZCL_ATTR_ACCESS_READ_ONLY | ZB_ZCL_ATTR_ACCESS_REPORTING, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_session_mean_s },
+  { ATTR_SESSION_MAX_S_ID, ZB_ZCL_ATTR_TYPE_U32, ZB_ZCL_ATTR_ACCESS_READ_ONLY | ZB_ZCL_ATTR_ACCESS_REPORTING, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_session_max_s },
+  { ATTR_VACANT_S_ID, ZB_ZCL_ATTR_TYPE_U32, ZB_ZCL_ATTR_ACCESS_READ_ONLY | ZB_ZCL_ATTR_ACCESS_REPORTING, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, &attr_vacant_s },
+  /* Presence-to-light rules, see rules.h */
+  { ATTR_RULES_ID, ZB_ZCL_ATTR_TYPE_OCTET_STRING, ZB_ZCL_ATTR_ACCESS_READ_WRITE, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, attr_rules },
   { ZB_ZCL_NULL_ID, 0, 0, ZB_ZCL_NON_MANUFACTURER_SPECIFIC, NULL } /* terminator */
 };
 
@@ -155,100 +244,349 @@ zb_zcl_cluster_desc_t on_off_switch_clusters[] = {
   ZB_ZCL_CLUSTER_DESC(ZB_ZCL_CLUSTER_ID_OCCUPANCY_SENSING,
     ZB_ZCL_ARRAY_SIZE(occupancy_attr_list, zb_zcl_attr_t), (occupancy_attr_list),
     ZB_ZCL_CLUSTER_SERVER_ROLE, ZB_ZCL_MANUF_CODE_INVALID),
+  ZB_ZCL_CLUSTER_DESC(ZB_ZCL_CLUSTER_ID_DIAGNOSTICS,
+    ZB_ZCL_ARRAY_SIZE(diag_attr_list, zb_zcl_attr_t), (diag_attr_list),
+    ZB_ZCL_CLUSTER_SERVER_ROLE, ZB_ZCL_MANUF_CODE_INVALID),
   ZB_ZCL_CLUSTER_DESC(ZB_ZCL_CLUSTER_ID_ON_OFF,
     0, NULL, ZB_ZCL_CLUSTER_CLIENT_ROLE, ZB_ZCL_MANUF_CODE_INVALID),
+  ZB_ZCL_CLUSTER_DESC(ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL,
+    0, NULL, ZB_ZCL_CLUSTER_CLIENT_ROLE, ZB_ZCL_MANUF_CODE_INVALID),
   ZB_ZCL_CLUSTER_DESC(ZB_ZCL_CLUSTER_ID_SCENES,
     0, NULL, ZB_ZCL_CLUSTER_CLIENT_ROLE, ZB_ZCL_MANUF_CODE_INVALID),
   ZB_ZCL_CLUSTER_DESC(ZB_ZCL_CLUSTER_ID_IDENTIFY,
     0, NULL, ZB_ZCL_CLUSTER_CLIENT_ROLE, ZB_ZCL_MANUF_CODE_INVALID),
   ZB_ZCL_CLUSTER_DESC(ZB_ZCL_CLUSTER_ID_GROUPS,
     0, NULL, ZB_ZCL_CLUSTER_CLIENT_ROLE, ZB_ZCL_MANUF_CODE_INVALID),
+  ZB_ZCL_CLUSTER_DESC(ZB_ZCL_CLUSTER_ID_TIME,
+    0, NULL, ZB_ZCL_CLUSTER_CLIENT_ROLE, ZB_ZCL_MANUF_CODE_INVALID),
 };
 
 /* Declare endpoint (manual, replacing ZB_HA_DECLARE_ON_OFF_SWITCH_EP) */
-ZB_DECLARE_SIMPLE_DESC(4, 4);
-ZB_AF_SIMPLE_DESC_TYPE(4, 4) simple_desc_on_off_switch_ep = {
+ZB_DECLARE_SIMPLE_DESC(5, 6);
+ZB_AF_SIMPLE_DESC_TYPE(5, 6) simple_desc_on_off_switch_ep = {
   ZB_SWITCH_ENDPOINT,
   ZB_AF_HA_PROFILE_ID,
   ZB_HA_ON_OFF_SWITCH_DEVICE_ID,
   ZB_HA_DEVICE_VER_ON_OFF_SWITCH,
   0,
-  4, /* in_count */
-  4, /* out_count */
+  5, /* in_count */
+  6, /* out_count */
   {
     ZB_ZCL_CLUSTER_ID_BASIC,
     ZB_ZCL_CLUSTER_ID_IDENTIFY,
     ZB_ZCL_CLUSTER_ID_ON_OFF_SWITCH_CONFIG,
     ZB_ZCL_CLUSTER_ID_OCCUPANCY_SENSING,
+    ZB_ZCL_CLUSTER_ID_DIAGNOSTICS,
     ZB_ZCL_CLUSTER_ID_ON_OFF,
+    ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL,
     ZB_ZCL_CLUSTER_ID_SCENES,
     ZB_ZCL_CLUSTER_ID_GROUPS,
     ZB_ZCL_CLUSTER_ID_IDENTIFY,
+    ZB_ZCL_CLUSTER_ID_TIME,
   }
 };
-ZBOSS_DEVICE_DECLARE_REPORTING_CTX(reporting_info, 1);
+/* Occupancy, the six occupancy statistics and the reportable diagnostics */
+#define REPORTING_SLOTS (7 + DIAG_REPORTING_SLOTS)
+ZBOSS_DEVICE_DECLARE_REPORTING_CTX(reporting_info, REPORTING_SLOTS);
 ZB_AF_DECLARE_ENDPOINT_DESC(on_off_switch_ep, ZB_SWITCH_ENDPOINT, ZB_AF_HA_PROFILE_ID,
   0, NULL,
   ZB_ZCL_ARRAY_SIZE(on_off_switch_clusters, zb_zcl_cluster_desc_t),
   on_off_switch_clusters,
   (zb_af_simple_desc_1_1_t*)&simple_desc_on_off_switch_ep,
-  1, reporting_info, 0, NULL);
+  REPORTING_SLOTS, reporting_info, 0, NULL);
 
 /* Declare application's device context for single-endpoint device */
 ZB_HA_DECLARE_ON_OFF_SWITCH_CTX(on_off_switch_ctx, on_off_switch_ep);
 
-static void sync_attrs_from_sensor(void)
+void sensor_presence_cb(zb_uint8_t param)
+{
+  presence.uart = param ? 1 : 0;
+  presence_update(0);
+}
+
+static void sensor_snapshot_update(void)
+{
+  sensor_attrs_pack(&sensor_attrs_config.sensor, &attr_config_snapshot[1]);
+}
+
+void sensor_config_cb(zb_uint8_t param)
+{
+  ZVUNUSED(param);
+  sensor_attrs_config.sensor = sensor_result_config;
+  sensor_snapshot_update();
+}
+
+/* SENSOR_REQ_SAVE requests the worker has not answered yet */
+static zb_uint8_t sensor_saves_pending = 0;
+/* Waits for those answers, set by sensor_commit_then() */
+static zb_callback_t sensor_saved_cb = NULL;
+
+/* Runs the waiting callback once every save is answered, or on the timeout */
+static void sensor_commit_done(zb_uint8_t param)
 {
-  sensor_presence_config_t cfg = sensor_refresh_config();
-  attr_range_min_cm     = cfg.range_min_cm;
-  attr_range_max_cm     = cfg.range_max_cm;
-  attr_trig_range_cm    = cfg.trig_range_cm;
-  attr_trig_sensitivity = cfg.trig_sensitivity;
-  attr_keep_sensitivity = cfg.keep_sensitivity;
-  attr_trig_delay       = cfg.trig_delay;
-  attr_keep_timeout     = cfg.keep_timeout;
-  attr_io_polarity      = cfg.io_polarity;
-  attr_fretting         = cfg.fretting ? 1 : 0;
+  zb_callback_t cb = sensor_saved_cb;
+
+  if (cb == NULL)
+  {
+    return;
+  }
+  if (param)
+  {
+    TLOG_WARNING("sensor save not reported, going ahead");
+    sensor_saves_pending = 0;
+  }
+  sensor_saved_cb = NULL;
+  ZB_SCHEDULE_APP_ALARM_CANCEL(sensor_commit_done, ZB_ALARM_ANY_PARAM);
+  ZB_SCHEDULE_APP_CALLBACK(cb, 0);
+}
+
+/* Set while sensor_dispatch_events() is scheduled and has not run yet */
+static zb_bool_t sensor_dispatch_pending = ZB_FALSE;
+
+/* Scheduled by my_main_loop() once the worker has woken it; takes every queued event */
+static void sensor_dispatch_events(zb_uint8_t param)
+{
+  sensor_evt_t evt;
+
+  ZVUNUSED(param);
+  sensor_dispatch_pending = ZB_FALSE;
+  while (sensor_worker_get_event(&evt))
+  {
+    switch (evt.type)
+    {
+      case SENSOR_EVT_PRESENCE:
+        ZB_SCHEDULE_APP_CALLBACK(sensor_presence_cb, evt.presence);
+        break;
+      case SENSOR_EVT_CONFIG:
+        attr_config_commit = evt.unsaved;
+        sensor_result_config = evt.config;
+        ZB_SCHEDULE_APP_CALLBACK(sensor_config_cb, 0);
+        break;
+      case SENSOR_EVT_SAVED:
+        attr_config_commit = 0;
+        if (evt.requested && sensor_saves_pending > 0 && --sensor_saves_pending == 0 && sensor_saved_cb != NULL)
+        {
+          ZB_SCHEDULE_APP_CALLBACK(sensor_commit_done, 0);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+/* Queues a saveConfig; the worker skips it when nothing is unsaved */
+static zb_bool_t sensor_commit(void)
+{
+  sensor_req_t req = { .type = SENSOR_REQ_SAVE };
+
+  if (!sensor_worker_post(&req))
+  {
+    TLOG_WARNING("sensor busy, settings not committed");
+    return ZB_FALSE;
+  }
+  sensor_saves_pending++;
+  return ZB_TRUE;
+}
+
+/* Commits unsaved radar settings before a planned reset; cb runs once the worker reports the save,
+ * or after SENSOR_SAVE_FLUSH_MS if the report never comes */
+static void sensor_commit_then(zb_callback_t cb)
+{
+  if (!attr_config_commit || !sensor_commit())
+  {
+    ZB_SCHEDULE_APP_CALLBACK(cb, 0);
+    return;
+  }
+  sensor_saved_cb = cb;
+  ZB_SCHEDULE_APP_ALARM(sensor_commit_done, 1, ZB_MILLISECONDS_TO_BEACON_INTERVAL(SENSOR_SAVE_FLUSH_MS));
+}
+
+static void profiles_sync_attrs(void)
+{
+  attr_active_profile = profiles_get_active();
+  profiles_get_name(attr_active_profile, attr_profile_name);
+  profiles_get_schedule(attr_profile_schedule);
+}
+
+/* Switches the radar to a stored profile, sending only the settings that differ; false if nothing changed */
+static zb_bool_t profile_activate(zb_uint8_t slot)
+{
+  sensor_req_t req = { .type = SENSOR_REQ_CONFIGURE };
+
+  if (slot != PROFILE_NONE)
+  {
+    if (!profiles_get(slot, &req.config))
+    {
+      return ZB_FALSE;
+    }
+    if (!sensor_worker_post(&req))
+    {
+      TLOG_WARNING("profile %d not applied, sensor busy", slot);
+      return ZB_FALSE;
+    }
+    sensor_attrs_config.sensor = req.config;
+    sensor_snapshot_update();
+  }
+
+  TLOG_INFO("active profile %d", slot);
+  profiles_set_active(slot);
+  profiles_sync_attrs();
+  return ZB_TRUE;
+}
+
+void profile_schedule_tick(zb_uint8_t param)
+{
+  zb_uint32_t local_s;
+  zb_uint8_t entry;
+  zb_uint8_t slot;
+
+  ZVUNUSED(param);
+
+  if (app_clock_local(&local_s))
+  {
+    slot = profiles_scheduled_slot((zb_uint16_t)((local_s % 86400U) / 60U), &entry);
+    /* Act on schedule boundaries only, so a manual switch holds until the next one */
+    if (entry != profile_schedule_entry)
+    {
+      /* A switch that could not be queued is retried on the next tick */
+      if (slot == PROFILE_NONE || slot == profiles_get_active() || profile_activate(slot))
+      {
+        profile_schedule_entry = entry;
+      }
+    }
+  }
+
+  ZB_SCHEDULE_APP_ALARM(profile_schedule_tick, 0, PROFILE_SCHEDULE_TICK_S * ZB_TIME_ONE_SECOND);
+}
+
+static zb_ret_t occupancy_check_value(zb_uint16_t attr_id, zb_uint8_t endpoint, zb_uint8_t *value)
+{
+  sensor_presence_config_t cfg;
+
+  switch (attr_id)
+  {
+    case ATTR_ACTIVE_PROFILE_ID:
+      return (*value == PROFILE_NONE || profiles_get(*value, &cfg)) ? RET_OK : RET_ERROR;
+    case ATTR_PROFILE_SAVE_ID:
+      return *value < PROFILE_SLOTS ? RET_OK : RET_ERROR;
+    case ATTR_PROFILE_NAME_ID:
+      return (value[0] <= PROFILE_NAME_LEN && profiles_get_active() != PROFILE_NONE) ? RET_OK : RET_ERROR;
+    case ATTR_PROFILE_SCHEDULE_ID:
+      return profiles_check_schedule(value) ? RET_OK : RET_ERROR;
+    case ATTR_SAVE_QUIET_ID:
+      return (zb_uint16_t)(value[0] | (value[1] << 8)) <= SENSOR_SAVE_QUIET_MAX_S ? RET_OK : RET_ERROR;
+    case ATTR_CONFIG_COMMIT_ID:
+      return *value == 1 ? RET_OK : RET_ERROR;
+    case ATTR_RULES_ID:
+      return automation_check(value) ? RET_OK : RET_ERROR;
+    default:
+      return sensor_attrs_check_value(attr_id, endpoint, value);
+  }
 }
 
 void occupancy_write_attr_hook(zb_uint8_t endpoint, zb_uint16_t attr_id,
                                zb_uint8_t *new_value, zb_uint16_t manuf_code)
 {
+  const sensor_attr_desc_t *desc = sensor_attrs_find(attr_id);
+
   ZVUNUSED(endpoint);
   ZVUNUSED(manuf_code);
 
-  Log_printf(LogModule_Zigbee_App, Log_INFO, "write_attr_hook: attr_id=0x%04x", attr_id);
-
-  switch (attr_id) {
-    case 0xE000: case 0xE001: case 0xE002:
-      Log_printf(LogModule_Zigbee_App, Log_INFO, "set_range: min=%d max=%d trig=%d",
-                 attr_range_min_cm, attr_range_max_cm, attr_trig_range_cm);
-      sensor_set_range(attr_range_min_cm, attr_range_max_cm, attr_trig_range_cm);
-      break;
-    case 0xE003: case 0xE004:
-      Log_printf(LogModule_Zigbee_App, Log_INFO, "set_sensitivity: trig=%d keep=%d",
-                 attr_trig_sensitivity, attr_keep_sensitivity);
-      sensor_set_sensitivity(attr_trig_sensitivity, attr_keep_sensitivity);
-      break;
-    case 0xE005: case 0xE006:
-      Log_printf(LogModule_Zigbee_App, Log_INFO, "set_latency: trig_delay=%d keep_timeout=%d",
-                 attr_trig_delay, attr_keep_timeout);
-      sensor_set_latency(attr_trig_delay, attr_keep_timeout);
-      break;
-    case 0xE007:
-      Log_printf(LogModule_Zigbee_App, Log_INFO, "set_io_polarity: %d", attr_io_polarity);
-      sensor_set_io_polarity(attr_io_polarity);
-      break;
-    case 0xE008:
-      Log_printf(LogModule_Zigbee_App, Log_INFO, "set_fretting: %d", attr_fretting);
-      sensor_set_fretting(attr_fretting ? ZB_TRUE : ZB_FALSE);
-      break;
-    default:
-      Log_printf(LogModule_Zigbee_App, Log_WARNING, "write_attr_hook: unhandled attr 0x%04x", attr_id);
+  /* Values were already checked by occupancy_check_value() */
+  switch (attr_id)
+  {
+    case ATTR_ACTIVE_PROFILE_ID:
+      profile_activate(*new_value);
+      return;
+    case ATTR_PROFILE_SAVE_ID:
+      profiles_save(*new_value, &sensor_attrs_config.sensor);
+      profiles_sync_attrs();
+      return;
+    case ATTR_PROFILE_NAME_ID:
+      profiles_set_name(profiles_get_active(), new_value);
+      return;
+    case ATTR_PROFILE_SCHEDULE_ID:
+      profiles_set_schedule(new_value);
+      profile_schedule_entry = PROFILE_NONE;
+      return;
+    case ATTR_SAVE_QUIET_ID:
+    {
+      sensor_req_t req = { .type = SENSOR_REQ_SAVE_QUIET, .save_quiet_s = (zb_uint16_t)(new_value[0] | (new_value[1] << 8)) };
+      if (!sensor_worker_post(&req))
+      {
+        TLOG_WARNING("write_attr_hook: sensor busy, save quiet period not applied");
+      }
+      return;
+    }
+    case ATTR_CONFIG_COMMIT_ID:
+      sensor_commit();
       return;
+    case ATTR_RULES_ID:
+      automation_set(new_value);
+      return;
+    default:
+      break;
+  }
+
+  if (desc == NULL)
+  {
+    TLOG_WARNING("write_attr_hook: unhandled attr 0x%04x", attr_id);
+    return;
+  }
+
+  TLOG_INFO("write_attr_hook: attr_id=0x%04x cmd=%d", attr_id, desc->cmd);
+
+  sensor_attrs_store(desc, new_value);
+
+  if (desc->cmd == SENSOR_CMD_NONE)
+  {
+    /* Filter lives on the MCU, nothing to read back from the sensor */
+    presence_filter_set_config(&presence.filter, &sensor_attrs_config.filter);
+    ZB_SCHEDULE_APP_CALLBACK(presence_update, 0);
+    return;
   }
 
-  sync_attrs_from_sensor();
+  sensor_snapshot_update();
+
+  sensor_req_t req = { .type = SENSOR_REQ_APPLY, .cmd = desc->cmd };
+  req.config = sensor_attrs_config.sensor;
+  if (!sensor_worker_post(&req))
+  {
+    TLOG_WARNING("write_attr_hook: sensor busy, attr 0x%04x not applied", attr_id);
+  }
+}
+
+/* Counts each disagreement between the two presence sources that outlasts the UART lag */
+/*
+ * Runs on a pin edge, on a change of the parsed presence, and again while
+ * the filter or the cross-check has a change pending
+ */
+void presence_update(zb_uint8_t param)
+{
+  zb_uint8_t pin = sensor_gpio_level() == sensor_attrs_config.sensor.io_polarity ? 1 : 0;
+  zb_uint32_t disagreements = presence.disagreements;
+  zb_uint32_t recheck_ms;
+  zb_uint8_t changed;
+
+  ZVUNUSED(param);
+  ZB_SCHEDULE_APP_ALARM_CANCEL(presence_update, ZB_ALARM_ANY_PARAM);
+  changed = presence_step(&presence, pin, app_time_ms(), &recheck_ms);
+
+  if (presence.disagreements != disagreements)
+  {
+    attr_source_disagreements = presence.disagreements;
+    TLOG_WARNING("presence sources disagree: gpio=%d uart=%d", pin, presence.uart);
+  }
+  /* Act on the edge now instead of at the next 1 s poll, once the network has settled */
+  if (changed && zb_zdo_joined() && net_settled)
+  {
+    ZB_SCHEDULE_APP_CALLBACK(presence_changed_handler, 0);
+  }
+  if (recheck_ms != 0)
+  {
+    ZB_SCHEDULE_APP_ALARM(presence_update, 0, ZB_MILLISECONDS_TO_BEACON_INTERVAL(recheck_ms));
+  }
 }
 
 void my_main_loop()
@@ -256,8 +594,18 @@ void my_main_loop()
   while (1)
   {
     /* ... User code ... */
+    /* Blocks while the stack is idle; the worker and the pin interrupt end the wait with stack_wake() */
     zboss_main_loop_iteration();
-    sensor_poll();
+    if (!sensor_dispatch_pending && sensor_worker_has_events())
+    {
+      sensor_dispatch_pending = ZB_TRUE;
+      ZB_SCHEDULE_APP_CALLBACK(sensor_dispatch_events, 0);
+    }
+    /* Woken by the pin interrupt */
+    if (sensor_gpio_take_edge())
+    {
+      ZB_SCHEDULE_APP_CALLBACK(presence_update, 0);
+    }
     /* ... User code ... */
   }
 }
@@ -280,8 +628,18 @@ MAIN()
   zb_set_long_address(ieee_mac_addr);
   #endif // ZB_LONG_ADDR
 
+  {
+    zb_ieee_addr_t own_addr;
+    zb_get_long_address(own_addr);
+    backoff_rng_seed(&net_rng, own_addr);
+  }
+  net_retry_init(&net_retries);
+
+  /* A production config block narrows steering to its channels */
+  net_chanlist = prodcfg_channel_mask(DEFAULT_CHANLIST);
+
 #ifdef ZB_COORDINATOR_ROLE
-  zb_set_network_coordinator_role(DEFAULT_CHANLIST);
+  zb_set_network_coordinator_role(net_chanlist);
 
   /* Set keepalive mode to mac data poll so sleepy zeds consume less power */
   zb_set_keepalive_mode(MAC_DATA_POLL_KEEPALIVE);
@@ -295,7 +653,7 @@ MAIN()
 #endif //ZBOSS_REV23
 
 #elif defined ZB_ROUTER_ROLE && !defined ZB_COORDINATOR_ROLE
-  zb_set_network_router_role(DEFAULT_CHANLIST);
+  zb_set_network_router_role(net_chanlist);
 
 #ifdef ZBOSS_REV23
   zb_nwk_set_max_ed_capacity(MAX_ED_CAPACITY);
@@ -305,7 +663,7 @@ MAIN()
   zb_set_keepalive_mode(MAC_DATA_POLL_KEEPALIVE);
 
 #elif defined ZB_ED_ROLE
-  zb_set_network_ed_role(DEFAULT_CHANLIST);
+  zb_set_network_ed_role(net_chanlist);
 
   /* Set end-device configuration parameters */
   zb_set_ed_timeout(ED_TIMEOUT_VALUE);
@@ -321,19 +679,28 @@ MAIN()
 #endif //ZB_ED_ROLE
 
   zb_set_nvram_erase_at_start(ZB_FALSE);
+  prodcfg_apply();
+  profiles_init();
+  history_init();
+  automation_init();
+  ble_adv_init();
+  /* MAIN() runs on the ZBOSS thread */
+  stack_mon_init();
 
   /* Register device ZCL context */
   ZB_AF_REGISTER_DEVICE_CTX(&on_off_switch_ctx);
+  /* On/Off reports from bound lights keep their cached state current */
+  ZB_ZCL_SET_REPORT_ATTR_CB(lights_report_cb);
   /* Register write-attribute hook for occupancy cluster custom attrs */
   zb_zcl_add_cluster_handlers(ZB_ZCL_CLUSTER_ID_OCCUPANCY_SENSING,
-    ZB_ZCL_CLUSTER_SERVER_ROLE, NULL, occupancy_write_attr_hook, NULL);
+    ZB_ZCL_CLUSTER_SERVER_ROLE, occupancy_check_value, occupancy_write_attr_hook, NULL);
   /* Register cluster commands handler for a specific endpoint */
   ZB_AF_SET_ENDPOINT_HANDLER(ZB_SWITCH_ENDPOINT, zcl_specific_cluster_cmd_handler);
 
   /* Initiate the stack start without starting the commissioning */
   if (zboss_start_no_autostart() != RET_OK)
   {
-    Log_printf(LogModule_Zigbee_App, Log_ERROR, "zboss_start failed");
+    TLOG_ERROR("zboss_start failed");
   }
   else
   {
@@ -344,11 +711,23 @@ MAIN()
     if (sideButtonPressed)
     {
       perform_factory_reset = ZB_TRUE;
-      Log_printf(LogModule_Zigbee_App, Log_INFO, "perform factory reset");
+      TLOG_INFO("perform factory reset");
     }
 
-    sensor_init();
-    sync_attrs_from_sensor();
+    /* Profiles were loaded from NVRAM by zboss_start_no_autostart() */
+    profiles_get(profiles_get_active(), &sensor_attrs_config.sensor);
+    profiles_sync_attrs();
+
+    sensor_worker_start(&sensor_attrs_config.sensor);
+    sensor_snapshot_update();
+    sensor_gpio_start();
+
+    app_uptime_tick(0);
+    presence_init(&presence, 0, app_time_ms());
+    occ_stats_init(&occ_stats, 0, app_time_ms());
+    presence_filter_set_config(&presence.filter, &sensor_attrs_config.filter);
+    /* The pin may already be set; after this only its edges run the filter */
+    ZB_SCHEDULE_APP_CALLBACK(presence_update, 0);
 
     /* Call the application-specific main loop */
     my_main_loop();
@@ -357,6 +736,16 @@ MAIN()
   MAIN_RETURN(0);
 }
 
+static void prodcfg_bound(const zb_ieee_addr_t ieee, zb_uint8_t ep, zb_uint16_t cluster_id)
+{
+  if (cluster_id == ZB_ZCL_CLUSTER_ID_ON_OFF)
+  {
+    lights_add(ieee, ep);
+  }
+}
+
+/* Binds only the clusters the application sends on, and only to lights the table holds;
+ * the binding tables are sized for that (zb_mem_config_sensor.h) */
 static zb_bool_t finding_binding_cb(zb_int16_t status,
                                     zb_ieee_addr_t addr,
                                     zb_uint8_t ep,
@@ -364,12 +753,111 @@ static zb_bool_t finding_binding_cb(zb_int16_t status,
 {
   /* Unused without trace. */
   ZVUNUSED(status);
-  ZVUNUSED(addr);
-  ZVUNUSED(ep);
-  ZVUNUSED(cluster);
 
-  Log_printf(LogModule_Zigbee_App, Log_INFO, "finding_binding_cb status %d addr %x ep %d cluster %d",
-             status, ((zb_uint32_t *)addr)[0], ep, cluster);
+  TLOG_INFO("finding_binding_cb status %d addr %x ep %d cluster %d",
+            status, ((zb_uint32_t *)addr)[0], ep, cluster);
+  switch (cluster)
+  {
+    case ZB_ZCL_CLUSTER_ID_ON_OFF:
+    case ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL:
+    case ZB_ZCL_CLUSTER_ID_SCENES:
+      /* Level Control and Scenes servers come with On/Off, so each of them is a light */
+      return lights_add(addr, ep);
+    default:
+      /* Identify, Groups and Time: nothing is sent on them through a binding */
+      return ZB_FALSE;
+  }
+}
+
+/* Applies a packed sensor_presence_config_t as one sensor transaction */
+static zb_uint8_t occupancy_set_config_handler(zb_uint8_t param)
+{
+  zb_uint8_t *payload = zb_buf_begin(param);
+  sensor_req_t req = { .type = SENSOR_REQ_CONFIGURE };
+
+  req.config = sensor_attrs_config.sensor;
+
+  if (zb_buf_len(param) < 1 + SENSOR_ATTRS_SNAPSHOT_LEN || payload[0] != SENSOR_ATTRS_SNAPSHOT_LEN)
+  {
+    return ZB_ZCL_STATUS_MALFORMED_CMD;
+  }
+  if (!sensor_attrs_unpack(&payload[1], &req.config))
+  {
+    return ZB_ZCL_STATUS_INVALID_VALUE;
+  }
+  if (!sensor_worker_post(&req))
+  {
+    return ZB_ZCL_STATUS_FAIL;
+  }
+
+  sensor_attrs_config.sensor = req.config;
+  sensor_snapshot_update();
+  return ZB_ZCL_STATUS_SUCCESS;
+}
+
+/* Answers SEN0609_CMD_GET_HISTORY in param with one SEN0609_CMD_HISTORY chunk */
+static void occupancy_send_history(zb_uint8_t param, const zb_zcl_parsed_hdr_t *cmd_info)
+{
+  zb_uint8_t *payload = zb_buf_begin(param);
+  zb_uint32_t since_seq = (zb_uint32_t)payload[0] | (zb_uint32_t)payload[1] << 8 |
+                          (zb_uint32_t)payload[2] << 16 | (zb_uint32_t)payload[3] << 24;
+  history_chunk_t chunk;
+  zb_uint32_t utc_s;
+  zb_uint8_t *cmd_ptr;
+
+  history_read(since_seq, app_time_ms(), app_clock_utc(&utc_s) ? &utc_s : NULL, &chunk);
+  TLOG_INFO("history since %d: %d records from %d, more %d", since_seq, chunk.count, chunk.first_seq, chunk.more);
+
+  cmd_ptr = ZB_ZCL_START_PACKET(param);
+  ZB_ZCL_CONSTRUCT_SPECIFIC_COMMAND_RES_FRAME_CONTROL_A(cmd_ptr, ZB_ZCL_FRAME_DIRECTION_TO_CLI,
+    ZB_ZCL_MANUFACTURER_SPECIFIC);
+  ZB_ZCL_CONSTRUCT_COMMAND_HEADER_EXT(cmd_ptr, cmd_info->seq_number, ZB_TRUE, SEN0609_MANUF_CODE,
+    SEN0609_CMD_HISTORY);
+  ZB_ZCL_PACKET_PUT_DATA32_VAL(cmd_ptr, chunk.first_seq);
+  ZB_ZCL_PACKET_PUT_DATA8(cmd_ptr, chunk.count);
+  ZB_ZCL_PACKET_PUT_DATA8(cmd_ptr, chunk.more);
+  ZB_ZCL_PACKET_PUT_DATA32_VAL(cmd_ptr, chunk.last_age_ds);
+  ZB_ZCL_PACKET_PUT_DATA8(cmd_ptr, chunk.len);
+  ZB_ZCL_PACKET_PUT_DATA_N(cmd_ptr, chunk.data, chunk.len);
+  ZB_ZCL_FINISH_PACKET(param, cmd_ptr)
+  ZB_ZCL_SEND_COMMAND_SHORT(param, ZB_ZCL_PARSED_HDR_SHORT_DATA(cmd_info).source.u.short_addr,
+    ZB_APS_ADDR_MODE_16_ENDP_PRESENT, ZB_ZCL_PARSED_HDR_SHORT_DATA(cmd_info).src_endpoint,
+    ZB_SWITCH_ENDPOINT, ZB_AF_HA_PROFILE_ID, ZB_ZCL_CLUSTER_ID_OCCUPANCY_SENSING, NULL);
+}
+
+static zb_bool_t occupancy_manuf_cmd_handler(zb_uint8_t param)
+{
+  zb_zcl_parsed_hdr_t cmd_info = *ZB_BUF_GET_PARAM(param, zb_zcl_parsed_hdr_t);
+  zb_uint8_t status;
+
+  if (cmd_info.cluster_id != ZB_ZCL_CLUSTER_ID_OCCUPANCY_SENSING ||
+      cmd_info.cmd_direction != ZB_ZCL_FRAME_DIRECTION_TO_SRV ||
+      !cmd_info.is_manuf_specific || cmd_info.manuf_specific != SEN0609_MANUF_CODE)
+  {
+    return ZB_FALSE;
+  }
+
+  switch (cmd_info.cmd_id)
+  {
+    case SEN0609_CMD_SET_CONFIG:
+      status = occupancy_set_config_handler(param);
+      break;
+    case SEN0609_CMD_GET_HISTORY:
+      /* The history chunk is the response, no default response */
+      if (zb_buf_len(param) >= sizeof(zb_uint32_t))
+      {
+        occupancy_send_history(param, &cmd_info);
+        return ZB_TRUE;
+      }
+      status = ZB_ZCL_STATUS_MALFORMED_CMD;
+      break;
+    default:
+      status = ZB_ZCL_STATUS_UNSUP_MANUF_CLUST_CMD;
+      break;
+  }
+
+  TLOG_INFO("manuf cmd 0x%02x status 0x%02x", cmd_info.cmd_id, status);
+  zb_zcl_send_default_handler(param, &cmd_info, status);
   return ZB_TRUE;
 }
 
@@ -378,32 +866,51 @@ zb_uint8_t zcl_specific_cluster_cmd_handler(zb_uint8_t param)
   zb_zcl_parsed_hdr_t *cmd_info = ZB_BUF_GET_PARAM(param, zb_zcl_parsed_hdr_t);
   zb_bool_t unknown_cmd_received = ZB_TRUE;
 
-  Log_printf(LogModule_Zigbee_App, Log_INFO, "> zcl_specific_cluster_cmd_handler %i", param);
-  Log_printf(LogModule_Zigbee_App, Log_INFO, "payload size: %i", zb_buf_len(param));
+  TLOG_DEBUG("zcl cmd %d: cluster 0x%04x cmd 0x%02x len %d",
+             param, cmd_info->cluster_id, cmd_info->cmd_id, zb_buf_len(param));
 
-  if (cmd_info->cmd_direction == ZB_ZCL_FRAME_DIRECTION_TO_CLI)
+  if (occupancy_manuf_cmd_handler(param) || app_clock_handle_read_resp(param) ||
+      lights_handle_read_resp(param))
   {
-    if (cmd_info->cmd_id == ZB_ZCL_CMD_DEFAULT_RESP)
+    unknown_cmd_received = ZB_FALSE;
+  }
+  else if (cmd_info->cmd_direction == ZB_ZCL_FRAME_DIRECTION_TO_CLI)
+  {
+    if (cmd_info->cmd_id == ZB_ZCL_CMD_DEFAULT_RESP && cmd_info->cluster_id == ZB_ZCL_CLUSTER_ID_ON_OFF)
     {
       unknown_cmd_received = ZB_FALSE;
 
+      lights_cmd_done(param);
       cmd_in_progress = ZB_FALSE;
       ZB_SCHEDULE_APP_ALARM_CANCEL(send_cmd_timeout, ZB_ALARM_ANY_PARAM);
 
       zb_buf_free(param);
+
+      /* Move on to the next light that needs the command without waiting for the poll */
+      if (lights_count() > 1 && net_settled)
+      {
+        ZB_SCHEDULE_APP_CALLBACK(presence_changed_handler, 0);
+      }
     }
   }
 
-  Log_printf(LogModule_Zigbee_App, Log_INFO, "< zcl_specific_cluster_cmd_handler %i", param);
   return ! unknown_cmd_received;
 }
 
 void send_cmd_timeout(zb_uint8_t param)
 {
   ZVUNUSED(param);
-  Log_printf(LogModule_Zigbee_App, Log_WARNING, "send command timed out, clearing cmd_in_progress");
+  TLOG_WARNING("send command timed out, clearing cmd_in_progress");
   cmd_in_progress = ZB_FALSE;
-  light_is_on = !light_is_on;
+  diag_cmd_timeout();
+  if (lights_count() > 0)
+  {
+    lights_cmd_timeout();
+  }
+  else
+  {
+    light_is_on = !light_is_on;
+  }
 }
 
 void send_on_req(zb_uint8_t param)
@@ -415,7 +922,7 @@ void send_on_req(zb_uint8_t param)
   if (ZB_JOINED() && !cmd_in_progress)
   {
     cmd_in_progress = ZB_TRUE;
-    Log_printf(LogModule_Zigbee_App, Log_INFO, "send_on_req %d", param);
+    TLOG_INFO("send_on_req %d", param);
 
     ZB_SCHEDULE_APP_ALARM(send_cmd_timeout, 0, 5 * ZB_TIME_ONE_SECOND);
 
@@ -432,7 +939,7 @@ void send_on_req(zb_uint8_t param)
   }
   else
   {
-    Log_printf(LogModule_Zigbee_App, Log_INFO, "send_on_req %d - not joined or busy", param);
+    TLOG_INFO("send_on_req %d - not joined or busy", param);
     zb_buf_free(param);
   }
 }
@@ -446,7 +953,7 @@ void send_off_req(zb_uint8_t param)
   if (ZB_JOINED() && !cmd_in_progress)
   {
     cmd_in_progress = ZB_TRUE;
-    Log_printf(LogModule_Zigbee_App, Log_INFO, "send_off_req %d", param);
+    TLOG_INFO("send_off_req %d", param);
 
     ZB_SCHEDULE_APP_ALARM(send_cmd_timeout, 0, 5 * ZB_TIME_ONE_SECOND);
 
@@ -463,7 +970,7 @@ void send_off_req(zb_uint8_t param)
   }
   else
   {
-    Log_printf(LogModule_Zigbee_App, Log_INFO, "send_off_req %d - not joined or busy", param);
+    TLOG_INFO("send_off_req %d - not joined or busy", param);
     zb_buf_free(param);
   }
 }
@@ -474,69 +981,153 @@ void restart_commissioning(zb_uint8_t param)
   bdb_start_top_level_commissioning(ZB_BDB_NETWORK_STEERING);
 }
 
-void sensor_poll_handler(zb_uint8_t param)
+/* Sets a statistics attribute through ZCL so a change can trigger its report */
+static void occupancy_stats_set(zb_uint16_t attr_id, void *attr)
 {
-  if (!param)
+  ZB_ZCL_SET_ATTRIBUTE(ZB_SWITCH_ENDPOINT, ZB_ZCL_CLUSTER_ID_OCCUPANCY_SENSING,
+    ZB_ZCL_CLUSTER_SERVER_ROLE, attr_id, (zb_uint8_t *)attr, ZB_FALSE);
+}
+
+/* Copies the statistics that changed; the aggregates only move when an hour or a session ends */
+static void occupancy_stats_update(zb_uint8_t occupied)
+{
+  zb_uint32_t now_ms = app_time_ms();
+  zb_uint8_t changed = occ_stats_update(&occ_stats, occupied, now_ms);
+
+  if (changed & OCC_STATS_HOUR_DONE)
   {
-    if(zb_buf_is_oom_state())
-    {
-      Log_printf(LogModule_Zigbee_App, Log_WARNING, "OOM state in sensor_poll_handler");
-      while (1) {};
-    }
-    /* Button is pressed, gets buffer for outgoing command */
-    zb_buf_get_out_delayed(sensor_poll_handler);
+    attr_occ_hour_s = occ_stats.hour_s;
+    attr_occ_day_s = occ_stats.day_s;
+    attr_occ_day_sessions = occ_stats.day_sessions;
+    occupancy_stats_set(ATTR_OCC_HOUR_S_ID, &attr_occ_hour_s);
+    occupancy_stats_set(ATTR_OCC_DAY_S_ID, &attr_occ_day_s);
+    occupancy_stats_set(ATTR_OCC_DAY_SESSIONS_ID, &attr_occ_day_sessions);
   }
-  else
+  if (changed & OCC_STATS_SESSION_DONE)
   {
-    /* Update occupancy attribute */
-    zb_uint8_t new_occ = sensor_get_presence() ? 1 : 0;
-    if (new_occ != attr_occupancy) {
-      attr_occupancy = new_occ;
-      ZB_ZCL_SET_ATTRIBUTE(ZB_SWITCH_ENDPOINT, ZB_ZCL_CLUSTER_ID_OCCUPANCY_SENSING,
-        ZB_ZCL_CLUSTER_SERVER_ROLE, ZB_ZCL_ATTR_OCCUPANCY_SENSING_OCCUPANCY_ID,
-        &attr_occupancy, ZB_FALSE);
-    }
+    attr_session_mean_s = occ_stats.session_mean_s;
+    attr_session_max_s = occ_stats.session_max_s;
+    occupancy_stats_set(ATTR_SESSION_MEAN_S_ID, &attr_session_mean_s);
+    occupancy_stats_set(ATTR_SESSION_MAX_S_ID, &attr_session_max_s);
+  }
+  /* Ticks every second while vacant; set through ZCL so the reportable change (sen0609.js) applies */
+  attr_vacant_s = occ_stats_vacant_s(&occ_stats, now_ms);
+  occupancy_stats_set(ATTR_VACANT_S_ID, &attr_vacant_s);
+}
 
-    if (sensor_get_presence() && !light_is_on && !cmd_in_progress)
-    {
-      send_on_req(param);
-    }
-    else if (!sensor_get_presence() && light_is_on && !cmd_in_progress)
+/* Pushes the filtered presence state to the occupancy attribute and the light; consumes param */
+static void occupancy_update(zb_uint8_t param)
+{
+  zb_bool_t present = presence.filter.output ? ZB_TRUE : ZB_FALSE;
+  zb_uint8_t new_occ = present ? 1 : 0;
+  zb_uint8_t want = present ? RULES_LIGHT_ON : RULES_LIGHT_OFF;
+  attr_flaps_suppressed = presence.filter.suppressed;
+  attr_presence_frames = sensor_get_rx_stats()->presence_frames;
+  attr_presence_dropped = sensor_get_rx_stats()->presence_dropped;
+  occupancy_stats_update(new_occ);
+  /* Ahead of the Zigbee report: BLE listeners get the edge without a route */
+  ble_adv_update(new_occ);
+  if (new_occ != attr_occupancy) {
+    attr_occupancy = new_occ;
+    ZB_ZCL_SET_ATTRIBUTE(ZB_SWITCH_ENDPOINT, ZB_ZCL_CLUSTER_ID_OCCUPANCY_SENSING,
+      ZB_ZCL_CLUSTER_SERVER_ROLE, ZB_ZCL_ATTR_OCCUPANCY_SENSING_OCCUPANCY_ID,
+      &attr_occupancy, ZB_FALSE);
+    lights_presence_edge();
+
+    zb_uint32_t utc_s;
+    history_record(new_occ, app_time_ms(), app_clock_utc(&utc_s) ? &utc_s : NULL);
+    attr_history_next_seq = history_next_seq();
+  }
+
+  /* A rule table replaces "on while occupied"; until a rule fires the lights are left alone */
+  if (automation_active())
+  {
+    want = automation_update(new_occ);
+  }
+
+  if (want == RULES_LIGHT_UNKNOWN)
+  {
+    zb_buf_free(param);
+  }
+  else if (lights_count() > 0)
+  {
+    /* Known lights: command only those not already in the wanted state */
+    if (ZB_JOINED() && !cmd_in_progress && lights_drive(param, want == RULES_LIGHT_ON))
     {
-      send_off_req(param);
+      cmd_in_progress = ZB_TRUE;
+      ZB_SCHEDULE_APP_ALARM(send_cmd_timeout, 0, 5 * ZB_TIME_ONE_SECOND);
     }
     else
     {
       zb_buf_free(param);
     }
+  }
+  else if (want == RULES_LIGHT_ON && !light_is_on && !cmd_in_progress)
+  {
+    send_on_req(param);
+  }
+  else if (want == RULES_LIGHT_OFF && light_is_on && !cmd_in_progress)
+  {
+    send_off_req(param);
+  }
+  else
+  {
+    zb_buf_free(param);
+  }
+}
 
-    ZB_SCHEDULE_APP_ALARM(sensor_poll_handler, 0, 1 * ZB_TIME_ONE_SECOND);
+/* One-shot fast path for a filtered presence edge; the 1 s poll keeps running */
+void presence_changed_handler(zb_uint8_t param)
+{
+  if (!param)
+  {
+    zb_buf_get_out_delayed(presence_changed_handler);
+  }
+  else
+  {
+    occupancy_update(param);
+    /* The edge's commands are queued: the most buffers are held now */
+    mem_profile_sample();
   }
 }
 
-void permit_joining_cb(zb_uint8_t param)
+void sensor_poll_handler(zb_uint8_t param)
 {
-  Log_printf(LogModule_Zigbee_App, Log_INFO, "permit joining done");
-  zb_buf_free(param);
+  if (!param)
+  {
+    if(zb_buf_is_oom_state())
+    {
+      TLOG_WARNING("OOM state in sensor_poll_handler");
+      while (1) {};
+    }
+    /* Button is pressed, gets buffer for outgoing command */
+    zb_buf_get_out_delayed(sensor_poll_handler);
+  }
+  else
+  {
+    occupancy_update(param);
+    diag_poll();
+    ZB_SCHEDULE_APP_ALARM(sensor_poll_handler, 0, 1 * ZB_TIME_ONE_SECOND);
+  }
 }
 
 void start_finding_binding(zb_uint8_t param)
 {
   ZVUNUSED(param);
 
-  Log_printf(LogModule_Zigbee_App, Log_INFO, "Successful steering, start f&b initiator");
+  TLOG_INFO("Successful steering, start f&b initiator");
   zb_bdb_finding_binding_initiator(ZB_SWITCH_ENDPOINT, finding_binding_cb);
 }
 
 void set_tx_power(zb_int8_t power)
 {
-  zb_uint32_t chanlist = DEFAULT_CHANLIST;
+  zb_uint32_t chanlist = net_chanlist;
   for (zb_uint8_t i = 0; i < 32; i++) {
     if (chanlist & (1U << i)) {
       zb_bufid_t buf = zb_buf_get_out();
       if (!buf)
       {
-        Log_printf(LogModule_Zigbee_App, Log_WARNING, "no buffer available");
+        TLOG_WARNING("no buffer available");
         return;
       }
 
@@ -552,13 +1143,63 @@ void set_tx_power(zb_int8_t power)
   }
 }
 
+/* (Re)arms the periodic application work once the device is on a network */
+static void start_app_alarms(void)
+{
+  /* Until the settle window ends only the jittered poll sends anything */
+  net_settled = ZB_FALSE;
+  ZB_SCHEDULE_APP_ALARM_CANCEL(net_settle_done, ZB_ALARM_ANY_PARAM);
+  ZB_SCHEDULE_APP_ALARM(net_settle_done, 0, ZB_MILLISECONDS_TO_BEACON_INTERVAL(NET_SETTLE_MS));
+  ZB_SCHEDULE_APP_ALARM_CANCEL(sensor_poll_handler, ZB_ALARM_ANY_PARAM);
+  ZB_SCHEDULE_APP_ALARM(sensor_poll_handler, 0,
+    1 * ZB_TIME_ONE_SECOND + ZB_MILLISECONDS_TO_BEACON_INTERVAL(backoff_jitter_ms(&net_rng, NET_SETTLE_MS)));
+  ZB_SCHEDULE_APP_ALARM_CANCEL(app_clock_sync, ZB_ALARM_ANY_PARAM);
+  ZB_SCHEDULE_APP_ALARM(app_clock_sync, 0,
+    2 * ZB_TIME_ONE_SECOND + ZB_MILLISECONDS_TO_BEACON_INTERVAL(backoff_jitter_ms(&net_rng, NET_CLOCK_JITTER_MS)));
+  ZB_SCHEDULE_APP_ALARM_CANCEL(diag_refresh, ZB_ALARM_ANY_PARAM);
+  ZB_SCHEDULE_APP_ALARM(diag_refresh, 0,
+    ZB_MILLISECONDS_TO_BEACON_INTERVAL(backoff_jitter_ms(&net_rng, DIAG_REFRESH_S * 1000U)));
+  ZB_SCHEDULE_APP_ALARM_CANCEL(profile_schedule_tick, ZB_ALARM_ANY_PARAM);
+  ZB_SCHEDULE_APP_ALARM(profile_schedule_tick, 0, PROFILE_SCHEDULE_TICK_S * ZB_TIME_ONE_SECOND);
+}
+
+/* Bindings are in place, by finding & binding or from the production config */
+static void bindings_ready(void)
+{
+  cmd_in_progress = ZB_FALSE;
+  lights_subscribe();
+  start_app_alarms();
+}
+
+/* Schedules the next attempt of a failed network operation */
+static void net_retry(net_retry_op_t op, zb_callback_t cb)
+{
+  /* Uptime seconds: app_time_ms() wraps 49.7 days in and the due time would jump back */
+  zb_uint32_t delay_ms = net_retry_failed(&net_retries, op, &net_rng, app_uptime_s());
+
+  TLOG_WARNING("retry %d in %d ms", net_retries.backoff[op].attempts, delay_ms);
+
+  ZB_SCHEDULE_APP_ALARM_CANCEL(cb, ZB_ALARM_ANY_PARAM);
+  ZB_SCHEDULE_APP_ALARM(cb, 0, ZB_MILLISECONDS_TO_BEACON_INTERVAL(delay_ms));
+}
+
+void net_settle_done(zb_uint8_t param)
+{
+  ZVUNUSED(param);
+  net_settled = ZB_TRUE;
+}
+
+void start_network(zb_uint8_t param)
+{
+  ZVUNUSED(param);
+  zboss_start_continue();
+}
+
 void zboss_signal_handler(zb_uint8_t param)
 {
   zb_zdo_app_signal_hdr_t *sg_p = NULL;
   zb_zdo_app_signal_type_t sig = zb_get_app_signal(param, &sg_p);
-  zb_bufid_t buf;
   zb_bufid_t req_buf = 0;
-  zb_zdo_mgmt_permit_joining_req_param_t *req_param;
 
   if (ZB_GET_APP_SIGNAL_STATUS(param) == 0)
   {
@@ -566,85 +1207,85 @@ void zboss_signal_handler(zb_uint8_t param)
     {
       case ZB_ZDO_SIGNAL_SKIP_STARTUP:
 #ifndef ZB_MACSPLIT_HOST
-        Log_printf(LogModule_Zigbee_App, Log_INFO, "ZB_ZDO_SIGNAL_SKIP_STARTUP: boot, not started yet");
+        TLOG_INFO("ZB_ZDO_SIGNAL_SKIP_STARTUP: boot, not started yet");
         set_tx_power(DEFAULT_TX_PWR);
-        zboss_start_continue();
+        /* Spread the rejoins of sensors that lost power together */
+        ZB_SCHEDULE_APP_ALARM(start_network, 0,
+          ZB_MILLISECONDS_TO_BEACON_INTERVAL(backoff_jitter_ms(&net_rng, NET_START_JITTER_MS)));
 #endif /* ZB_MACSPLIT_HOST */
         break;
 
 #ifdef ZB_MACSPLIT_HOST
       case ZB_MACSPLIT_DEVICE_BOOT:
-        Log_printf(LogModule_Zigbee_App, Log_INFO, "ZB_MACSPLIT_DEVICE_BOOT: boot, not started yet");
+        TLOG_INFO("ZB_MACSPLIT_DEVICE_BOOT: boot, not started yet");
         set_tx_power(DEFAULT_TX_PWR);
-        zboss_start_continue();
+        ZB_SCHEDULE_APP_ALARM(start_network, 0,
+          ZB_MILLISECONDS_TO_BEACON_INTERVAL(backoff_jitter_ms(&net_rng, NET_START_JITTER_MS)));
         break;
 #endif /* ZB_MACSPLIT_HOST */
       case ZB_BDB_SIGNAL_DEVICE_FIRST_START:
-        Log_printf(LogModule_Zigbee_App, Log_INFO, "FIRST_START: start steering");
+        TLOG_INFO("FIRST_START: start steering");
         if (perform_factory_reset)
         {
           // passing in 0 as the parameter means that a buffer will be allocated automatically for the reset
-          zb_bdb_reset_via_local_action(0);
+          sensor_commit_then(zb_bdb_reset_via_local_action);
           perform_factory_reset = ZB_FALSE;
         }
         set_tx_power(DEFAULT_TX_PWR);
-        bdb_start_top_level_commissioning(ZB_BDB_NETWORK_STEERING);
-
-        buf = zb_buf_get_out();
-        if (!buf)
-        {
-          Log_printf(LogModule_Zigbee_App, Log_WARNING, "no buffer available");
-          break;
-        }
-
-        req_param = ZB_BUF_GET_PARAM(buf, zb_zdo_mgmt_permit_joining_req_param_t);
-
-        req_param->dest_addr = 0xfffc;
-        req_param->permit_duration = 0;
-        req_param->tc_significance = 1;
-
-        zb_zdo_mgmt_permit_joining_req(buf, permit_joining_cb);
-
+        /* No permit-joining broadcast to 0xfffc here: closing joining is the
+         * coordinator's business and every router would relay it */
+        ZB_SCHEDULE_APP_ALARM(restart_commissioning, 0,
+          ZB_MILLISECONDS_TO_BEACON_INTERVAL(backoff_jitter_ms(&net_rng, NET_START_JITTER_MS)));
         break;
       case ZB_BDB_SIGNAL_DEVICE_REBOOT:
-        Log_printf(LogModule_Zigbee_App, Log_INFO, "Device RESTARTED OK");
+        TLOG_INFO("Device RESTARTED OK");
         if (perform_factory_reset)
         {
-          Log_printf(LogModule_Zigbee_App, Log_INFO, "Performing a factory reset.");
-          zb_bdb_reset_via_local_action(0);
+          TLOG_INFO("Performing a factory reset.");
+          sensor_commit_then(zb_bdb_reset_via_local_action);
           perform_factory_reset = ZB_FALSE;
         }
         else
         {
-          ZB_SCHEDULE_APP_ALARM_CANCEL(sensor_poll_handler, ZB_ALARM_ANY_PARAM);
-          ZB_SCHEDULE_APP_ALARM(sensor_poll_handler, 0, 1 * ZB_TIME_ONE_SECOND);
+          net_retry_joined(&net_retries);
+          start_app_alarms();
         }
         break;
 #ifdef ZB_COORDINATOR_ROLE
       case ZB_ZDO_SIGNAL_DEVICE_ANNCE:
 #else
       case ZB_BDB_SIGNAL_TC_REJOIN_DONE:
-        Log_printf(LogModule_Zigbee_App, Log_INFO, "TC rejoin is completed successfully");
+        TLOG_INFO("TC rejoin is completed successfully");
+        diag_parent_changed();
       case ZB_BDB_SIGNAL_STEERING:
 #endif
       {
         zb_nwk_device_type_t device_type = ZB_NWK_DEVICE_TYPE_NONE;
         device_type = zb_get_device_type();
-        Log_printf(LogModule_Zigbee_App, Log_INFO, "Device (%d) STARTED OK", device_type);
-        ZB_SCHEDULE_APP_ALARM(start_finding_binding, 0, 3 * ZB_TIME_ONE_SECOND);
+        TLOG_INFO("Device (%d) STARTED OK", device_type);
+        net_retry_joined(&net_retries);
+        /* Pre-provisioned targets are bound directly, with no identify round */
+        if (!prodcfg_bind(ZB_SWITCH_ENDPOINT, prodcfg_bound, bindings_ready))
+        {
+          ZB_SCHEDULE_APP_ALARM(start_finding_binding, 0,
+            ZB_MILLISECONDS_TO_BEACON_INTERVAL(NET_FB_DELAY_MS + backoff_jitter_ms(&net_rng, NET_FB_JITTER_MS)));
+        }
         break;
       }
 
       case ZB_BDB_SIGNAL_FINDING_AND_BINDING_INITIATOR_FINISHED:
       {
-        Log_printf(LogModule_Zigbee_App, Log_INFO, "Finding&binding done");
-        cmd_in_progress = ZB_FALSE;
-        ZB_SCHEDULE_APP_ALARM_CANCEL(sensor_poll_handler, ZB_ALARM_ANY_PARAM);
-        ZB_SCHEDULE_APP_ALARM(sensor_poll_handler, 0, 1 * ZB_TIME_ONE_SECOND);
+        TLOG_INFO("Finding&binding done");
+        bindings_ready();
       }
       break;
 
       case ZB_ZDO_SIGNAL_LEAVE:
+        /* A reset usually follows; do not lose tuning done before it */
+        if (attr_config_commit)
+        {
+          sensor_commit();
+        }
       break;
       case ZB_COMMON_SIGNAL_CAN_SLEEP:
       {
@@ -655,12 +1296,12 @@ void zboss_signal_handler(zb_uint8_t param)
       }
       case ZB_ZDO_SIGNAL_PRODUCTION_CONFIG_READY:
       {
-        Log_printf(LogModule_Zigbee_App, Log_INFO, "Production config is ready");
+        TLOG_INFO("Production config is ready");
         break;
       }
 
       default:
-        Log_printf(LogModule_Zigbee_App, Log_WARNING, "Unknown signal %d, do nothing", sig);
+        TLOG_WARNING("Unknown signal %d, do nothing", sig);
     }
   }
   else
@@ -668,45 +1309,44 @@ void zboss_signal_handler(zb_uint8_t param)
     switch (sig)
     {
       case ZB_BDB_SIGNAL_DEVICE_FIRST_START:
-        Log_printf(LogModule_Zigbee_App, Log_WARNING, "Device can not find any network on start, so try to perform network steering");
-        ZB_SCHEDULE_APP_ALARM(restart_commissioning, 0, 10 * ZB_TIME_ONE_SECOND);
+        TLOG_WARNING("Device can not find any network on start, so try to perform network steering");
+        net_retry(NET_RETRY_STEERING, restart_commissioning);
         break; /* ZB_BDB_SIGNAL_DEVICE_FIRST_START */
 
       case ZB_BDB_SIGNAL_DEVICE_REBOOT:
-        Log_printf(LogModule_Zigbee_App, Log_WARNING, "Device can not find any network on restart");
+        TLOG_WARNING("Device can not find any network on restart");
 
         if (zb_bdb_is_factory_new())
         {
           /* Device tried to perform TC rejoin after reboot and lost its authentication flag.
            * Do nothing here and wait for ZB_BDB_SIGNAL_TC_REJOIN_DONE to handle TC rejoin error */
-          Log_printf(LogModule_Zigbee_App, Log_WARNING, "Device lost authentication flag");
+          TLOG_WARNING("Device lost authentication flag");
         }
         else
         {
           /* Device tried to perform secure rejoin, but didn't found any networks or can't decrypt Rejoin Response
            * (it is possible when Trust Center changes network key when ZED is powered off) */
-          Log_printf(LogModule_Zigbee_App, Log_WARNING, "Device is still authenticated, try to perform TC rejoin");
-          ZB_SCHEDULE_APP_ALARM(zb_bdb_initiate_tc_rejoin, 0, ZB_TIME_ONE_SECOND);
+          TLOG_WARNING("Device is still authenticated, try to perform TC rejoin");
+          net_retry(NET_RETRY_REJOIN, zb_bdb_initiate_tc_rejoin);
         }
         break; /* ZB_BDB_SIGNAL_DEVICE_REBOOT */
 
       case ZB_ZDO_SIGNAL_PRODUCTION_CONFIG_READY:
-        Log_printf(LogModule_Zigbee_App, Log_INFO, "Production config is not present or invalid");
+        TLOG_INFO("Production config is not present or invalid");
         break; /* ZB_ZDO_SIGNAL_PRODUCTION_CONFIG_READY */
 
       case ZB_BDB_SIGNAL_TC_REJOIN_DONE:
-        Log_printf(LogModule_Zigbee_App, Log_WARNING, "TC rejoin failed, so try it again with interval");
-
-        ZB_SCHEDULE_APP_ALARM(zb_bdb_initiate_tc_rejoin, 0, 3 * ZB_TIME_ONE_SECOND);
+        TLOG_WARNING("TC rejoin failed, so try it again with interval");
+        net_retry(NET_RETRY_REJOIN, zb_bdb_initiate_tc_rejoin);
         break; /* ZB_BDB_SIGNAL_TC_REJOIN_DONE */
 
       case ZB_BDB_SIGNAL_STEERING:
-        Log_printf(LogModule_Zigbee_App, Log_WARNING, "Steering failed, retrying again in 10 seconds");
-        ZB_SCHEDULE_APP_ALARM(restart_commissioning, 0, 10 * ZB_TIME_ONE_SECOND);
+        TLOG_WARNING("Steering failed, retrying with backoff");
+        net_retry(NET_RETRY_STEERING, restart_commissioning);
         break; /* ZB_BDB_SIGNAL_STEERING */
 
       default:
-        Log_printf(LogModule_Zigbee_App, Log_WARNING, "Unknown signal %hd with error status, do nothing", sig);
+        TLOG_WARNING("Unknown signal %d with error status, do nothing", sig);
         break;
     }
   }
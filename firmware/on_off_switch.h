@@ -0,0 +1,59 @@
+#ifndef ON_OFF_SWITCH_H
+#define ON_OFF_SWITCH_H
+
+/****** Application defines ******/
+#define ZB_SWITCH_ENDPOINT          10
+/* Private manufacturer code for the SEN0609 command set */
+#define SEN0609_MANUF_CODE          0x1234
+/* Manufacturer-specific occupancy cluster commands (client to server) */
+#define SEN0609_CMD_SET_CONFIG      0x00
+#define SEN0609_CMD_GET_HISTORY     0x01    /* u32 since_seq */
+/* Server to client */
+#define SEN0609_CMD_HISTORY         0x02    /* u32 first_seq, u8 count, u8 more, u32 last_age_ds, octstr records */
+
+/* Hand-declared custom occupancy attributes (the table-driven ones are in sensor_attrs.h) */
+#define ATTR_FLAPS_SUPPRESSED_ID    0xE00D
+#define ATTR_CONFIG_SNAPSHOT_ID     0xE00E
+#define ATTR_ACTIVE_PROFILE_ID      0xE00F
+#define ATTR_PROFILE_SAVE_ID        0xE010
+#define ATTR_PROFILE_NAME_ID        0xE011
+#define ATTR_PROFILE_SCHEDULE_ID    0xE012
+#define ATTR_SOURCE_DISAGREE_ID     0xE013
+#define ATTR_STEERING_RETRIES_ID    0xE014
+#define ATTR_REJOIN_RETRIES_ID      0xE015
+#define ATTR_NEXT_RETRY_ID          0xE016
+#define ATTR_PRESENCE_FRAMES_ID     0xE017
+#define ATTR_PRESENCE_DROPPED_ID    0xE018
+#define ATTR_HISTORY_NEXT_SEQ_ID    0xE019
+#define ATTR_OCC_HOUR_S_ID          0xE01A
+#define ATTR_OCC_DAY_S_ID           0xE01B
+#define ATTR_OCC_DAY_SESSIONS_ID    0xE01C
+#define ATTR_SESSION_MEAN_S_ID      0xE01D
+#define ATTR_SESSION_MAX_S_ID       0xE01E
+#define ATTR_VACANT_S_ID            0xE01F
+#define ATTR_SAVE_QUIET_ID          0xE020
+#define ATTR_CONFIG_COMMIT_ID       0xE021
+#define ATTR_RULES_ID               0xE022
+
+/* Boot-storm spreading. Offsets come from backoff_jitter_ms(), seeded from
+ * the IEEE address, so a building's worth of sensors powering up together
+ * do not rejoin, bind and report in lockstep */
+#define NET_START_JITTER_MS         5000U   /* zboss_start_continue() after power-up */
+#define NET_FB_DELAY_MS             3000U   /* Steering done -> finding & binding */
+#define NET_FB_JITTER_MS            5000U
+#define NET_SETTLE_MS               20000U  /* First occupancy update lands somewhere in here */
+#define NET_CLOCK_JITTER_MS         30000U  /* First Time cluster read */
+
+/* Retry backoff for steering and TC rejoin, see backoff_t */
+#define NET_STEERING_BACKOFF_MS     10000U
+#define NET_REJOIN_BACKOFF_MS       3000U
+#define NET_BACKOFF_CAP_MS          120000U
+
+/* Router build's ZB_CONFIG_OVERALL_NETWORK_SIZE: a floor of 300 sensors,
+ * its 20 infrastructure routers and the coordinator, with room to grow */
+#define NET_ROUTER_NETWORK_SIZE     384U
+
+/* How often the profile schedule is checked against local time */
+#define PROFILE_SCHEDULE_TICK_S     30
+
+#endif /* ON_OFF_SWITCH_H */
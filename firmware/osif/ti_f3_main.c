@@ -72,6 +72,14 @@
 
 #include "ti_drivers_config.h"
 
+#ifdef ZB_OSIF_CS_PROFILE
+#include DeviceFamily_constructPath(inc/hw_types.h)
+#include DeviceFamily_constructPath(inc/hw_memmap.h)
+#include DeviceFamily_constructPath(inc/hw_systim.h)
+#include "cs_profile.h"
+#endif
+#include "stack_wake.h"
+
 #if defined ZB_COORDINATOR_ROLE || defined ZB_ROUTER_ROLE ||  defined ZB_ED_ROLE || !defined ZB_ZGPD_ROLE
 #include <ti/zigbee/osif/include/zb_hal_crypto.h>
 #endif
@@ -93,6 +101,11 @@
 static zb_bool_t gs_platform_init_done = ZB_FALSE;
 static volatile zb_uint8_t count = 0;
 static uintptr_t hwiKey;
+#ifdef ZB_OSIF_CS_PROFILE
+/* SYSTIM time (1 us) and caller of the outermost disable */
+static uint32_t csStart;
+static uint32_t csCaller;
+#endif
 extern SemaphoreP_Handle wakeSem;
 
 void *main_task_function(void *arg0)
@@ -126,7 +139,8 @@ int main(void)
     FATAL_ERR();
   }
 
-  priParam.sched_priority = 1;
+  /* Must stay above SENSOR_WORKER_PRIORITY, see sensor_worker.h */
+  priParam.sched_priority = 2;
 
   detachState = PTHREAD_CREATE_DETACHED;
   retc = pthread_attr_setdetachstate(&attrs, detachState);
@@ -211,27 +225,43 @@ void zb_ti_f3_abort(void)
   FATAL_ERR();
 }
 
+/* The nesting count is only touched with interrupts disabled, so ISRs may
+ * take the lock too: they either nest inside a held lock or run with
+ * count == 0 and restore their own key. */
 void zb_ti_f3_enable_all_inter(void)
 {
-  const unsigned int prev_val = count;
-  if(count != 0U)
+  uintptr_t key;
+
+  if (count == 0U)
   {
-    count -= 1;
+    return;
   }
 
-  if (prev_val == 1) {
-      HwiP_restore(hwiKey);
-      hwiKey = 0;
+  count -= 1U;
+  if (count == 0U)
+  {
+    key = hwiKey;
+    hwiKey = 0;
+#ifdef ZB_OSIF_CS_PROFILE
+    cs_profile_record(HWREG(SYSTIM_BASE + SYSTIM_O_TIME1U) - csStart, csCaller);
+#endif
+    HwiP_restore(key);
   }
 }
 
 void zb_ti_f3_disable_all_inter(void)
 {
-  const unsigned int prev_val = count++;
-  if (prev_val == 0) {
-      hwiKey = HwiP_disable();
-  }
+  const uintptr_t key = HwiP_disable();
 
+  if (count == 0U)
+  {
+    hwiKey = key;
+#ifdef ZB_OSIF_CS_PROFILE
+    csCaller = (uint32_t)__builtin_return_address(0);
+    csStart = HWREG(SYSTIM_BASE + SYSTIM_O_TIME1U);
+#endif
+  }
+  count += 1U;
 }
 
 #ifdef ZB_ZGPD_ROLE
@@ -347,6 +377,14 @@ void zb_osif_wake_up(void)
 #endif // !NCP_MODE
 }
 
+void stack_wake(void)
+{
+  if (NULL != wakeSem)
+  {
+    SemaphoreP_post(wakeSem);
+  }
+}
+
 zb_uint8_t zb_get_reset_source(void)
 {
   zb_uint32_t rst_src;
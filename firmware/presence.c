@@ -0,0 +1,56 @@
+#include "presence.h"
+
+#include <string.h>
+
+void presence_init(presence_t *presence, uint8_t initial, uint32_t now_ms)
+{
+    memset(presence, 0, sizeof(*presence));
+    presence_filter_init(&presence->filter, initial, now_ms);
+    presence->uart = initial;
+}
+
+/* Returns the time left until a disagreement is counted, 0 when none is pending */
+static uint32_t presence_cross_check(presence_t *presence, uint8_t pin, uint32_t now_ms)
+{
+    uint32_t held_ms;
+
+    if (pin == presence->uart)
+    {
+        presence->xcheck_pending = 0;
+        return 0;
+    }
+    if (!presence->xcheck_pending)
+    {
+        presence->xcheck_pending = 1;
+        presence->xcheck_counted = 0;
+        presence->xcheck_since_ms = now_ms;
+    }
+    if (presence->xcheck_counted)
+    {
+        return 0;
+    }
+    held_ms = now_ms - presence->xcheck_since_ms;
+    if (held_ms < PRESENCE_XCHECK_GRACE_MS)
+    {
+        return PRESENCE_XCHECK_GRACE_MS - held_ms;
+    }
+    presence->xcheck_counted = 1;
+    presence->disagreements++;
+    return 0;
+}
+
+uint8_t presence_step(presence_t *presence, uint8_t pin, uint32_t now_ms, uint32_t *recheck_ms)
+{
+    uint8_t output = presence->filter.output;
+
+    pin = pin ? 1 : 0;
+    *recheck_ms = presence_cross_check(presence, pin, now_ms);
+    presence_filter_update(&presence->filter, pin, now_ms);
+
+    if (presence->filter.raw != presence->filter.output &&
+        (*recheck_ms == 0 || *recheck_ms > PRESENCE_RECHECK_MS))
+    {
+        *recheck_ms = PRESENCE_RECHECK_MS;
+    }
+    return presence->filter.output != output;
+}
@@ -0,0 +1,38 @@
+#ifndef PRESENCE_H
+#define PRESENCE_H
+
+#include <stdint.h>
+#include "presence_filter.h"
+
+/*
+ * Presence as occupancy sees it: the radar output pin through the presence
+ * filter, cross-checked against the presence parsed from the UART frames.
+ * Plain state and millisecond times with no ZBOSS calls, so the host tests
+ * and the fleet simulator run this code as it is.
+ */
+
+/* UART frames trail the pin; only disagreements outlasting this count */
+#define PRESENCE_XCHECK_GRACE_MS    3000U
+/* Re-run interval while a filter transition waits (its fields are x100 ms) */
+#define PRESENCE_RECHECK_MS         100U
+
+typedef struct {
+    presence_filter_t filter;
+    uint8_t uart;               /* Presence from the last $DFHPD frame */
+    uint8_t xcheck_pending;     /* Pin and UART disagree since xcheck_since_ms */
+    uint8_t xcheck_counted;
+    uint32_t xcheck_since_ms;
+    uint32_t disagreements;     /* Disagreements that outlasted the grace time */
+} presence_t;
+
+/* Clears the filter config too; set it with presence_filter_set_config(&presence->filter, ...) */
+void presence_init(presence_t *presence, uint8_t initial, uint32_t now_ms);
+/*
+ * Runs the filter and the cross-check on the pin level (1: present, after
+ * io_polarity). Returns 1 when the filtered output changed. *recheck_ms is
+ * set to how long until a result can change without a new edge, 0 when
+ * nothing is pending.
+ */
+uint8_t presence_step(presence_t *presence, uint8_t pin, uint32_t now_ms, uint32_t *recheck_ms);
+
+#endif /* PRESENCE_H */
@@ -0,0 +1,86 @@
+#include "presence_filter.h"
+
+#include <string.h>
+
+static uint8_t presence_filter_flap_allowed(const presence_filter_t *filter, uint32_t now_ms)
+{
+    uint8_t limit = filter->config.flap_limit;
+    uint8_t oldest;
+
+    if (limit == 0 || filter->flap_count < limit)
+    {
+        return 1;
+    }
+
+    /* The transition `limit` places back must have left the window */
+    oldest = (uint8_t)((filter->flap_head + PRESENCE_FILTER_FLAP_SLOTS - limit) % PRESENCE_FILTER_FLAP_SLOTS);
+    return (now_ms - filter->flap_ms[oldest]) >= PRESENCE_FILTER_FLAP_WINDOW_MS;
+}
+
+void presence_filter_init(presence_filter_t *filter, uint8_t initial, uint32_t now_ms)
+{
+    memset(filter, 0, sizeof(*filter));
+    filter->raw = initial;
+    filter->output = initial;
+    filter->raw_since_ms = now_ms;
+    filter->output_since_ms = now_ms;
+}
+
+void presence_filter_set_config(presence_filter_t *filter, const presence_filter_config_t *config)
+{
+    filter->config = *config;
+    if (filter->config.flap_limit > PRESENCE_FILTER_FLAP_SLOTS)
+    {
+        filter->config.flap_limit = PRESENCE_FILTER_FLAP_SLOTS;
+    }
+}
+
+uint8_t presence_filter_update(presence_filter_t *filter, uint8_t raw, uint32_t now_ms)
+{
+    uint32_t dwell_ms;
+
+    raw = raw ? 1 : 0;
+
+    if (raw != filter->raw)
+    {
+        if (filter->raw != filter->output)
+        {
+            /* A pending transition flipped back before it was applied */
+            filter->suppressed++;
+        }
+        filter->raw = raw;
+        filter->raw_since_ms = now_ms;
+    }
+
+    if (raw == filter->output)
+    {
+        return filter->output;
+    }
+
+    dwell_ms = (uint32_t)(raw ? filter->config.assert_dwell : filter->config.release_dwell) * 100U;
+    if (now_ms - filter->raw_since_ms < dwell_ms)
+    {
+        return filter->output;
+    }
+
+    if (now_ms - filter->output_since_ms < (uint32_t)filter->config.min_hold * 100U)
+    {
+        return filter->output;
+    }
+
+    if (!presence_filter_flap_allowed(filter, now_ms))
+    {
+        return filter->output;
+    }
+
+    filter->output = raw;
+    filter->output_since_ms = now_ms;
+    filter->flap_ms[filter->flap_head] = now_ms;
+    filter->flap_head = (uint8_t)((filter->flap_head + 1) % PRESENCE_FILTER_FLAP_SLOTS);
+    if (filter->flap_count < PRESENCE_FILTER_FLAP_SLOTS)
+    {
+        filter->flap_count++;
+    }
+
+    return filter->output;
+}
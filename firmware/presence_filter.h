@@ -0,0 +1,32 @@
+#ifndef PRESENCE_FILTER_H
+#define PRESENCE_FILTER_H
+
+#include <stdint.h>
+
+#define PRESENCE_FILTER_FLAP_SLOTS    8
+#define PRESENCE_FILTER_FLAP_WINDOW_MS 60000U
+
+typedef struct {
+    uint16_t assert_dwell;      /* Presence must persist before asserting (x100ms) */
+    uint16_t release_dwell;     /* Absence must persist before releasing (x100ms) */
+    uint16_t min_hold;          /* Minimum time between output transitions (x100ms) */
+    uint8_t flap_limit;         /* Max output transitions per minute: 0 = unlimited, 1-8 */
+} presence_filter_config_t;
+
+typedef struct {
+    presence_filter_config_t config;
+    uint8_t raw;                /* Last state seen from the parser */
+    uint8_t output;             /* Filtered state handed to the Zigbee side */
+    uint32_t raw_since_ms;
+    uint32_t output_since_ms;
+    uint32_t flap_ms[PRESENCE_FILTER_FLAP_SLOTS];
+    uint8_t flap_head;
+    uint8_t flap_count;
+    uint32_t suppressed;        /* Raw transitions that never reached the output */
+} presence_filter_t;
+
+void presence_filter_init(presence_filter_t *filter, uint8_t initial, uint32_t now_ms);
+void presence_filter_set_config(presence_filter_t *filter, const presence_filter_config_t *config);
+uint8_t presence_filter_update(presence_filter_t *filter, uint8_t raw, uint32_t now_ms);
+
+#endif /* PRESENCE_FILTER_H */
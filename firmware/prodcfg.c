@@ -0,0 +1,166 @@
+#include "prodcfg.h"
+
+#include "tlog.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#if !defined(OTA_ONCHIP) && !defined(OTA_OFFCHIP)
+/* Placed by the linker command file on the block's flash sector */
+extern const prodcfg_t prodcfg_block;
+static zb_bool_t checked = ZB_FALSE;
+#endif
+
+static const prodcfg_t *block;
+
+static zb_uint8_t bind_next;
+static zb_uint8_t bind_ep;
+static prodcfg_bound_cb_t bind_bound;
+static void (*bind_done)(void);
+
+static zb_uint32_t prodcfg_crc32(const zb_uint8_t *data, zb_uint16_t len)
+{
+    zb_uint32_t crc = 0xFFFFFFFFU;
+    zb_uint8_t bit;
+
+    while (len--)
+    {
+        crc ^= *data++;
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+    return ~crc;
+}
+
+static zb_bool_t prodcfg_valid(const prodcfg_t *cfg)
+{
+    if (cfg->magic != PRODCFG_MAGIC || cfg->version != PRODCFG_VERSION ||
+        cfg->target_count > PRODCFG_TARGETS || cfg->channel_mask == 0)
+    {
+        return ZB_FALSE;
+    }
+    if (cfg->ic_len != 0 && cfg->ic_len != 8 && cfg->ic_len != 10 && cfg->ic_len != 14 && cfg->ic_len != 18)
+    {
+        return ZB_FALSE;
+    }
+    return prodcfg_crc32((const zb_uint8_t *)cfg, offsetof(prodcfg_t, crc)) == cfg->crc;
+}
+
+const prodcfg_t *prodcfg_get(void)
+{
+#if !defined(OTA_ONCHIP) && !defined(OTA_OFFCHIP)
+    if (!checked)
+    {
+        checked = ZB_TRUE;
+        if (prodcfg_valid(&prodcfg_block))
+        {
+            block = &prodcfg_block;
+        }
+        else if (prodcfg_block.magic == PRODCFG_MAGIC)
+        {
+            TLOG_WARNING("prodcfg: block is corrupt, ignored");
+        }
+    }
+#endif
+    return block;
+}
+
+zb_uint32_t prodcfg_channel_mask(zb_uint32_t default_mask)
+{
+    const prodcfg_t *cfg = prodcfg_get();
+
+    return cfg != NULL ? cfg->channel_mask : default_mask;
+}
+
+void prodcfg_apply(void)
+{
+    static const zb_uint8_t any_pan[8] = { 0 };
+    const prodcfg_t *cfg = prodcfg_get();
+
+    if (cfg == NULL)
+    {
+        return;
+    }
+
+    TLOG_INFO("prodcfg: channels %x, %d targets", cfg->channel_mask, cfg->target_count);
+    if (memcmp(cfg->ext_pan_id, any_pan, sizeof(any_pan)) != 0)
+    {
+        zb_set_extended_pan_id(cfg->ext_pan_id);
+    }
+    if (cfg->ic_len != 0)
+    {
+        /* 8/10/14/18 bytes -> ZB_IC_TYPE_48/64/96/128 */
+        zb_uint8_t ic_type = cfg->ic_len == 8 ? ZB_IC_TYPE_48 :
+                             cfg->ic_len == 10 ? ZB_IC_TYPE_64 :
+                             cfg->ic_len == 14 ? ZB_IC_TYPE_96 : ZB_IC_TYPE_128;
+
+        if (zb_secur_ic_set(ic_type, (zb_uint8_t *)cfg->install_code) != RET_OK)
+        {
+            TLOG_ERROR("prodcfg: install code rejected");
+        }
+    }
+}
+
+static void prodcfg_bind_step(zb_uint8_t param);
+
+static void prodcfg_bind_conf(zb_uint8_t param)
+{
+    const prodcfg_target_t *target = &block->targets[bind_next];
+
+    if (zb_buf_get_status(param) != RET_OK)
+    {
+        TLOG_WARNING("prodcfg: bind %d failed, status %d", bind_next, zb_buf_get_status(param));
+    }
+    else if (bind_bound != NULL)
+    {
+        bind_bound(target->ieee, target->endpoint, target->cluster_id);
+    }
+
+    bind_next++;
+    prodcfg_bind_step(param);
+}
+
+static void prodcfg_bind_step(zb_uint8_t param)
+{
+    const prodcfg_target_t *target;
+    zb_apsme_binding_req_t *req;
+
+    if (bind_next >= block->target_count)
+    {
+        zb_buf_free(param);
+        bind_done();
+        return;
+    }
+
+    target = &block->targets[bind_next];
+    zb_buf_reuse(param);
+    req = ZB_BUF_GET_PARAM(param, zb_apsme_binding_req_t);
+    memset(req, 0, sizeof(*req));
+    zb_get_long_address(req->src_addr);
+    req->src_endpoint = bind_ep;
+    req->clusterid = target->cluster_id;
+    req->addr_mode = ZB_APS_ADDR_MODE_64_ENDP_PRESENT;
+    ZB_MEMCPY(req->dst_addr.addr_long, target->ieee, sizeof(zb_ieee_addr_t));
+    req->dst_endpoint = target->endpoint;
+    req->confirm_cb = prodcfg_bind_conf;
+    zb_apsme_bind_request(param);
+}
+
+zb_bool_t prodcfg_bind(zb_uint8_t ep, prodcfg_bound_cb_t bound, void (*done)(void))
+{
+    const prodcfg_t *cfg = prodcfg_get();
+
+    if (cfg == NULL || cfg->target_count == 0)
+    {
+        return ZB_FALSE;
+    }
+
+    bind_next = 0;
+    bind_ep = ep;
+    bind_bound = bound;
+    bind_done = done;
+    zb_buf_get_out_delayed(prodcfg_bind_step);
+    return ZB_TRUE;
+}
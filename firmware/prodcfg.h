@@ -0,0 +1,65 @@
+#ifndef PRODCFG_H
+#define PRODCFG_H
+
+#include "zboss_api.h"
+
+/*
+ * Production config block. It takes one flash sector per unit
+ * (prodcfg_block in lpf3_zigbee_freertos.cmd) and is written at
+ * manufacturing by tools/prodcfg_gen.py alongside the application image.
+ * With a valid block the device:
+ * - steers only on the given channels
+ * - joins only the given extended PAN
+ * - derives its TC link key from the install code
+ * - binds straight to the listed targets instead of running finding & binding
+ * Erased flash, or a block with a bad CRC, leaves the defaults in place.
+ * OTA builds have no block.
+ *
+ * The layout is little-endian and naturally aligned (92 bytes); the
+ * generator mirrors it.
+ */
+
+#define PRODCFG_MAGIC               0x47464350U     /* "PCFG" */
+#define PRODCFG_VERSION             1
+#define PRODCFG_TARGETS             4
+#define PRODCFG_IC_MAX              18              /* 128-bit install code + CRC-16 */
+
+typedef struct {
+    zb_uint8_t ieee[8];
+    zb_uint8_t endpoint;
+    zb_uint8_t reserved;
+    zb_uint16_t cluster_id;
+} prodcfg_target_t;
+
+typedef struct {
+    zb_uint32_t magic;
+    zb_uint8_t version;
+    zb_uint8_t target_count;
+    zb_uint8_t ic_len;              /* 0 (none), 8, 10, 14 or 18 bytes, CRC-16 included */
+    zb_uint8_t reserved;
+    zb_uint32_t channel_mask;       /* Page 0, bit n = channel n */
+    zb_uint8_t ext_pan_id[8];       /* All zero: any network */
+    zb_uint8_t install_code[PRODCFG_IC_MAX];
+    zb_uint8_t reserved2[2];
+    prodcfg_target_t targets[PRODCFG_TARGETS];
+    zb_uint32_t crc;                /* CRC-32 (IEEE 802.3) of everything above */
+} prodcfg_t;
+
+/* The validated block, or NULL when there is none */
+const prodcfg_t *prodcfg_get(void);
+/* Channels to commission on */
+zb_uint32_t prodcfg_channel_mask(zb_uint32_t default_mask);
+/* Sets the extended PAN ID and install code; call before zboss_start_no_autostart() */
+void prodcfg_apply(void);
+
+/* Called for each binding that was created */
+typedef void (*prodcfg_bound_cb_t)(const zb_ieee_addr_t ieee, zb_uint8_t ep, zb_uint16_t cluster_id);
+
+/*
+ * Binds ep to the block's targets one after another, then calls done.
+ * Returns ZB_FALSE without doing anything when the block lists no targets,
+ * in which case finding & binding is still needed.
+ */
+zb_bool_t prodcfg_bind(zb_uint8_t ep, prodcfg_bound_cb_t bound, void (*done)(void));
+
+#endif /* PRODCFG_H */
@@ -0,0 +1,230 @@
+#include "profiles.h"
+
+#include <string.h>
+
+#define PROFILES_VERSION 1
+
+typedef struct {
+    sensor_presence_config_t config;
+    zb_uint8_t valid;
+    zb_uint8_t name_len;
+    zb_uint8_t name[PROFILE_NAME_LEN];
+} profile_slot_t;
+
+typedef struct {
+    zb_uint16_t minute;         /* Minute of day, local time */
+    zb_uint8_t slot;            /* PROFILE_NONE = unused */
+} profile_schedule_entry_t;
+
+/* Persisted as ZB_NVRAM_APP_DATA1; bump PROFILES_VERSION on layout changes */
+typedef struct {
+    zb_uint8_t version;
+    zb_uint8_t active;
+    profile_slot_t slots[PROFILE_SLOTS];
+    profile_schedule_entry_t schedule[PROFILE_SCHEDULE_LEN];
+} profile_store_t;
+
+static profile_store_t store;
+
+static void profiles_reset(void)
+{
+    zb_uint8_t i;
+
+    memset(&store, 0, sizeof(store));
+    store.version = PROFILES_VERSION;
+    store.active = PROFILE_NONE;
+    for (i = 0; i < PROFILE_SCHEDULE_LEN; i++)
+    {
+        store.schedule[i].slot = PROFILE_NONE;
+    }
+}
+
+static void profiles_nvram_read(zb_uint8_t page, zb_uint32_t pos, zb_uint16_t payload_length)
+{
+    if (payload_length != sizeof(store) ||
+        zb_nvram_read_data(page, pos, (zb_uint8_t *)&store, sizeof(store)) != RET_OK ||
+        store.version != PROFILES_VERSION)
+    {
+        profiles_reset();
+    }
+}
+
+static zb_ret_t profiles_nvram_write(zb_uint8_t page, zb_uint32_t pos)
+{
+    return zb_nvram_write_data(page, pos, (zb_uint8_t *)&store, sizeof(store));
+}
+
+static zb_uint16_t profiles_nvram_size(void)
+{
+    return sizeof(store);
+}
+
+static void profiles_persist(void)
+{
+    zb_nvram_write_dataset(ZB_NVRAM_APP_DATA1);
+}
+
+void profiles_init(void)
+{
+    profiles_reset();
+    zb_nvram_register_app1_read_cb(profiles_nvram_read);
+    zb_nvram_register_app1_write_cb(profiles_nvram_write, profiles_nvram_size);
+}
+
+zb_bool_t profiles_get(zb_uint8_t slot, sensor_presence_config_t *config)
+{
+    if (slot >= PROFILE_SLOTS || !store.slots[slot].valid)
+    {
+        return ZB_FALSE;
+    }
+    *config = store.slots[slot].config;
+    return ZB_TRUE;
+}
+
+void profiles_save(zb_uint8_t slot, const sensor_presence_config_t *config)
+{
+    if (slot >= PROFILE_SLOTS)
+    {
+        return;
+    }
+    store.slots[slot].config = *config;
+    store.slots[slot].valid = ZB_TRUE;
+    store.active = slot;
+    profiles_persist();
+}
+
+zb_uint8_t profiles_get_active(void)
+{
+    return store.active;
+}
+
+void profiles_set_active(zb_uint8_t slot)
+{
+    if (store.active != slot)
+    {
+        store.active = slot;
+        profiles_persist();
+    }
+}
+
+void profiles_get_name(zb_uint8_t slot, zb_uint8_t *zcl_str)
+{
+    zcl_str[0] = 0;
+    if (slot < PROFILE_SLOTS)
+    {
+        zcl_str[0] = store.slots[slot].name_len;
+        memcpy(&zcl_str[1], store.slots[slot].name, store.slots[slot].name_len);
+    }
+}
+
+void profiles_set_name(zb_uint8_t slot, const zb_uint8_t *zcl_str)
+{
+    zb_uint8_t len = zcl_str[0];
+
+    if (slot >= PROFILE_SLOTS)
+    {
+        return;
+    }
+    if (len > PROFILE_NAME_LEN)
+    {
+        len = PROFILE_NAME_LEN;
+    }
+    store.slots[slot].name_len = len;
+    memcpy(store.slots[slot].name, &zcl_str[1], len);
+    profiles_persist();
+}
+
+void profiles_get_schedule(zb_uint8_t *zcl_str)
+{
+    zb_uint8_t *out = &zcl_str[1];
+    zb_uint8_t i;
+
+    zcl_str[0] = 0;
+    for (i = 0; i < PROFILE_SCHEDULE_LEN; i++)
+    {
+        if (store.schedule[i].slot == PROFILE_NONE)
+        {
+            continue;
+        }
+        *out++ = (zb_uint8_t)(store.schedule[i].minute & 0xFF);
+        *out++ = (zb_uint8_t)(store.schedule[i].minute >> 8);
+        *out++ = store.schedule[i].slot;
+        zcl_str[0] += PROFILE_SCHEDULE_ENTRY_LEN;
+    }
+}
+
+zb_bool_t profiles_check_schedule(const zb_uint8_t *zcl_str)
+{
+    zb_uint8_t len = zcl_str[0];
+    zb_uint8_t i;
+
+    if (len % PROFILE_SCHEDULE_ENTRY_LEN != 0 || len > PROFILE_SCHEDULE_LEN * PROFILE_SCHEDULE_ENTRY_LEN)
+    {
+        return ZB_FALSE;
+    }
+    for (i = 1; i < len; i += PROFILE_SCHEDULE_ENTRY_LEN)
+    {
+        zb_uint16_t minute = (zb_uint16_t)(zcl_str[i] | (zcl_str[i + 1] << 8));
+        if (minute >= 24 * 60 || zcl_str[i + 2] >= PROFILE_SLOTS)
+        {
+            return ZB_FALSE;
+        }
+    }
+    return ZB_TRUE;
+}
+
+void profiles_set_schedule(const zb_uint8_t *zcl_str)
+{
+    zb_uint8_t i;
+    const zb_uint8_t *in = &zcl_str[1];
+
+    for (i = 0; i < PROFILE_SCHEDULE_LEN; i++)
+    {
+        if (i * PROFILE_SCHEDULE_ENTRY_LEN < zcl_str[0])
+        {
+            store.schedule[i].minute = (zb_uint16_t)(in[0] | (in[1] << 8));
+            store.schedule[i].slot = in[2];
+            in += PROFILE_SCHEDULE_ENTRY_LEN;
+        }
+        else
+        {
+            store.schedule[i].minute = 0;
+            store.schedule[i].slot = PROFILE_NONE;
+        }
+    }
+    profiles_persist();
+}
+
+zb_uint8_t profiles_scheduled_slot(zb_uint16_t minute_of_day, zb_uint8_t *entry)
+{
+    zb_uint8_t best = PROFILE_NONE;
+    zb_uint8_t latest = PROFILE_NONE;
+    zb_uint8_t i;
+
+    /* Latest entry at or before now; before the first entry of the day the
+     * last entry of the previous day still applies */
+    for (i = 0; i < PROFILE_SCHEDULE_LEN; i++)
+    {
+        const profile_schedule_entry_t *e = &store.schedule[i];
+        if (e->slot == PROFILE_NONE)
+        {
+            continue;
+        }
+        if (latest == PROFILE_NONE || e->minute > store.schedule[latest].minute)
+        {
+            latest = i;
+        }
+        if (e->minute <= minute_of_day &&
+            (best == PROFILE_NONE || e->minute > store.schedule[best].minute))
+        {
+            best = i;
+        }
+    }
+    if (best == PROFILE_NONE)
+    {
+        best = latest;
+    }
+
+    *entry = best;
+    return best == PROFILE_NONE ? PROFILE_NONE : store.schedule[best].slot;
+}
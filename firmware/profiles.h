@@ -0,0 +1,31 @@
+#ifndef PROFILES_H
+#define PROFILES_H
+
+#include "zboss_api.h"
+#include "sensor.h"
+
+#define PROFILE_SLOTS               4
+#define PROFILE_NAME_LEN            12
+#define PROFILE_NONE                0xFF    /* No profile active / unused schedule entry */
+#define PROFILE_SCHEDULE_LEN        4
+#define PROFILE_SCHEDULE_ENTRY_LEN  3       /* minute of day (u16 LE), slot (u8) */
+
+/* Registers the ZBOSS NVRAM dataset; call before zboss_start_no_autostart() */
+void profiles_init(void);
+
+zb_bool_t profiles_get(zb_uint8_t slot, sensor_presence_config_t *config);
+void profiles_save(zb_uint8_t slot, const sensor_presence_config_t *config);
+zb_uint8_t profiles_get_active(void);
+void profiles_set_active(zb_uint8_t slot);
+
+/* Names and schedules use the ZCL string layout: length byte + payload */
+void profiles_get_name(zb_uint8_t slot, zb_uint8_t *zcl_str);
+void profiles_set_name(zb_uint8_t slot, const zb_uint8_t *zcl_str);
+void profiles_get_schedule(zb_uint8_t *zcl_str);
+zb_bool_t profiles_check_schedule(const zb_uint8_t *zcl_str);
+void profiles_set_schedule(const zb_uint8_t *zcl_str);
+
+/* Slot the schedule selects at this minute of day, or PROFILE_NONE */
+zb_uint8_t profiles_scheduled_slot(zb_uint16_t minute_of_day, zb_uint8_t *entry);
+
+#endif /* PROFILES_H */
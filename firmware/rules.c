@@ -0,0 +1,191 @@
+#include "rules.h"
+
+#include <string.h>
+
+static uint16_t rules_get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void rules_put16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)(value & 0xFF);
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static uint8_t rules_event_for(uint8_t occupied)
+{
+    return occupied ? RULES_EV_OCCUPIED : RULES_EV_VACANT;
+}
+
+static void rules_arm(rules_t *rules, uint32_t now_ms)
+{
+    uint8_t event = rules_event_for(rules->occupied);
+    uint8_t i;
+
+    rules->armed = 0;
+    for (i = 0; i < rules->count; i++)
+    {
+        if (rules->rules[i].event == event)
+        {
+            rules->armed |= (uint8_t)(1U << i);
+            rules->armed_ms[i] = now_ms;
+        }
+    }
+}
+
+static uint8_t rules_in_window(const rule_t *rule, uint16_t minute)
+{
+    if (rule->from_min == rule->to_min)
+    {
+        return 1;
+    }
+    if (minute == RULES_MINUTE_UNKNOWN)
+    {
+        return 0;
+    }
+    if (rule->from_min < rule->to_min)
+    {
+        return minute >= rule->from_min && minute < rule->to_min;
+    }
+    return minute >= rule->from_min || minute < rule->to_min;
+}
+
+void rules_init(rules_t *rules)
+{
+    memset(rules, 0, sizeof(*rules));
+    rules->light = RULES_LIGHT_UNKNOWN;
+}
+
+uint8_t rules_check(const uint8_t *data, uint8_t len)
+{
+    uint8_t pos;
+
+    if (len % RULES_ENTRY_LEN != 0 || len > RULES_BYTES)
+    {
+        return 0;
+    }
+    for (pos = 0; pos < len; pos += RULES_ENTRY_LEN)
+    {
+        const uint8_t *p = &data[pos];
+
+        if (p[0] != RULES_EV_OCCUPIED && p[0] != RULES_EV_VACANT)
+        {
+            return 0;
+        }
+        if (p[1] < RULES_ACT_ON || p[1] > RULES_ACT_SCENE)
+        {
+            return 0;
+        }
+        if (rules_get16(&p[6]) >= RULES_MINUTES_PER_DAY || rules_get16(&p[8]) >= RULES_MINUTES_PER_DAY)
+        {
+            return 0;
+        }
+        if (p[1] == RULES_ACT_LEVEL && p[10] == 0xFF)
+        {
+            return 0;
+        }
+        if (p[1] == RULES_ACT_SCENE && rules_get16(&p[11]) > RULES_GROUP_MAX)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void rules_load(rules_t *rules, const uint8_t *data, uint8_t len, uint32_t now_ms)
+{
+    uint8_t i;
+
+    rules->count = (uint8_t)(len / RULES_ENTRY_LEN);
+    for (i = 0; i < rules->count; i++)
+    {
+        const uint8_t *p = &data[i * RULES_ENTRY_LEN];
+        rule_t *rule = &rules->rules[i];
+
+        rule->event = p[0];
+        rule->action = p[1];
+        rule->delay_s = rules_get16(&p[2]);
+        rule->hold_s = rules_get16(&p[4]);
+        rule->from_min = rules_get16(&p[6]);
+        rule->to_min = rules_get16(&p[8]);
+        rule->arg = p[10];
+        rule->arg2 = rules_get16(&p[11]);
+    }
+    rules_arm(rules, now_ms);
+}
+
+uint8_t rules_save(const rules_t *rules, uint8_t *out)
+{
+    uint8_t i;
+
+    for (i = 0; i < rules->count; i++)
+    {
+        const rule_t *rule = &rules->rules[i];
+        uint8_t *p = &out[i * RULES_ENTRY_LEN];
+
+        p[0] = rule->event;
+        p[1] = rule->action;
+        rules_put16(&p[2], rule->delay_s);
+        rules_put16(&p[4], rule->hold_s);
+        rules_put16(&p[6], rule->from_min);
+        rules_put16(&p[8], rule->to_min);
+        p[10] = rule->arg;
+        rules_put16(&p[11], rule->arg2);
+    }
+    return (uint8_t)(rules->count * RULES_ENTRY_LEN);
+}
+
+void rules_edge(rules_t *rules, uint8_t occupied, uint32_t now_ms)
+{
+    occupied = occupied ? 1 : 0;
+    if (occupied != rules->occupied)
+    {
+        rules->occupied = occupied;
+        rules_arm(rules, now_ms);
+    }
+}
+
+uint8_t rules_run(rules_t *rules, uint32_t now_ms, uint16_t minute, rules_fire_cb_t cb, void *ctx)
+{
+    uint8_t fired = 0;
+    uint8_t i;
+
+    for (i = 0; i < rules->count; i++)
+    {
+        const rule_t *rule = &rules->rules[i];
+        uint8_t bit = (uint8_t)(1U << i);
+        uint8_t turns_off = rule->action == RULES_ACT_OFF || (rule->action == RULES_ACT_LEVEL && rule->arg == 0);
+        uint8_t dims = rule->action == RULES_ACT_OFF || rule->action == RULES_ACT_LEVEL;
+
+        if (!(rules->armed & bit) || now_ms - rules->armed_ms[i] < (uint32_t)rule->delay_s * 1000U)
+        {
+            continue;
+        }
+        /* Minimum on-time: wait, still armed, until the light has been on long enough */
+        if (dims && rules->light == RULES_LIGHT_ON &&
+            now_ms - rules->on_since_ms < (uint32_t)rule->hold_s * 1000U)
+        {
+            continue;
+        }
+
+        rules->armed &= (uint8_t)~bit;
+        if (!rules_in_window(rule, minute))
+        {
+            continue;
+        }
+
+        if (turns_off)
+        {
+            rules->light = RULES_LIGHT_OFF;
+        }
+        else if (rule->action != RULES_ACT_SCENE && rules->light != RULES_LIGHT_ON)
+        {
+            rules->light = RULES_LIGHT_ON;
+            rules->on_since_ms = now_ms;
+        }
+        cb(i, rule, ctx);
+        fired++;
+    }
+    return fired;
+}
@@ -0,0 +1,80 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdint.h>
+
+/*
+ * Presence-to-light rule table. The table replaces the built-in "On while
+ * occupied, Off when not" with up to RULES_MAX rules. An occupancy edge
+ * arms the rules for that event and disarms the others.
+ *
+ * An armed rule fires once its delay has passed:
+ * - It is skipped if the local time is outside its window.
+ * - For Off and Level it waits until the light has been on for hold_s.
+ * A rule whose edge is undone before it fires never fires, so the delay
+ * doubles as a dwell time: "occupied+10" only fires after ten seconds of
+ * continuous presence.
+ *
+ * Wire format: RULES_ENTRY_LEN bytes per rule, little-endian, in field order.
+ */
+
+#define RULES_MAX                   8
+#define RULES_ENTRY_LEN             13
+#define RULES_BYTES                 (RULES_MAX * RULES_ENTRY_LEN)
+#define RULES_MINUTE_UNKNOWN        0xFFFF
+#define RULES_MINUTES_PER_DAY       1440U
+
+/* rule_t.event */
+#define RULES_EV_OCCUPIED           1
+#define RULES_EV_VACANT             2
+
+/* rule_t.action */
+#define RULES_ACT_ON                1
+#define RULES_ACT_OFF               2
+#define RULES_ACT_LEVEL             3       /* arg = level 0-254, arg2 = transition (0.1 s) */
+#define RULES_ACT_SCENE             4       /* arg = scene, arg2 = group ID (0 = through the binding) */
+
+#define RULES_GROUP_MAX             0xFFF7  /* Highest ZCL group ID */
+
+/* rules_t.light: what the rules last asked of the light */
+#define RULES_LIGHT_UNKNOWN         0
+#define RULES_LIGHT_OFF             1
+#define RULES_LIGHT_ON              2
+
+typedef struct {
+    uint8_t event;
+    uint8_t action;
+    uint16_t delay_s;           /* After the edge */
+    uint16_t hold_s;            /* Off/Level: minimum time the light has been on */
+    uint16_t from_min;          /* Local-time window [from, to) in minutes of day; */
+    uint16_t to_min;            /* may wrap midnight, from == to means all day */
+    uint8_t arg;
+    uint16_t arg2;              /* Wide enough for any group ID */
+} rule_t;
+
+typedef struct {
+    rule_t rules[RULES_MAX];
+    uint8_t count;
+    uint8_t armed;              /* Bit per rule */
+    uint32_t armed_ms[RULES_MAX];
+    uint8_t occupied;
+    uint8_t light;              /* RULES_LIGHT_* */
+    uint32_t on_since_ms;
+} rules_t;
+
+/* Called for each rule that fires, in table order */
+typedef void (*rules_fire_cb_t)(uint8_t index, const rule_t *rule, void *ctx);
+
+void rules_init(rules_t *rules);
+/* Checks a wire-format table: whole entries, known events and actions, valid windows */
+uint8_t rules_check(const uint8_t *data, uint8_t len);
+/* Loads a checked table and arms the rules for the current occupancy, as if its edge just happened */
+void rules_load(rules_t *rules, const uint8_t *data, uint8_t len, uint32_t now_ms);
+/* Writes the table in wire format; returns its length */
+uint8_t rules_save(const rules_t *rules, uint8_t *out);
+/* Call with every occupancy update; only changes arm and disarm rules */
+void rules_edge(rules_t *rules, uint8_t occupied, uint32_t now_ms);
+/* Fires the rules that are due; minute is the local minute of day or RULES_MINUTE_UNKNOWN */
+uint8_t rules_run(rules_t *rules, uint32_t now_ms, uint16_t minute, rules_fire_cb_t cb, void *ctx);
+
+#endif /* RULES_H */
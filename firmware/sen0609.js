@@ -2,26 +2,431 @@ const fz = require('zigbee-herdsman-converters/converters/fromZigbee');
 const tz = require('zigbee-herdsman-converters/converters/toZigbee');
 const exposes = require('zigbee-herdsman-converters/lib/exposes');
 const reporting = require('zigbee-herdsman-converters/lib/reporting');
+const {deviceAddCustomCluster} = require('zigbee-herdsman-converters/lib/modernExtend');
+const {Zcl} = require('zigbee-herdsman');
 const e = exposes.presets;
 const ea = exposes.access;
 
 /* ZCL data type IDs */
-const DATA_TYPE = {boolean: 0x10, uint8: 0x20, uint16: 0x21};
+const DATA_TYPE = {boolean: 0x10, uint8: 0x20, uint16: 0x21, uint32: 0x23, octetStr: 0x41, charStr: 0x42};
 
-/* Custom attribute IDs on the Occupancy Sensing cluster (0x0406) */
+/* Private manufacturer code and commands, see on_off_switch.c */
+const SEN0609_MANUF_CODE = 0x1234;
+const CONFIG_SNAPSHOT_ID = 0xE00E;
+const PROFILE_NAME_ID = 0xE011;
+const HISTORY_AGE_UNKNOWN = 0xFFFFFFFF;
+
+/*
+ * One SEN0609_CMD_HISTORY chunk -> [{seq, occupancy, time}], oldest first.
+ * Records are varints of delta << 2 | gap << 1 | state, delta in 0.1 s since
+ * the previous record; lastAge is the age of the last one in 0.1 s. time is
+ * null where a reboot left the delta unknown.
+ */
+const decodeHistory = (chunk, now) => {
+    const buf = Buffer.from(chunk.records);
+    const values = [];
+    for (let i = 0, value = 0, shift = 0; i < buf.length; i++) {
+        value += (buf[i] & 0x7F) * 2 ** shift;
+        shift += 7;
+        if (!(buf[i] & 0x80)) {
+            values.push(value);
+            value = 0;
+            shift = 0;
+        }
+    }
+    const events = [];
+    let age = chunk.lastAge === HISTORY_AGE_UNKNOWN ? null : chunk.lastAge;
+    for (let k = values.length - 1; k >= 0; k--) {
+        events.unshift({
+            seq: chunk.firstSeq + k,
+            occupancy: !!(values[k] & 1),
+            time: age === null ? null : new Date(now - age * 100).toISOString(),
+        });
+        /* The previous record is this one's delta older, unless the delta is unknown */
+        age = age === null || (values[k] & 2) ? null : age + Math.floor(values[k] / 4);
+    }
+    return events;
+};
+
+const requestHistory = async (endpoint, sinceSeq) => {
+    await endpoint.command('msOccupancySensing', 'sen0609GetHistory', {sinceSeq},
+        {manufacturerCode: SEN0609_MANUF_CODE, disableDefaultResponse: true});
+};
+
+/* Profile schedule: up to 4 entries of minute-of-day (u16 LE) + slot, as "HH:MM=slot,..." */
+const encodeSchedule = (text) => {
+    const bytes = [];
+    for (const item of String(text).split(',').map((s) => s.trim()).filter((s) => s)) {
+        const m = /^(\d{1,2}):(\d{2})=([0-3])$/.exec(item);
+        if (!m || Number(m[1]) > 23 || Number(m[2]) > 59) throw new Error(`Bad schedule entry '${item}'`);
+        const minute = Number(m[1]) * 60 + Number(m[2]);
+        bytes.push(minute & 0xFF, minute >> 8, Number(m[3]));
+    }
+    if (bytes.length > 12) throw new Error('At most 4 schedule entries');
+    return Buffer.from(bytes);
+};
+
+const decodeSchedule = (raw) => {
+    const buf = Buffer.from(raw);
+    const items = [];
+    for (let i = 0; i + 3 <= buf.length; i += 3) {
+        const minute = buf.readUInt16LE(i);
+        const hh = String(Math.floor(minute / 60)).padStart(2, '0');
+        const mm = String(minute % 60).padStart(2, '0');
+        items.push(`${hh}:${mm}=${buf[i + 2]}`);
+    }
+    return items.join(',');
+};
+
+/*
+ * Presence-to-light rules (firmware/rules.h), 13 bytes each, as text:
+ * "EVENT[+DELAY] ACTION [VALUE] [hold=S] [fade=DS] [group=G] [HH:MM-HH:MM]; ..."
+ * e.g. "occupied on 06:00-22:00; occupied level 25 22:00-06:00;
+ *       vacant+300 level 40 fade=20; vacant+330 off hold=600"
+ */
+const RULE_EVENTS = ['', 'occupied', 'vacant'];
+const RULE_ACTIONS = ['', 'on', 'off', 'level', 'scene'];
+const RULES_MAX = 8;
+const RULE_LEN = 13;
+/* Options each action takes, with their limits; fade and group share the 16-bit arg2 */
+const RULE_OPTIONS = {
+    on: {},
+    off: {hold: 0xFFFF},
+    level: {hold: 0xFFFF, fade: 0xFFFF},
+    scene: {group: 0xFFF7},
+};
+
+const parseMinute = (text) => {
+    const m = /^(\d{1,2}):(\d{2})$/.exec(text);
+    if (!m || Number(m[1]) > 23 || Number(m[2]) > 59) throw new Error(`Bad time '${text}'`);
+    return Number(m[1]) * 60 + Number(m[2]);
+};
+
+const formatMinute = (minute) =>
+    `${String(Math.floor(minute / 60)).padStart(2, '0')}:${String(minute % 60).padStart(2, '0')}`;
+
+const encodeRules = (text) => {
+    const rules = String(text).split(';').map((s) => s.trim()).filter((s) => s);
+    if (rules.length > RULES_MAX) throw new Error(`At most ${RULES_MAX} rules`);
+    const buf = Buffer.alloc(rules.length * RULE_LEN);
+    rules.forEach((rule, i) => {
+        const words = rule.split(/\s+/);
+        const trigger = /^(occupied|vacant)(?:\+(\d+))?$/.exec(words.shift());
+        const name = words.shift();
+        const action = RULE_ACTIONS.indexOf(name);
+        if (!trigger || action < 1) throw new Error(`Bad rule '${rule}'`);
+        const r = {delay: Number(trigger[2] || 0), hold: 0, from: 0, to: 0, arg: 0, arg2: 0};
+        if (action >= 3) r.arg = Number(words.shift());
+        for (const word of words) {
+            const window = /^(\d{1,2}:\d{2})-(\d{1,2}:\d{2})$/.exec(word);
+            const option = /^(hold|fade|group)=(\d+)$/.exec(word);
+            if (window) {
+                r.from = parseMinute(window[1]);
+                r.to = parseMinute(window[2]);
+            } else if (option && RULE_OPTIONS[name][option[1]] === undefined) {
+                throw new Error(`'${option[1]}=' does not apply to '${name}' in '${rule}'`);
+            } else if (option) {
+                const value = Number(option[2]);
+                if (value > RULE_OPTIONS[name][option[1]]) throw new Error(`'${word}' out of range in '${rule}'`);
+                r[option[1] === 'hold' ? 'hold' : 'arg2'] = value;
+            } else {
+                throw new Error(`Bad rule option '${word}' in '${rule}'`);
+            }
+        }
+        if (!Number.isInteger(r.arg) || r.arg < 0 || r.arg > (action === 3 ? 254 : 255) || r.delay > 0xFFFF) {
+            throw new Error(`Value out of range in '${rule}'`);
+        }
+        const o = i * RULE_LEN;
+        buf.writeUInt8(RULE_EVENTS.indexOf(trigger[1]), o);
+        buf.writeUInt8(action, o + 1);
+        buf.writeUInt16LE(r.delay, o + 2);
+        buf.writeUInt16LE(r.hold, o + 4);
+        buf.writeUInt16LE(r.from, o + 6);
+        buf.writeUInt16LE(r.to, o + 8);
+        buf.writeUInt8(r.arg, o + 10);
+        buf.writeUInt16LE(r.arg2, o + 11);
+    });
+    return buf;
+};
+
+const decodeRules = (raw) => {
+    const buf = Buffer.from(raw);
+    const rules = [];
+    for (let o = 0; o + RULE_LEN <= buf.length; o += RULE_LEN) {
+        const action = buf[o + 1];
+        const delay = buf.readUInt16LE(o + 2);
+        const hold = buf.readUInt16LE(o + 4);
+        const from = buf.readUInt16LE(o + 6);
+        const to = buf.readUInt16LE(o + 8);
+        const arg2 = buf.readUInt16LE(o + 11);
+        const words = [RULE_EVENTS[buf[o]] + (delay ? `+${delay}` : ''), RULE_ACTIONS[action]];
+        if (action >= 3) words.push(String(buf[o + 10]));
+        if (hold) words.push(`hold=${hold}`);
+        if (arg2) words.push(`${action === 3 ? 'fade' : 'group'}=${arg2}`);
+        if (from !== to) words.push(`${formatMinute(from)}-${formatMinute(to)}`);
+        rules.push(words.join(' '));
+    }
+    return rules.join('; ');
+};
+
+/*
+ * Custom attributes on the Occupancy Sensing cluster (0x0406).
+ * Mirrors SENSOR_ATTRS_TABLE in firmware/sensor_attrs.h; the device rejects
+ * out-of-range writes with INVALID_VALUE, these limits only drive the UI.
+ */
 const ATTR = {
-    range_min:           {id: 0xE000, type: DATA_TYPE.uint16},
-    range_max:           {id: 0xE001, type: DATA_TYPE.uint16},
-    trigger_range:       {id: 0xE002, type: DATA_TYPE.uint16},
-    trigger_sensitivity: {id: 0xE003, type: DATA_TYPE.uint8},
-    keep_sensitivity:    {id: 0xE004, type: DATA_TYPE.uint8},
-    trigger_delay:       {id: 0xE005, type: DATA_TYPE.uint8},
-    keep_timeout:        {id: 0xE006, type: DATA_TYPE.uint16},
-    io_polarity:         {id: 0xE007, type: DATA_TYPE.uint8},
-    fretting:            {id: 0xE008, type: DATA_TYPE.boolean},
+    range_min:           {id: 0xE000, type: DATA_TYPE.uint16, snapshot: true, min: 30, max: 2000, unit: 'cm',
+        description: 'Minimum detection range'},
+    range_max:           {id: 0xE001, type: DATA_TYPE.uint16, snapshot: true, min: 240, max: 2000, unit: 'cm',
+        description: 'Maximum detection range'},
+    trigger_range:       {id: 0xE002, type: DATA_TYPE.uint16, snapshot: true, min: 30, max: 2000, unit: 'cm',
+        description: 'Trigger detection range'},
+    trigger_sensitivity: {id: 0xE003, type: DATA_TYPE.uint8, snapshot: true, min: 0, max: 9,
+        description: 'Trigger sensitivity (0=low, 9=high)'},
+    keep_sensitivity:    {id: 0xE004, type: DATA_TYPE.uint8, snapshot: true, min: 0, max: 9,
+        description: 'Keep sensitivity (0=low, 9=high)'},
+    trigger_delay:       {id: 0xE005, type: DATA_TYPE.uint8, snapshot: true, min: 0, max: 200,
+        description: 'Trigger delay (unit: 10 ms, range 0-2 s)'},
+    keep_timeout:        {id: 0xE006, type: DATA_TYPE.uint16, snapshot: true, min: 4, max: 3000,
+        description: 'Keep timeout (unit: 500 ms, range 2-1500 s)'},
+    io_polarity:         {id: 0xE007, type: DATA_TYPE.uint8, snapshot: true, binary: [1, 0],
+        description: 'Output pin level when a target is present'},
+    fretting:            {id: 0xE008, type: DATA_TYPE.boolean, snapshot: true, binary: [true, false],
+        description: 'Micromotion (fretting) detection'},
+    assert_dwell:        {id: 0xE009, type: DATA_TYPE.uint16, min: 0, max: 600,
+        description: 'Presence must persist this long before occupancy is reported (unit: 100 ms)'},
+    release_dwell:       {id: 0xE00A, type: DATA_TYPE.uint16, min: 0, max: 6000,
+        description: 'Absence must persist this long before occupancy is cleared (unit: 100 ms)'},
+    min_hold:            {id: 0xE00B, type: DATA_TYPE.uint16, min: 0, max: 6000,
+        description: 'Minimum time between occupancy changes (unit: 100 ms)'},
+    flap_limit:          {id: 0xE00C, type: DATA_TYPE.uint8, min: 0, max: 8,
+        description: 'Maximum occupancy changes per minute (0 = unlimited)'},
+    /* Config profiles; switching profile changes the radar rows, so re-read them */
+    active_profile:      {id: 0xE00F, type: DATA_TYPE.uint8, min: 0, max: 255, action: true,
+        refresh: [CONFIG_SNAPSHOT_ID, PROFILE_NAME_ID],
+        description: 'Active config profile (0-3, 255 = none)'},
+    profile_save:        {id: 0xE010, type: DATA_TYPE.uint8, min: 0, max: 3, action: true,
+        refresh: [0xE00F, PROFILE_NAME_ID],
+        description: 'Store the current radar config in this profile slot and activate it'},
+    profile_name:        {id: PROFILE_NAME_ID, type: DATA_TYPE.charStr, text: true,
+        description: 'Name of the active profile (max 12 characters)'},
+    profile_schedule:    {id: 0xE012, type: DATA_TYPE.octetStr, text: true,
+        encode: encodeSchedule, decode: decodeSchedule,
+        description: 'Daily profile switches in local time, e.g. "07:00=0,22:30=1"'},
+    /* Radar settings apply live and go to the radar's flash once they stop changing */
+    save_quiet_period:   {id: 0xE020, type: DATA_TYPE.uint16, min: 0, max: 3600, unit: 's',
+        description: 'Time without setting changes before they are saved on the radar (0 = after every change)'},
+    config_unsaved:      {id: 0xE021, type: DATA_TYPE.uint8, binary: [1, 0], action: true,
+        description: 'Radar settings applied but not saved yet; set to save them now'},
+    /* Local automation; an empty table keeps "On while occupied, Off when not" */
+    light_rules:         {id: 0xE022, type: DATA_TYPE.octetStr, text: true,
+        encode: encodeRules, decode: decodeRules,
+        description: 'Presence-to-light rules run on the device, e.g. "occupied on; vacant+300 level 40; vacant+330 off"'},
 };
 
-const ALL_CUSTOM_IDS = Object.values(ATTR).map((a) => a.id);
+/* Read-only diagnostic attributes */
+const ATTR_RO = {
+    flaps_suppressed:    {id: 0xE00D, type: DATA_TYPE.uint32,
+        description: 'Presence transitions swallowed by the filter'},
+    source_disagreements: {id: 0xE013, type: DATA_TYPE.uint32,
+        description: 'Times the radar output pin and its UART frames disagreed for over 3 s'},
+    steering_retries:    {id: 0xE014, type: DATA_TYPE.uint16,
+        description: 'Network steering retries since boot'},
+    rejoin_retries:      {id: 0xE015, type: DATA_TYPE.uint16,
+        description: 'Trust center rejoin retries since boot'},
+    next_retry:          {id: 0xE016, type: DATA_TYPE.uint32,
+        description: 'Uptime in seconds of the next network retry, 0 when none is pending'},
+    presence_frames:     {id: 0xE017, type: DATA_TYPE.uint32,
+        description: 'Presence frames received from the radar'},
+    presence_dropped:    {id: 0xE018, type: DATA_TYPE.uint32,
+        description: 'Presence frames or edges lost on the UART path; should stay 0'},
+    history_next_seq:    {id: 0xE019, type: DATA_TYPE.uint32,
+        description: 'Sequence number of the next occupancy history record'},
+    occupied_last_hour:  {id: 0xE01A, type: DATA_TYPE.uint16, unit: 's', report: 1,
+        description: 'Occupied seconds in the last full hour since boot'},
+    occupied_last_day:   {id: 0xE01B, type: DATA_TYPE.uint32, unit: 's', report: 1,
+        description: 'Occupied seconds in the last 24 full hours'},
+    sessions_last_day:   {id: 0xE01C, type: DATA_TYPE.uint16, report: 1,
+        description: 'Occupancy sessions started in the last 24 full hours'},
+    session_mean:        {id: 0xE01D, type: DATA_TYPE.uint32, unit: 's', report: 1,
+        description: 'Mean occupancy session length since boot'},
+    session_max:         {id: 0xE01E, type: DATA_TYPE.uint32, unit: 's', report: 1,
+        description: 'Longest occupancy session since boot'},
+    vacant_for:          {id: 0xE01F, type: DATA_TYPE.uint32, unit: 's', report: 60,
+        description: 'Seconds since presence last ended, 0 while occupied'},
+};
+
+const ALL_ATTRS = {...ATTR, ...ATTR_RO};
+
+/*
+ * Diagnostics cluster (0x0B05), see firmware/diag.h. `report` rows are
+ * reported on change, but at most every few hours, so a fleet costs little
+ * airtime; the rest is read on demand.
+ */
+const DIAG = {
+    resets:              {id: 0x0000, description: 'Device resets'},
+    mac_tx_retries:      {id: 0x0104, description: 'MAC unicast retries'},
+    mac_tx_failures:     {id: 0x0105, description: 'MAC unicast failures'},
+    aps_tx_success:      {id: 0x0109, description: 'APS unicasts acknowledged'},
+    aps_tx_retries:      {id: 0x010A, description: 'APS unicast retries'},
+    aps_tx_failures:     {id: 0x010B, type: DATA_TYPE.uint16, report: 5, description: 'APS unicasts never acknowledged'},
+    buffer_failures:     {id: 0x0117, description: 'Packet buffer allocation failures'},
+    avg_mac_retries:     {id: 0x011B, description: 'Average MAC retries per APS message'},
+    last_lqi:            {id: 0x011C, description: 'LQI of the last message received'},
+    last_rssi:           {id: 0x011D, unit: 'dBm', description: 'RSSI of the last message received'},
+    parent_changes:      {id: 0xE000, type: DATA_TYPE.uint16, report: 1, description: 'Rejoins since boot'},
+    on_off_timeouts:     {id: 0xE001, type: DATA_TYPE.uint16, report: 1, description: 'On/Off commands to a light that timed out'},
+    buffer_low_time:     {id: 0xE002, unit: 's', description: 'Time the ZBOSS buffer pool was nearly exhausted'},
+    uart_frames:         {id: 0xE003, description: 'Frames received from the radar'},
+    uart_errors:         {id: 0xE004, type: DATA_TYPE.uint32, report: 10, description: 'Malformed, overlong or dropped radar frames'},
+    config_last_time:    {id: 0xE005, unit: 'ms', description: 'Duration of the last radar configuration transaction'},
+    config_max_time:     {id: 0xE006, unit: 'ms', description: 'Longest radar configuration transaction'},
+    radar_silences:      {id: 0xE007, type: DATA_TYPE.uint16, report: 1,
+        description: 'Times the radar sent no presence frame for 30 s and its output was restarted'},
+    stack_min_free:      {id: 0xE00B, type: DATA_TYPE.uint16, report: 16, unit: 'B',
+        description: 'Least stack any task has left unused since boot'},
+    stack_zboss:         {id: 0xE00C, unit: 'B', description: 'Stack the Zigbee thread has left unused since boot'},
+    stack_worker:        {id: 0xE00D, unit: 'B', description: 'Stack the radar worker task has left unused since boot'},
+    stack_idle:          {id: 0xE00E, unit: 'B', description: 'Stack the idle task has left unused since boot'},
+    stack_timer:         {id: 0xE00F, unit: 'B', description: 'Stack the timer task has left unused since boot'},
+    heap_min_free:       {id: 0xE010, unit: 'B', description: 'Least free heap since boot'},
+    heap_largest_block:  {id: 0xE011, unit: 'B', description: 'Largest free heap block'},
+};
+const DIAG_REPORT_MIN_S = 3600;
+const DIAG_REPORT_MAX_S = 43200;
+
+const fromDevice = (attr, raw) => {
+    if (attr.decode) return attr.decode(raw);
+    return attr.type === DATA_TYPE.boolean ? !!raw : raw;
+};
+const toDevice = (attr, value) => {
+    if (attr.encode) return attr.encode(value);
+    return attr.type === DATA_TYPE.boolean ? (value ? 1 : 0) : value;
+};
+
+/* Snapshot layout: the `snapshot` rows of ATTR in order, little-endian */
+const SNAPSHOT_KEYS = Object.keys(ATTR).filter((key) => ATTR[key].snapshot);
+
+const packConfig = (config) => {
+    const bytes = [];
+    for (const key of SNAPSHOT_KEYS) {
+        const v = toDevice(ATTR[key], config[key]);
+        bytes.push(v & 0xFF);
+        if (ATTR[key].type === DATA_TYPE.uint16) bytes.push((v >> 8) & 0xFF);
+    }
+    return Buffer.from(bytes);
+};
+
+const unpackConfig = (buf) => {
+    const result = {};
+    let offset = 0;
+    for (const key of SNAPSHOT_KEYS) {
+        const wide = ATTR[key].type === DATA_TYPE.uint16;
+        if (offset + (wide ? 2 : 1) > buf.length) break;
+        result[key] = fromDevice(ATTR[key], wide ? buf.readUInt16LE(offset) : buf.readUInt8(offset));
+        offset += wide ? 2 : 1;
+    }
+    return result;
+};
+
+const sendConfig = async (entity, config) => {
+    await entity.command('msOccupancySensing', 'sen0609SetConfig', {config: packConfig(config)},
+        {manufacturerCode: SEN0609_MANUF_CODE, disableDefaultResponse: false});
+};
+
+/*
+ * Write reconciliation. Every reported value is cached per device; keys set
+ * within WRITE_COALESCE_MS of each other (a dragged slider, a UI form) are
+ * sent together, minus those the device already reports. Radar keys go as
+ * one sen0609SetConfig so the radar is reconfigured once; the rest as one
+ * Write Attributes frame. Only the attributes that failed are retried.
+ */
+const WRITE_COALESCE_MS = 250;
+const WRITE_RETRIES = 1;
+
+const reported = new Map();
+const pendingWrites = new Map();
+
+const reportedFor = (device) => {
+    if (!reported.has(device.ieeeAddr)) reported.set(device.ieeeAddr, {});
+    return reported.get(device.ieeeAddr);
+};
+
+/* Returns the keys still not applied after the retries */
+const writeAttributes = async (entity, keys, values) => {
+    let todo = keys;
+    for (let attempt = 0; todo.length > 0 && attempt <= WRITE_RETRIES; attempt++) {
+        const payload = {};
+        for (const key of todo) payload[ATTR[key].id] = {value: toDevice(ATTR[key], values[key]), type: ATTR[key].type};
+        try {
+            await entity.write('msOccupancySensing', payload);
+            return [];
+        } catch (error) {
+            /* The response only says that something failed; the read-back says what */
+            try {
+                const readBack = await entity.read('msOccupancySensing', todo.map((key) => ATTR[key].id));
+                todo = todo.filter((key) => readBack[ATTR[key].id] === undefined ||
+                    fromDevice(ATTR[key], readBack[ATTR[key].id]) !== values[key]);
+            } catch (readError) {
+                /* Keep retrying all of them */
+            }
+        }
+    }
+    return todo;
+};
+
+const writeConfig = async (entity, keys, values, current) => {
+    const config = {};
+    for (const key of SNAPSHOT_KEYS) config[key] = values[key] !== undefined ? values[key] : current[key];
+    for (let attempt = 0; attempt <= WRITE_RETRIES; attempt++) {
+        try {
+            await sendConfig(entity, config);
+            return [];
+        } catch (error) {
+            /* One frame, one transaction: retry it whole */
+        }
+    }
+    return keys;
+};
+
+const flushWrites = async (device, batch) => {
+    const current = reportedFor(device);
+    /* `action` keys trigger something on every write, so they are never skipped */
+    const changed = Object.keys(batch.values).filter((key) => ATTR[key].action || current[key] !== batch.values[key]);
+    let radar = changed.filter((key) => ATTR[key].snapshot);
+    let others = changed.filter((key) => !ATTR[key].snapshot);
+    /* The snapshot needs every radar value; without them fall back to attribute writes */
+    if (radar.length < 2 || SNAPSHOT_KEYS.some((key) => batch.values[key] === undefined && current[key] === undefined)) {
+        others = others.concat(radar);
+        radar = [];
+    }
+
+    const failed = [
+        ...(radar.length > 0 ? await writeConfig(batch.entity, radar, batch.values, current) : []),
+        ...(others.length > 0 ? await writeAttributes(batch.entity, others, batch.values) : []),
+    ];
+    for (const key of changed.filter((k) => !failed.includes(k))) current[key] = batch.values[key];
+
+    for (const waiter of batch.waiters) {
+        if (failed.includes(waiter.key)) waiter.reject(new Error(`'${waiter.key}' was not accepted by the device`));
+        else waiter.resolve();
+    }
+};
+
+const queueWrite = (entity, device, key, value) => new Promise((resolve, reject) => {
+    let batch = pendingWrites.get(device.ieeeAddr);
+    if (batch === undefined) {
+        batch = {entity, values: {}, waiters: []};
+        pendingWrites.set(device.ieeeAddr, batch);
+        setTimeout(() => {
+            pendingWrites.delete(device.ieeeAddr);
+            flushWrites(device, batch).catch((error) => batch.waiters.forEach((waiter) => waiter.reject(error)));
+        }, WRITE_COALESCE_MS);
+    }
+    /* The last value of a burst wins */
+    batch.values[key] = value;
+    batch.waiters.push({key, resolve, reject});
+});
 
 const fzLocal = {
     sen0609_config: {
@@ -29,34 +434,98 @@ const fzLocal = {
         type: ['attributeReport', 'readResponse'],
         convert: (model, msg, publish, options, meta) => {
             const result = {};
-            const d = msg.data;
-            if (d[0xE000] !== undefined) result.range_min = d[0xE000];
-            if (d[0xE001] !== undefined) result.range_max = d[0xE001];
-            if (d[0xE002] !== undefined) result.trigger_range = d[0xE002];
-            if (d[0xE003] !== undefined) result.trigger_sensitivity = d[0xE003];
-            if (d[0xE004] !== undefined) result.keep_sensitivity = d[0xE004];
-            if (d[0xE005] !== undefined) result.trigger_delay = d[0xE005];
-            if (d[0xE006] !== undefined) result.keep_timeout = d[0xE006];
-            if (d[0xE007] !== undefined) result.io_polarity = d[0xE007];
-            if (d[0xE008] !== undefined) result.fretting = d[0xE008] ? true : false;
+            for (const [key, attr] of Object.entries(ALL_ATTRS)) {
+                if (msg.data[attr.id] !== undefined) result[key] = fromDevice(attr, msg.data[attr.id]);
+            }
+            if (msg.data[CONFIG_SNAPSHOT_ID] !== undefined) {
+                Object.assign(result, unpackConfig(Buffer.from(msg.data[CONFIG_SNAPSHOT_ID])));
+            }
+            Object.assign(reportedFor(msg.device), result);
             return result;
         },
     },
+    sen0609_diag: {
+        cluster: 'haDiagnostic',
+        type: ['attributeReport', 'readResponse'],
+        convert: (model, msg, publish, options, meta) => {
+            const result = {};
+            for (const [key, attr] of Object.entries(DIAG)) {
+                if (msg.data[attr.id] !== undefined) result[key] = msg.data[attr.id];
+            }
+            return result;
+        },
+    },
+    /* Publishes each history chunk and asks for the next one while the device has more */
+    sen0609_history: {
+        cluster: 'msOccupancySensing',
+        type: ['commandSen0609History'],
+        convert: (model, msg, publish, options, meta) => {
+            const events = decodeHistory(msg.data, Date.now());
+            const next = msg.data.firstSeq + msg.data.count;
+            if (msg.data.more) {
+                requestHistory(msg.endpoint, next).catch((error) => meta.logger.warning(`history: ${error}`));
+            }
+            return {history: events, history_synced_seq: next};
+        },
+    },
 };
 
 const tzLocal = {
     sen0609_config: {
-        key: Object.keys(ATTR),
+        key: Object.keys(ALL_ATTRS),
         convertSet: async (entity, key, value, meta) => {
             const attr = ATTR[key];
-            const writeVal = key === 'fretting' ? (value ? 1 : 0) : value;
-            await entity.write('msOccupancySensing', {[attr.id]: {value: writeVal, type: attr.type}});
+            if (attr === undefined) throw new Error(`'${key}' is read-only`);
+            await queueWrite(entity, meta.device, key, value);
+            if (attr.refresh) await entity.read('msOccupancySensing', attr.refresh);
             return {state: {[key]: value}};
         },
         convertGet: async (entity, key, meta) => {
-            await entity.read('msOccupancySensing', [ATTR[key].id]);
+            await entity.read('msOccupancySensing', [ALL_ATTRS[key].id]);
+        },
+    },
+    /* Writes the whole sensor config in one frame; unspecified keys keep their current value */
+    sen0609_sensor_config: {
+        key: ['sensor_config'],
+        convertSet: async (entity, key, value, meta) => {
+            const config = {};
+            for (const k of SNAPSHOT_KEYS) {
+                config[k] = value[k] !== undefined ? value[k] : meta.state[k];
+                if (config[k] === undefined) throw new Error(`'${k}' unknown, read the device first`);
+            }
+            await sendConfig(entity, config);
+            Object.assign(reportedFor(meta.device), config);
+            return {state: config};
+        },
+        convertGet: async (entity, key, meta) => {
+            await entity.read('msOccupancySensing', [CONFIG_SNAPSHOT_ID]);
+        },
+    },
+    sen0609_diag: {
+        key: Object.keys(DIAG),
+        convertGet: async (entity, key, meta) => {
+            await entity.read('haDiagnostic', [DIAG[key].id]);
         },
     },
+    /* Fetches the records since the last fetch, or since `value` when a sequence number is set */
+    sen0609_history: {
+        key: ['history'],
+        convertSet: async (entity, key, value, meta) => {
+            await requestHistory(entity, Number(value) || 0);
+        },
+        convertGet: async (entity, key, meta) => {
+            await requestHistory(entity, meta.state.history_synced_seq || 0);
+        },
+    },
+};
+
+const exposeAttr = (key, attr, access) => {
+    if (attr.text) return e.text(key, access).withDescription(attr.description);
+    if (attr.binary) return e.binary(key, access, ...attr.binary).withDescription(attr.description);
+    let expose = e.numeric(key, access);
+    if (attr.unit) expose = expose.withUnit(attr.unit);
+    if (attr.min !== undefined) expose = expose.withValueMin(attr.min).withValueMax(attr.max);
+    return expose.withDescription(attr.description);
 };
 
 const definition = {
@@ -65,49 +534,66 @@ const definition = {
      * cluster you can replace this with:
      *   zigbeeModel: ['your_model_id'],
      */
-    fingerprint: [{
-        type: 'EndDevice',
+    fingerprint: ['EndDevice', 'Router'].map((type) => ({
+        type,
         endpoints: [{
             ID: 10,
             profileID: 0x0104,
             deviceID: 0x0000,
-            inputClusters:  [0x0000, 0x0003, 0x0007, 0x0406],
-            outputClusters: [0x0006, 0x0005, 0x0004, 0x0003],
+            inputClusters:  [0x0000, 0x0003, 0x0007, 0x0406, 0x0B05],
+            outputClusters: [0x0006, 0x0008, 0x0005, 0x0004, 0x0003, 0x000A],
         }],
-    }],
+    })),
     model: 'SEN0609-Zigbee',
     vendor: 'DFRobot',
     description: 'SEN0609 mmWave presence sensor with Zigbee (CC2340)',
-    fromZigbee: [fz.occupancy, fz.command_on, fz.command_off, fz.command_toggle, fzLocal.sen0609_config],
-    toZigbee: [tzLocal.sen0609_config],
+    fromZigbee: [fz.occupancy, fz.command_on, fz.command_off, fz.command_toggle, fzLocal.sen0609_config,
+        fzLocal.sen0609_history, fzLocal.sen0609_diag],
+    toZigbee: [tzLocal.sen0609_config, tzLocal.sen0609_sensor_config, tzLocal.sen0609_history, tzLocal.sen0609_diag],
+    extend: [
+        deviceAddCustomCluster('msOccupancySensing', {
+            ID: 0x0406,
+            attributes: {
+                sen0609ConfigSnapshot: {ID: CONFIG_SNAPSHOT_ID, type: Zcl.DataType.OCTET_STR},
+            },
+            commands: {
+                sen0609SetConfig: {
+                    ID: 0x00,
+                    manufacturerCode: SEN0609_MANUF_CODE,
+                    parameters: [{name: 'config', type: Zcl.DataType.OCTET_STR}],
+                },
+                sen0609GetHistory: {
+                    ID: 0x01,
+                    manufacturerCode: SEN0609_MANUF_CODE,
+                    parameters: [{name: 'sinceSeq', type: Zcl.DataType.UINT32}],
+                },
+            },
+            commandsResponse: {
+                sen0609History: {
+                    ID: 0x02,
+                    manufacturerCode: SEN0609_MANUF_CODE,
+                    parameters: [
+                        {name: 'firstSeq', type: Zcl.DataType.UINT32},
+                        {name: 'count', type: Zcl.DataType.UINT8},
+                        {name: 'more', type: Zcl.DataType.UINT8},
+                        {name: 'lastAge', type: Zcl.DataType.UINT32},
+                        {name: 'records', type: Zcl.DataType.OCTET_STR},
+                    ],
+                },
+            },
+        }),
+    ],
     exposes: [
         e.occupancy(),
         e.action(['on', 'off', 'toggle']),
-        e.numeric('range_min', ea.ALL).withUnit('cm')
-            .withValueMin(30).withValueMax(2000)
-            .withDescription('Minimum detection range'),
-        e.numeric('range_max', ea.ALL).withUnit('cm')
-            .withValueMin(240).withValueMax(2000)
-            .withDescription('Maximum detection range'),
-        e.numeric('trigger_range', ea.ALL).withUnit('cm')
-            .withValueMin(30).withValueMax(2000)
-            .withDescription('Trigger detection range'),
-        e.numeric('trigger_sensitivity', ea.ALL)
-            .withValueMin(0).withValueMax(9)
-            .withDescription('Trigger sensitivity (0=low, 9=high)'),
-        e.numeric('keep_sensitivity', ea.ALL)
-            .withValueMin(0).withValueMax(9)
-            .withDescription('Keep sensitivity (0=low, 9=high)'),
-        e.numeric('trigger_delay', ea.ALL)
-            .withValueMin(0).withValueMax(200)
-            .withDescription('Trigger delay (unit: 10 ms, range 0-2 s)'),
-        e.numeric('keep_timeout', ea.ALL)
-            .withValueMin(4).withValueMax(3000)
-            .withDescription('Keep timeout (unit: 500 ms, range 2-1500 s)'),
-        e.binary('io_polarity', ea.ALL, 1, 0)
-            .withDescription('Output pin polarity'),
-        e.binary('fretting', ea.ALL, true, false)
-            .withDescription('Micromotion (fretting) detection'),
+        ...Object.entries(ATTR).map(([key, attr]) => exposeAttr(key, attr, ea.ALL)),
+        ...Object.entries(ATTR_RO).map(([key, attr]) => exposeAttr(key, attr, ea.STATE_GET)),
+        SNAPSHOT_KEYS.reduce((composite, key) => composite.withFeature(exposeAttr(key, ATTR[key], ea.SET)),
+            e.composite('sensor_config', 'sensor_config', ea.SET)
+                .withDescription('Write the whole radar configuration in one frame')),
+        ...Object.entries(DIAG).map(([key, attr]) => exposeAttr(key, attr, ea.STATE_GET)),
+        e.numeric('history', ea.SET | ea.STATE_GET)
+            .withDescription('Fetch the occupancy history; get continues from history_synced_seq, set starts at the given sequence number'),
     ],
     configure: async (device, coordinatorEndpoint, definition) => {
         const endpoint = device.getEndpoint(10);
@@ -118,8 +604,23 @@ const definition = {
             maximumReportInterval: 300,
             reportableChange: 1,
         }]);
-        /* Read initial sensor configuration */
-        await endpoint.read('msOccupancySensing', ALL_CUSTOM_IDS);
+        /*
+         * Statistics change at most once an hour or per session, vacant_for every second while
+         * vacant; report them on a change of `report`, at most every 5 minutes, at least hourly
+         */
+        await endpoint.configureReporting('msOccupancySensing', Object.values(ATTR_RO).filter((a) => a.report)
+            .map((a) => ({attribute: {ID: a.id, type: a.type}, minimumReportInterval: 300,
+                maximumReportInterval: 3600, reportableChange: a.report})));
+        await reporting.bind(endpoint, coordinatorEndpoint, ['haDiagnostic']);
+        await endpoint.configureReporting('haDiagnostic', Object.values(DIAG).filter((a) => a.report)
+            .map((a) => ({attribute: {ID: a.id, type: a.type}, minimumReportInterval: DIAG_REPORT_MIN_S,
+                maximumReportInterval: DIAG_REPORT_MAX_S, reportableChange: a.report})));
+        /* Read the radar config as one snapshot plus the MCU-side attributes, a few per frame */
+        const mcuIds = Object.values(ALL_ATTRS).filter((a) => !a.snapshot).map((a) => a.id);
+        const ids = [CONFIG_SNAPSHOT_ID, ...mcuIds];
+        for (let i = 0; i < ids.length; i += 6) {
+            await endpoint.read('msOccupancySensing', ids.slice(i, i + 6));
+        }
     },
 };
 
@@ -5,30 +5,206 @@
 #include <string.h>
 #include <ti/drivers/UART2.h>
 #include <ti/drivers/dpl/ClockP.h>
-#include "ti/log/Log.h"
 #include "ti_drivers_config.h"
 
 static UART2_Handle uartHandle;
 static zb_bool_t sensor_presence = ZB_FALSE;
-static uint8_t uart_rx_buf[32];
-static size_t uart_rx_idx = 0;
-static sensor_presence_config_t cached_config;
+static sensor_rx_stats_t rx_stats;
+/* The live settings differ from the radar's saved ones, which a radar power cycle goes back to */
+static zb_bool_t config_unsaved = ZB_FALSE;
+/* Settings as last sent (live) and as of the last saveConfig or boot readback (saved) */
+static sensor_presence_config_t live_config;
+static sensor_presence_config_t saved_config;
+
+/* Chunk the UART driver fills; it is ours from the read callback until the next read starts */
+static char rx_chunk[SENSOR_RX_CHUNK_LEN];
+static volatile size_t rx_chunk_len;
+static volatile zb_bool_t rx_chunk_ready = ZB_FALSE;
+/* Set while the worker starts a read, which may complete inside UART2_read() */
+static volatile zb_bool_t rx_starting = ZB_FALSE;
+static sensor_rx_wake_t rx_wake;
+
+/* Line being assembled from the UART */
+static char rx_line[SENSOR_RX_LINE_LEN];
+static size_t rx_len = 0;
+static zb_bool_t rx_overlong = ZB_FALSE;
+
+/* Presence edges not yet taken by sensor_next_presence() */
+static uint8_t presence_edges[SENSOR_PRESENCE_EDGES];
+static uint8_t presence_head = 0;
+static uint8_t presence_count = 0;
+
+/* The one query allowed in flight and the reply routed to it */
+static zb_bool_t query_waiting = ZB_FALSE;
+static zb_bool_t query_answered = ZB_FALSE;
+static char query_reply[SENSOR_RX_LINE_LEN];
+
+static void sensor_on_presence(const char *line)
+{
+    /* "$DFHPD,<0|1>, , , *" */
+    zb_bool_t present;
 
-static void sensor_send_cmd(const char *cmd)
+    if (line[7] != '0' && line[7] != '1')
+    {
+        rx_stats.parse_errors++;
+        return;
+    }
+    present = line[7] == '1' ? ZB_TRUE : ZB_FALSE;
+    rx_stats.presence_frames++;
+
+    if (present == sensor_presence)
+    {
+        return;
+    }
+    sensor_presence = present;
+    if (presence_count == SENSOR_PRESENCE_EDGES)
+    {
+        /*
+         * Queued edges alternate, so the newest one is the opposite of this
+         * edge. Dropping both loses a short pulse but leaves the queue ending
+         * on the radar's current level.
+         */
+        rx_stats.presence_dropped += 2U;
+        presence_count--;
+        return;
+    }
+    presence_edges[(presence_head + presence_count) % SENSOR_PRESENCE_EDGES] = present ? 1 : 0;
+    presence_count++;
+}
+
+static void sensor_on_response(const char *line)
+{
+    if (!query_waiting || query_answered)
+    {
+        rx_stats.stray_replies++;
+        return;
+    }
+    strncpy(query_reply, line, sizeof(query_reply) - 1);
+    query_reply[sizeof(query_reply) - 1] = '\0';
+    query_answered = ZB_TRUE;
+}
+
+/* Routes one complete line; echoes, prompts and "Done" fall through */
+static void sensor_rx_line(const char *line)
+{
+    const char *reply;
+
+    if (strncmp(line, "$DFHPD,", 7) == 0)
+    {
+        sensor_on_presence(line);
+    }
+    else if (line[0] == '$')
+    {
+        rx_stats.telemetry_frames++;
+    }
+    else if ((reply = strstr(line, "Response")) != NULL)
+    {
+        sensor_on_response(reply);
+    }
+}
+
+/* Read callback, in HWI/SWI context: the line went idle or the chunk filled */
+static void sensor_rx_done(UART2_Handle handle, void *buf, size_t count, void *userArg, int_fast16_t status)
+{
+    (void)handle;
+    (void)buf;
+    (void)userArg;
+    (void)status;
+
+    rx_chunk_len = count;
+    rx_chunk_ready = ZB_TRUE;
+    /* A read that completes as it starts is routed by sensor_rx_pump() straight away */
+    if (!rx_starting && rx_wake != NULL)
+    {
+        rx_wake();
+    }
+}
+
+static void sensor_rx_start(void)
+{
+    rx_starting = ZB_TRUE;
+    UART2_read(uartHandle, rx_chunk, sizeof(rx_chunk), NULL);
+    rx_starting = ZB_FALSE;
+}
+
+static void sensor_rx_byte(char c)
+{
+    if (c == '\r' || c == '\n' || c == '\0')
+    {
+        rx_line[rx_len] = '\0';
+        if (rx_overlong)
+        {
+            /* Only the start of the line was kept; a cut presence frame is a lost one */
+            if (strncmp(rx_line, "$DFHPD,", 7) == 0)
+            {
+                rx_stats.presence_dropped++;
+            }
+            rx_stats.parse_errors++;
+            rx_overlong = ZB_FALSE;
+        }
+        else if (rx_len > 0)
+        {
+            sensor_rx_line(rx_line);
+        }
+        rx_len = 0;
+    }
+    else if (rx_len < sizeof(rx_line) - 1)
+    {
+        rx_line[rx_len++] = c;
+    }
+    else
+    {
+        rx_overlong = ZB_TRUE;
+    }
+}
+
+/* Routes every chunk the UART has delivered and starts the next read; never discards input */
+static void sensor_rx_pump(void)
+{
+    size_t i;
+
+    if (uartHandle == NULL)
+    {
+        return;
+    }
+
+    while (rx_chunk_ready)
+    {
+        rx_chunk_ready = ZB_FALSE;
+        for (i = 0; i < rx_chunk_len; i++)
+        {
+            sensor_rx_byte(rx_chunk[i]);
+        }
+        sensor_rx_start();
+    }
+}
+
+/* Sleeps in SENSOR_RX_POLL_MS steps, routing input as it arrives; stops early once `until` is set */
+static void sensor_wait_ms(uint32_t ms, const zb_bool_t *until)
+{
+    uint32_t waited = 0;
+
+    while (waited < ms && (until == NULL || !*until))
+    {
+        ClockP_usleep(SENSOR_RX_POLL_MS * 1000U);
+        waited += SENSOR_RX_POLL_MS;
+        sensor_rx_pump();
+    }
+}
+
+static void sensor_write_line(const char *cmd)
 {
-    if (uartHandle == NULL) return;
     size_t bytesWritten;
+
     UART2_write(uartHandle, cmd, strlen(cmd), &bytesWritten);
     UART2_write(uartHandle, "\r\n", 2, &bytesWritten);
-    ClockP_usleep(200000);
 }
 
-static void sensor_drain(void)
+static void sensor_send_cmd(const char *cmd)
 {
-    uint8_t discard;
-    size_t bytesRead;
-    while (UART2_read(uartHandle, &discard, 1, &bytesRead) == UART2_STATUS_SUCCESS && bytesRead > 0)
-        ;
+    if (uartHandle == NULL) return;
+    sensor_write_line(cmd);
+    sensor_wait_ms(SENSOR_CMD_WAIT_MS, NULL);
 }
 
 typedef struct {
@@ -40,31 +216,22 @@ typedef struct {
 static sensor_response_t sensor_query(const char *cmd)
 {
     sensor_response_t resp = { .ok = ZB_FALSE, .val1 = 0, .val2 = 0 };
-    char buf[64];
-    size_t total = 0;
-    size_t bytesWritten, bytesRead;
 
     if (uartHandle == NULL) return resp;
 
-    sensor_drain();
-    UART2_write(uartHandle, cmd, strlen(cmd), &bytesWritten);
-    UART2_write(uartHandle, "\r\n", 2, &bytesWritten);
-    ClockP_usleep(100000);
-
-    while (total < sizeof(buf) - 1 &&
-           UART2_read(uartHandle, &buf[total], 1, &bytesRead) == UART2_STATUS_SUCCESS &&
-           bytesRead > 0)
-    {
-        total++;
-    }
-    buf[total] = '\0';
+    /* Whatever is already queued belongs to someone else; route it first */
+    sensor_rx_pump();
+    query_waiting = ZB_TRUE;
+    query_answered = ZB_FALSE;
+    sensor_write_line(cmd);
+    sensor_wait_ms(SENSOR_QUERY_TIMEOUT_MS, &query_answered);
+    query_waiting = ZB_FALSE;
 
-    char *res = strstr(buf, "Response");
-    if (res != NULL)
+    if (query_answered)
     {
         char *tok;
         resp.ok = ZB_TRUE;
-        strtok(res, " \r\n");  /* skip "Response" */
+        strtok(query_reply, " \r\n");  /* skip "Response" */
         tok = strtok(NULL, " \r\n");
         if (tok != NULL) resp.val1 = strtof(tok, NULL);
         tok = strtok(NULL, " \r\n");
@@ -123,194 +290,272 @@ static sensor_presence_config_t sensor_read_config(void)
     return config;
 }
 
-void sensor_init(void)
+void sensor_init(const sensor_presence_config_t *defaults)
 {
     UART2_Params params;
     UART2_Params_init(&params);
-    params.readMode = UART2_Mode_NONBLOCKING;
+    /* A read returns once the line idles or the chunk fills, so the worker sleeps between frames */
+    params.readMode = UART2_Mode_CALLBACK;
+    params.readReturnMode = UART2_ReadReturnMode_PARTIAL;
+    params.readCallback = sensor_rx_done;
     params.baudRate = 9600;
 
     uartHandle = UART2_open(CONFIG_UART2_0, &params);
     if (uartHandle != NULL)
     {
         UART2_rxEnable(uartHandle);
-
-        sensor_presence_config_t default_config = {
-            .range_min_cm   = 30,
-            .range_max_cm   = 600,
-            .trig_range_cm  = 300,
-            .trig_sensitivity = 5,
-            .keep_sensitivity = 5,
-            .trig_delay     = 50,
-            .keep_timeout   = 10,
-            .io_polarity    = 0,
-            .fretting       = ZB_TRUE,
-        };
-        sensor_configure_presence(&default_config);
-        cached_config = sensor_read_config();
+        sensor_rx_start();
+        /* What the radar booted with is what it has saved; only a difference needs a save */
+        saved_config = sensor_read_config();
+        live_config = saved_config;
+        sensor_configure_presence(defaults);
     }
 }
 
-sensor_presence_config_t sensor_get_config(void)
+sensor_presence_config_t sensor_refresh_config(void)
 {
-    return cached_config;
+    return sensor_read_config();
 }
 
-sensor_presence_config_t sensor_refresh_config(void)
+static int sensor_encode_range(char *buf, size_t len, const sensor_presence_config_t *config)
 {
-    cached_config = sensor_read_config();
-    return cached_config;
+    return snprintf(buf, len, "setRange %d.%d %d.%d",
+                    config->range_min_cm / 100, (config->range_min_cm / 10) % 10,
+                    config->range_max_cm / 100, (config->range_max_cm / 10) % 10);
 }
 
-void sensor_configure_presence(const sensor_presence_config_t *config)
+static int sensor_encode_trig_range(char *buf, size_t len, const sensor_presence_config_t *config)
 {
-    char cmd[48];
+    return snprintf(buf, len, "setTrigRange %d.%d",
+                    config->trig_range_cm / 100, (config->trig_range_cm / 10) % 10);
+}
 
-    sensor_send_cmd("sensorStop");
+static int sensor_encode_sensitivity(char *buf, size_t len, const sensor_presence_config_t *config)
+{
+    return snprintf(buf, len, "setSensitivity %d %d",
+                    config->keep_sensitivity, config->trig_sensitivity);
+}
 
-    sensor_send_cmd("setRunApp 0");
+static int sensor_encode_latency(char *buf, size_t len, const sensor_presence_config_t *config)
+{
+    return snprintf(buf, len, "setLatency %d.%d %d.%d",
+                    config->trig_delay / 100, (config->trig_delay / 10) % 10,
+                    config->keep_timeout / 2, (config->keep_timeout % 2) * 5);
+}
 
-    snprintf(cmd, sizeof(cmd), "setRange %d.%d %d.%d",
-             config->range_min_cm / 100, (config->range_min_cm / 10) % 10,
-             config->range_max_cm / 100, (config->range_max_cm / 10) % 10);
-    sensor_send_cmd(cmd);
+static int sensor_encode_gpio(char *buf, size_t len, const sensor_presence_config_t *config)
+{
+    return snprintf(buf, len, "setGpioLevel %d", config->io_polarity);
+}
+
+static int sensor_encode_micromotion(char *buf, size_t len, const sensor_presence_config_t *config)
+{
+    return snprintf(buf, len, "setMicroMotion %d", config->fretting ? 1 : 0);
+}
 
-    snprintf(cmd, sizeof(cmd), "setTrigRange %d.%d",
-             config->trig_range_cm / 100, (config->trig_range_cm / 10) % 10);
-    sensor_send_cmd(cmd);
+typedef int (*sensor_cmd_encoder_t)(char *buf, size_t len, const sensor_presence_config_t *config);
 
-    snprintf(cmd, sizeof(cmd), "setSensitivity %d %d",
-             config->keep_sensitivity, config->trig_sensitivity);
-    sensor_send_cmd(cmd);
+static const sensor_cmd_encoder_t sensor_cmd_encoders[SENSOR_CMD_COUNT] = {
+    [SENSOR_CMD_RANGE]       = sensor_encode_range,
+    [SENSOR_CMD_TRIG_RANGE]  = sensor_encode_trig_range,
+    [SENSOR_CMD_SENSITIVITY] = sensor_encode_sensitivity,
+    [SENSOR_CMD_LATENCY]     = sensor_encode_latency,
+    [SENSOR_CMD_GPIO]        = sensor_encode_gpio,
+    [SENSOR_CMD_MICROMOTION] = sensor_encode_micromotion,
+};
 
-    snprintf(cmd, sizeof(cmd), "setLatency %d.%d %d.%d",
-             config->trig_delay / 100, (config->trig_delay / 10) % 10,
-             config->keep_timeout / 2, (config->keep_timeout % 2) * 5);
-    sensor_send_cmd(cmd);
+/* Copies the fields one command sets */
+static void sensor_copy_setting(sensor_cmd_t cmd, sensor_presence_config_t *to, const sensor_presence_config_t *from)
+{
+    switch (cmd)
+    {
+        case SENSOR_CMD_RANGE:
+            to->range_min_cm = from->range_min_cm;
+            to->range_max_cm = from->range_max_cm;
+            break;
+        case SENSOR_CMD_TRIG_RANGE:
+            to->trig_range_cm = from->trig_range_cm;
+            break;
+        case SENSOR_CMD_SENSITIVITY:
+            to->keep_sensitivity = from->keep_sensitivity;
+            to->trig_sensitivity = from->trig_sensitivity;
+            break;
+        case SENSOR_CMD_LATENCY:
+            to->trig_delay = from->trig_delay;
+            to->keep_timeout = from->keep_timeout;
+            break;
+        case SENSOR_CMD_GPIO:
+            to->io_polarity = from->io_polarity;
+            break;
+        case SENSOR_CMD_MICROMOTION:
+            to->fretting = from->fretting;
+            break;
+        default:
+            break;
+    }
+}
 
-    snprintf(cmd, sizeof(cmd), "setGpioLevel %d", config->io_polarity);
-    sensor_send_cmd(cmd);
+/* Compared as sent: two configs the radar cannot tell apart are the same */
+static zb_bool_t sensor_setting_differs(sensor_cmd_t cmd, const sensor_presence_config_t *a,
+                                        const sensor_presence_config_t *b)
+{
+    char a_cmd[32];
+    char b_cmd[32];
 
-    snprintf(cmd, sizeof(cmd), "setMicroMotion %d", config->fretting ? 1 : 0);
-    sensor_send_cmd(cmd);
+    sensor_cmd_encoders[cmd](a_cmd, sizeof(a_cmd), a);
+    sensor_cmd_encoders[cmd](b_cmd, sizeof(b_cmd), b);
+    return strcmp(a_cmd, b_cmd) != 0 ? ZB_TRUE : ZB_FALSE;
+}
 
-    sensor_send_cmd("saveConfig");
-    sensor_send_cmd("sensorStart");
+static void sensor_track_unsaved(void)
+{
+    sensor_cmd_t cmd;
 
-    cached_config = *config;
+    config_unsaved = ZB_FALSE;
+    for (cmd = SENSOR_CMD_NONE + 1; cmd < SENSOR_CMD_COUNT; cmd++)
+    {
+        if (sensor_setting_differs(cmd, &live_config, &saved_config))
+        {
+            config_unsaved = ZB_TRUE;
+        }
+    }
+}
+
+static void sensor_send_setting(sensor_cmd_t cmd, const sensor_presence_config_t *config)
+{
+    char buf[32];
+    sensor_cmd_encoders[cmd](buf, sizeof(buf), config);
+    sensor_send_cmd(buf);
+    sensor_copy_setting(cmd, &live_config, config);
 }
 
-static void sensor_write_setting(const char *cmd)
+/*
+ * setUartOutput <type> <enable> <mode> <interval ms>. mode 0 sends a frame
+ * when the state changes and otherwise every interval, instead of a
+ * continuous stream; the target frames carry nothing we use.
+ */
+static void sensor_send_output_mode(void)
+{
+    char buf[32];
+
+    snprintf(buf, sizeof(buf), "setUartOutput 1 1 0 %u", (unsigned)SENSOR_OUTPUT_HEARTBEAT_MS);
+    sensor_send_cmd(buf);
+    sensor_send_cmd("setUartOutput 2 0 0 0");
+}
+
+void sensor_restart_output(void)
 {
     sensor_send_cmd("sensorStop");
-    sensor_send_cmd(cmd);
-    sensor_send_cmd("saveConfig");
+    sensor_send_output_mode();
     sensor_send_cmd("sensorStart");
 }
 
-void sensor_set_range(uint16_t min_cm, uint16_t max_cm, uint16_t trig_cm)
+void sensor_configure_presence(const sensor_presence_config_t *config)
 {
-    char cmd[48];
+    sensor_cmd_t cmd;
 
     sensor_send_cmd("sensorStop");
+    sensor_send_cmd("setRunApp 0");
+    sensor_send_output_mode();
 
-    snprintf(cmd, sizeof(cmd), "setRange %d.%d %d.%d",
-             min_cm / 100, (min_cm / 10) % 10,
-             max_cm / 100, (max_cm / 10) % 10);
-    sensor_send_cmd(cmd);
-
-    snprintf(cmd, sizeof(cmd), "setTrigRange %d.%d",
-             trig_cm / 100, (trig_cm / 10) % 10);
-    sensor_send_cmd(cmd);
+    for (cmd = SENSOR_CMD_NONE + 1; cmd < SENSOR_CMD_COUNT; cmd++)
+    {
+        sensor_send_setting(cmd, config);
+    }
 
-    sensor_send_cmd("saveConfig");
+    sensor_track_unsaved();
     sensor_send_cmd("sensorStart");
-
-    cached_config.range_min_cm = min_cm;
-    cached_config.range_max_cm = max_cm;
-    cached_config.trig_range_cm = trig_cm;
 }
 
-void sensor_set_sensitivity(uint8_t trig, uint8_t keep)
+void sensor_apply(sensor_cmd_t cmd, const sensor_presence_config_t *config)
 {
-    char cmd[32];
-    snprintf(cmd, sizeof(cmd), "setSensitivity %d %d", keep, trig);
-    sensor_write_setting(cmd);
+    if (cmd <= SENSOR_CMD_NONE || cmd >= SENSOR_CMD_COUNT)
+    {
+        return;
+    }
 
-    cached_config.trig_sensitivity = trig;
-    cached_config.keep_sensitivity = keep;
+    sensor_send_cmd("sensorStop");
+    sensor_send_setting(cmd, config);
+    sensor_track_unsaved();
+    sensor_send_cmd("sensorStart");
 }
 
-void sensor_set_latency(uint8_t trig_delay, uint16_t keep_timeout)
+/* Sends only the commands whose encoding changed, in one stop/start session */
+void sensor_configure_delta(const sensor_presence_config_t *from, const sensor_presence_config_t *to)
 {
-    char cmd[32];
-    snprintf(cmd, sizeof(cmd), "setLatency %d.%d %d.%d",
-             trig_delay / 100, (trig_delay / 10) % 10,
-             keep_timeout / 2, (keep_timeout % 2) * 5);
-    sensor_write_setting(cmd);
+    zb_bool_t stopped = ZB_FALSE;
+    sensor_cmd_t cmd;
 
-    cached_config.trig_delay = trig_delay;
-    cached_config.keep_timeout = keep_timeout;
+    for (cmd = SENSOR_CMD_NONE + 1; cmd < SENSOR_CMD_COUNT; cmd++)
+    {
+        if (!sensor_setting_differs(cmd, from, to))
+        {
+            continue;
+        }
+        if (!stopped)
+        {
+            sensor_send_cmd("sensorStop");
+            stopped = ZB_TRUE;
+        }
+        sensor_send_setting(cmd, to);
+    }
+
+    if (stopped)
+    {
+        /* Going back to the saved settings leaves nothing to save */
+        sensor_track_unsaved();
+        sensor_send_cmd("sensorStart");
+    }
 }
 
-void sensor_set_io_polarity(uint8_t polarity)
+zb_bool_t sensor_save_config(void)
 {
-    char cmd[16];
-    snprintf(cmd, sizeof(cmd), "setGpioLevel %d", polarity);
-    sensor_write_setting(cmd);
+    if (!config_unsaved)
+    {
+        return ZB_FALSE;
+    }
 
-    cached_config.io_polarity = polarity;
+    sensor_send_cmd("sensorStop");
+    sensor_send_cmd("saveConfig");
+    sensor_send_cmd("sensorStart");
+    saved_config = live_config;
+    config_unsaved = ZB_FALSE;
+    return ZB_TRUE;
 }
 
-void sensor_set_fretting(zb_bool_t enabled)
+zb_bool_t sensor_config_unsaved(void)
 {
-    char cmd[20];
-    snprintf(cmd, sizeof(cmd), "setMicroMotion %d", enabled ? 1 : 0);
-    sensor_write_setting(cmd);
+    return config_unsaved;
+}
 
-    cached_config.fretting = enabled;
+void sensor_set_rx_wake(sensor_rx_wake_t wake)
+{
+    rx_wake = wake;
 }
 
 void sensor_poll(void)
 {
-    char line;
-    size_t bytesRead;
+    sensor_rx_pump();
+}
 
-    if (uartHandle == NULL)
-    {
-        return;
-    }
+zb_bool_t sensor_get_presence(void)
+{
+    return sensor_presence;
+}
 
-    while (UART2_read(uartHandle, &line, 1, &bytesRead) == UART2_STATUS_SUCCESS && bytesRead > 0)
+zb_bool_t sensor_next_presence(uint8_t *presence)
+{
+    if (presence_count == 0)
     {
-        if (line == '\r' || line == '\n' || line == '\0')
-        {
-            uart_rx_buf[uart_rx_idx] = '\0';
-            if (strcmp((char *)uart_rx_buf, "$DFHPD,1, , , *") == 0)
-            {
-                sensor_presence = ZB_TRUE;
-            }
-            else if (strcmp((char *)uart_rx_buf, "$DFHPD,0, , , *") == 0)
-            {
-                sensor_presence = ZB_FALSE;
-            }
-            uart_rx_idx = 0;
-        }
-        else
-        {
-            if (uart_rx_idx < sizeof(uart_rx_buf))
-            {
-                uart_rx_buf[uart_rx_idx++] = line;
-            }
-            else
-            {
-                uart_rx_idx = 0;
-            }
-        }
+        return ZB_FALSE;
     }
+    *presence = presence_edges[presence_head];
+    presence_head = (uint8_t)((presence_head + 1) % SENSOR_PRESENCE_EDGES);
+    presence_count--;
+    return ZB_TRUE;
 }
 
-zb_bool_t sensor_get_presence(void)
+const sensor_rx_stats_t *sensor_get_rx_stats(void)
 {
-    return sensor_presence;
+    return &rx_stats;
 }
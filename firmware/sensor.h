@@ -4,28 +4,77 @@
 #include "zboss_api.h"
 #include <stdint.h>
 
+/* Fields are ordered by size so the struct has no internal padding */
 typedef struct {
     uint16_t range_min_cm;      /* Min detection range: 30-2000 cm */
     uint16_t range_max_cm;      /* Max detection range: 240-2000 cm */
     uint16_t trig_range_cm;     /* Trigger range: 30-2000 cm */
+    uint16_t keep_timeout;      /* Keep timeout: 4-3000 (x500ms, so 2-1500s) */
     uint8_t trig_sensitivity;   /* Trigger sensitivity: 0-9 */
     uint8_t keep_sensitivity;   /* Keep sensitivity: 0-9 */
     uint8_t trig_delay;         /* Trigger delay: 0-200 (x10ms, so 0-2s) */
-    uint16_t keep_timeout;      /* Keep timeout: 4-3000 (x500ms, so 2-1500s) */
     uint8_t io_polarity;        /* Output pin polarity: 0 or 1 */
     zb_bool_t fretting;         /* Micromotion detection: ZB_TRUE/ZB_FALSE */
 } sensor_presence_config_t;
 
-void sensor_init(void);
+/* Sensor setting commands, each encoding one or more config fields */
+typedef enum {
+    SENSOR_CMD_NONE = 0,
+    SENSOR_CMD_RANGE,           /* range_min_cm, range_max_cm */
+    SENSOR_CMD_TRIG_RANGE,      /* trig_range_cm */
+    SENSOR_CMD_SENSITIVITY,     /* keep_sensitivity, trig_sensitivity */
+    SENSOR_CMD_LATENCY,         /* trig_delay, keep_timeout */
+    SENSOR_CMD_GPIO,            /* io_polarity */
+    SENSOR_CMD_MICROMOTION,     /* fretting */
+    SENSOR_CMD_COUNT
+} sensor_cmd_t;
+
+/* UART receive path: every line is routed, nothing is drained */
+#define SENSOR_RX_LINE_LEN          48
+#define SENSOR_RX_CHUNK_LEN         32      /* Read size; a read returns early once the line is idle */
+#define SENSOR_RX_POLL_MS           10      /* Input is routed at least this often while waiting on a reply */
+#define SENSOR_PRESENCE_EDGES       8       /* Presence edges buffered for the worker */
+#define SENSOR_CMD_WAIT_MS          200
+#define SENSOR_QUERY_TIMEOUT_MS     300
+
+/* Radar UART output: $DFHPD on state change plus a heartbeat, $DFDMD (targets) off */
+#define SENSOR_OUTPUT_HEARTBEAT_MS  10000
+/* No $DFHPD frame for this long means the radar went silent */
+#define SENSOR_SILENT_MS            (3 * SENSOR_OUTPUT_HEARTBEAT_MS)
+
+typedef struct {
+    uint32_t presence_frames;   /* $DFHPD frames parsed */
+    uint32_t presence_dropped;  /* Frames cut short; edges lost in pairs to a full edge buffer */
+    uint32_t telemetry_frames;  /* Other $ frames */
+    uint32_t stray_replies;     /* "Response" lines with no query waiting */
+    uint32_t parse_errors;      /* Malformed $DFHPD frames and lines too long to parse */
+} sensor_rx_stats_t;
+
+/* Called from the UART read callback (HWI/SWI context) when input is ready for sensor_poll() */
+typedef void (*sensor_rx_wake_t)(void);
+
+/* Set the wake hook first: input can arrive as soon as the UART is open */
+void sensor_set_rx_wake(sensor_rx_wake_t wake);
+void sensor_init(const sensor_presence_config_t *defaults);
 void sensor_configure_presence(const sensor_presence_config_t *config);
-sensor_presence_config_t sensor_get_config(void);
 sensor_presence_config_t sensor_refresh_config(void);
-void sensor_set_range(uint16_t min_cm, uint16_t max_cm, uint16_t trig_cm);
-void sensor_set_sensitivity(uint8_t trig, uint8_t keep);
-void sensor_set_latency(uint8_t trig_delay, uint16_t keep_timeout);
-void sensor_set_io_polarity(uint8_t polarity);
-void sensor_set_fretting(zb_bool_t enabled);
+void sensor_apply(sensor_cmd_t cmd, const sensor_presence_config_t *config);
+void sensor_configure_delta(const sensor_presence_config_t *from, const sensor_presence_config_t *to);
+/*
+ * Setters apply live only; this persists them with one saveConfig. False
+ * when the live settings already match what the radar has saved, as read
+ * back at boot.
+ */
+zb_bool_t sensor_save_config(void);
+zb_bool_t sensor_config_unsaved(void);
+/* Re-sends the output mode; the recovery step for a silent radar */
+void sensor_restart_output(void);
+/* Routes the input the UART has delivered; nothing to do until the wake hook ran */
 void sensor_poll(void);
 zb_bool_t sensor_get_presence(void);
+/* Oldest presence edge not yet taken, in arrival order */
+zb_bool_t sensor_next_presence(uint8_t *presence);
+/* Written by the worker task; each field is read atomically */
+const sensor_rx_stats_t *sensor_get_rx_stats(void);
 
 #endif /* SENSOR_H */
@@ -0,0 +1,154 @@
+#include "sensor_attrs.h"
+
+#include <stddef.h>
+
+sensor_attrs_config_t sensor_attrs_config = {
+    .sensor = {
+        .range_min_cm     = 30,
+        .range_max_cm     = 600,
+        .trig_range_cm    = 300,
+        .keep_timeout     = 10,
+        .trig_sensitivity = 5,
+        .keep_sensitivity = 5,
+        .trig_delay       = 50,
+        .io_polarity      = 0,
+        .fretting         = ZB_TRUE,
+    },
+    .filter = {
+        .assert_dwell  = 0,
+        .release_dwell = 20,
+        .min_hold      = 50,
+        .flap_limit    = 6,
+    },
+};
+
+#define SENSOR_ATTR_DESC(id_, type_, field_, min_, max_, cmd_) \
+    { id_, ZB_ZCL_ATTR_TYPE_##type_, cmd_, offsetof(sensor_attrs_config_t, field_), min_, max_ },
+
+static const sensor_attr_desc_t sensor_attr_descs[] = {
+    SENSOR_ATTRS_TABLE(SENSOR_ATTR_DESC)
+};
+
+#define SENSOR_ATTR_COUNT (sizeof(sensor_attr_descs) / sizeof(sensor_attr_descs[0]))
+
+const sensor_attr_desc_t *sensor_attrs_find(zb_uint16_t attr_id)
+{
+    /* IDs are contiguous from 0xE000 */
+    zb_uint16_t idx = (zb_uint16_t)(attr_id - sensor_attr_descs[0].id);
+
+    if (idx < SENSOR_ATTR_COUNT && sensor_attr_descs[idx].id == attr_id)
+    {
+        return &sensor_attr_descs[idx];
+    }
+    return NULL;
+}
+
+/* Wire values are little-endian and may be unaligned */
+static zb_uint16_t sensor_attrs_decode(const sensor_attr_desc_t *desc, const zb_uint8_t *value)
+{
+    if (desc->type == ZB_ZCL_ATTR_TYPE_U16)
+    {
+        return (zb_uint16_t)(value[0] | (value[1] << 8));
+    }
+    return value[0];
+}
+
+zb_ret_t sensor_attrs_check_value(zb_uint16_t attr_id, zb_uint8_t endpoint, zb_uint8_t *value)
+{
+    const sensor_attr_desc_t *desc = sensor_attrs_find(attr_id);
+    zb_uint16_t v;
+
+    ZVUNUSED(endpoint);
+
+    if (desc == NULL)
+    {
+        /* Standard occupancy attributes are validated by the stack */
+        return RET_OK;
+    }
+
+    v = sensor_attrs_decode(desc, value);
+    return (v >= desc->min && v <= desc->max) ? RET_OK : RET_ERROR;
+}
+
+static void sensor_attrs_put(const sensor_attr_desc_t *desc, zb_uint8_t *field, zb_uint16_t v)
+{
+    if (desc->type == ZB_ZCL_ATTR_TYPE_U16)
+    {
+        *(zb_uint16_t *)field = v;
+    }
+    else
+    {
+        *field = (zb_uint8_t)v;
+    }
+}
+
+void sensor_attrs_store(const sensor_attr_desc_t *desc, const zb_uint8_t *value)
+{
+    sensor_attrs_put(desc, (zb_uint8_t *)&sensor_attrs_config + desc->offset,
+                     sensor_attrs_decode(desc, value));
+}
+
+/* Only rows backed by a sensor command belong to sensor_presence_config_t */
+static zb_uint8_t *sensor_attrs_sensor_field(const sensor_attr_desc_t *desc,
+                                             const sensor_presence_config_t *config)
+{
+    if (desc->cmd == SENSOR_CMD_NONE)
+    {
+        return NULL;
+    }
+    return (zb_uint8_t *)config + desc->offset - offsetof(sensor_attrs_config_t, sensor);
+}
+
+void sensor_attrs_pack(const sensor_presence_config_t *config, zb_uint8_t *out)
+{
+    zb_uint8_t i;
+
+    for (i = 0; i < SENSOR_ATTR_COUNT; i++)
+    {
+        const sensor_attr_desc_t *desc = &sensor_attr_descs[i];
+        const zb_uint8_t *field = sensor_attrs_sensor_field(desc, config);
+
+        if (field == NULL)
+        {
+            continue;
+        }
+        if (desc->type == ZB_ZCL_ATTR_TYPE_U16)
+        {
+            zb_uint16_t v = *(const zb_uint16_t *)field;
+            *out++ = (zb_uint8_t)(v & 0xFF);
+            *out++ = (zb_uint8_t)(v >> 8);
+        }
+        else
+        {
+            *out++ = *field;
+        }
+    }
+}
+
+zb_bool_t sensor_attrs_unpack(const zb_uint8_t *in, sensor_presence_config_t *config)
+{
+    sensor_presence_config_t parsed = *config;
+    zb_uint8_t i;
+
+    for (i = 0; i < SENSOR_ATTR_COUNT; i++)
+    {
+        const sensor_attr_desc_t *desc = &sensor_attr_descs[i];
+        zb_uint8_t *field = sensor_attrs_sensor_field(desc, &parsed);
+        zb_uint16_t v;
+
+        if (field == NULL)
+        {
+            continue;
+        }
+        v = sensor_attrs_decode(desc, in);
+        if (v < desc->min || v > desc->max)
+        {
+            return ZB_FALSE;
+        }
+        sensor_attrs_put(desc, field, v);
+        in += (desc->type == ZB_ZCL_ATTR_TYPE_U16) ? 2 : 1;
+    }
+
+    *config = parsed;
+    return ZB_TRUE;
+}
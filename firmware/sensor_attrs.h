@@ -0,0 +1,61 @@
+#ifndef SENSOR_ATTRS_H
+#define SENSOR_ATTRS_H
+
+#include "zboss_api.h"
+#include "sensor.h"
+#include "presence_filter.h"
+
+/* Everything writable over the occupancy cluster's custom attributes */
+typedef struct {
+    sensor_presence_config_t sensor;
+    presence_filter_config_t filter;
+} sensor_attrs_config_t;
+
+/*
+ * Single source of truth for the custom config attributes. The descriptor
+ * table, the ZCL attribute list and write validation are all generated from
+ * this list; sen0609.js mirrors it.
+ *
+ *   id      type  field                     min   max   sensor command
+ */
+#define SENSOR_ATTRS_TABLE(X) \
+    X(0xE000, U16,  sensor.range_min_cm,      30, 2000, SENSOR_CMD_RANGE) \
+    X(0xE001, U16,  sensor.range_max_cm,     240, 2000, SENSOR_CMD_RANGE) \
+    X(0xE002, U16,  sensor.trig_range_cm,     30, 2000, SENSOR_CMD_TRIG_RANGE) \
+    X(0xE003, U8,   sensor.trig_sensitivity,   0,    9, SENSOR_CMD_SENSITIVITY) \
+    X(0xE004, U8,   sensor.keep_sensitivity,   0,    9, SENSOR_CMD_SENSITIVITY) \
+    X(0xE005, U8,   sensor.trig_delay,         0,  200, SENSOR_CMD_LATENCY) \
+    X(0xE006, U16,  sensor.keep_timeout,       4, 3000, SENSOR_CMD_LATENCY) \
+    X(0xE007, U8,   sensor.io_polarity,        0,    1, SENSOR_CMD_GPIO) \
+    X(0xE008, BOOL, sensor.fretting,           0,    1, SENSOR_CMD_MICROMOTION) \
+    X(0xE009, U16,  filter.assert_dwell,       0,  600, SENSOR_CMD_NONE) \
+    X(0xE00A, U16,  filter.release_dwell,      0, 6000, SENSOR_CMD_NONE) \
+    X(0xE00B, U16,  filter.min_hold,           0, 6000, SENSOR_CMD_NONE) \
+    X(0xE00C, U8,   filter.flap_limit,         0, PRESENCE_FILTER_FLAP_SLOTS, SENSOR_CMD_NONE)
+
+typedef struct {
+    zb_uint16_t id;
+    zb_uint8_t type;            /* ZB_ZCL_ATTR_TYPE_U8/U16/BOOL */
+    zb_uint8_t cmd;             /* sensor_cmd_t, SENSOR_CMD_NONE for MCU-side settings */
+    zb_uint16_t offset;         /* Offset into sensor_attrs_config_t */
+    zb_uint16_t min;
+    zb_uint16_t max;
+} sensor_attr_desc_t;
+
+/* Packed sensor config: the sensor.* rows above in table order, little-endian */
+#define SENSOR_ATTRS_WIRE_U8        1
+#define SENSOR_ATTRS_WIRE_U16       2
+#define SENSOR_ATTRS_WIRE_BOOL      1
+#define SENSOR_ATTRS_SNAPSHOT_ROW(id_, type_, field_, min_, max_, cmd_) \
+    + ((cmd_) != SENSOR_CMD_NONE ? SENSOR_ATTRS_WIRE_##type_ : 0)
+#define SENSOR_ATTRS_SNAPSHOT_LEN   (0 SENSOR_ATTRS_TABLE(SENSOR_ATTRS_SNAPSHOT_ROW))
+
+extern sensor_attrs_config_t sensor_attrs_config;
+
+const sensor_attr_desc_t *sensor_attrs_find(zb_uint16_t attr_id);
+zb_ret_t sensor_attrs_check_value(zb_uint16_t attr_id, zb_uint8_t endpoint, zb_uint8_t *value);
+void sensor_attrs_store(const sensor_attr_desc_t *desc, const zb_uint8_t *value);
+void sensor_attrs_pack(const sensor_presence_config_t *config, zb_uint8_t *out);
+zb_bool_t sensor_attrs_unpack(const zb_uint8_t *in, sensor_presence_config_t *config);
+
+#endif /* SENSOR_ATTRS_H */
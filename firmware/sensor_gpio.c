@@ -0,0 +1,39 @@
+#include "sensor_gpio.h"
+
+#include <ti/drivers/GPIO.h>
+#include "ti_drivers_config.h"
+#include "stack_wake.h"
+
+static volatile uint8_t gpio_level;
+static volatile uint8_t gpio_edge;
+
+static void sensor_gpio_isr(uint_least8_t index)
+{
+    gpio_level = GPIO_read(index) ? 1 : 0;
+    gpio_edge = 1;
+    stack_wake();
+}
+
+void sensor_gpio_start(void)
+{
+    GPIO_setConfig(CONFIG_GPIO_SEN_OUT, GPIO_CFG_IN_NOPULL | GPIO_CFG_IN_INT_BOTH_EDGES);
+    GPIO_setCallback(CONFIG_GPIO_SEN_OUT, sensor_gpio_isr);
+    gpio_level = GPIO_read(CONFIG_GPIO_SEN_OUT) ? 1 : 0;
+    GPIO_enableInt(CONFIG_GPIO_SEN_OUT);
+}
+
+uint8_t sensor_gpio_level(void)
+{
+    return gpio_level;
+}
+
+zb_bool_t sensor_gpio_take_edge(void)
+{
+    /* Cleared before the level is read, so an edge landing in between is seen again */
+    if (!gpio_edge)
+    {
+        return ZB_FALSE;
+    }
+    gpio_edge = 0;
+    return ZB_TRUE;
+}
@@ -0,0 +1,19 @@
+#ifndef SENSOR_GPIO_H
+#define SENSOR_GPIO_H
+
+#include "zboss_api.h"
+
+/*
+ * Radar digital output (net SEN_OUT_MCU, DIO6). The interrupt latches the
+ * pin level, marks the edge and wakes the ZBOSS thread (stack_wake.h), so
+ * the edge is acted on at once rather than at the stack's next timeout.
+ * Mapping the level to presence needs the radar's io_polarity and is left
+ * to the caller.
+ */
+
+void sensor_gpio_start(void);
+uint8_t sensor_gpio_level(void);
+/* Whether an edge came since the last call; clears the mark */
+zb_bool_t sensor_gpio_take_edge(void);
+
+#endif /* SENSOR_GPIO_H */
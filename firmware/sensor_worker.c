@@ -0,0 +1,221 @@
+#include "sensor_worker.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include "stack_wake.h"
+#include "tlog.h"
+
+#define SENSOR_WORKER_STACK_WORDS (SENSOR_WORKER_STACK_SIZE / sizeof(StackType_t))
+
+static StaticTask_t worker_tcb;
+static StackType_t worker_stack[SENSOR_WORKER_STACK_WORDS];
+static TaskHandle_t worker_task;
+
+static StaticQueue_t req_queue_buf;
+static uint8_t req_queue_storage[SENSOR_WORKER_REQ_DEPTH * sizeof(sensor_req_t)];
+static QueueHandle_t req_queue;
+
+static StaticQueue_t evt_queue_buf;
+static uint8_t evt_queue_storage[SENSOR_WORKER_EVT_DEPTH * sizeof(sensor_evt_t)];
+static QueueHandle_t evt_queue;
+
+static sensor_presence_config_t start_config;
+/* Last config read back from the sensor, the baseline for delta updates */
+static sensor_presence_config_t current_config;
+/* Write-back of the radar settings: saved once they stop changing */
+static TickType_t save_quiet_ticks = pdMS_TO_TICKS(SENSOR_SAVE_QUIET_S * 1000U);
+static TickType_t last_change;
+static sensor_worker_stats_t stats;
+
+/* Queues an event and wakes the ZBOSS thread to take it */
+static zb_bool_t sensor_worker_send(const sensor_evt_t *evt)
+{
+    if (xQueueSend(evt_queue, evt, 0) != pdPASS)
+    {
+        return ZB_FALSE;
+    }
+    stack_wake();
+    return ZB_TRUE;
+}
+
+static void sensor_worker_post_config(void)
+{
+    sensor_evt_t evt = { .type = SENSOR_EVT_CONFIG };
+
+    evt.config = sensor_refresh_config();
+    evt.unsaved = sensor_config_unsaved();
+    current_config = evt.config;
+    if (!sensor_worker_send(&evt))
+    {
+        TLOG_WARNING("sensor worker: event queue full, config dropped");
+    }
+}
+
+/* A requested save is always reported, even when nothing was unsaved, so the requester stops waiting */
+static void sensor_worker_save(zb_bool_t requested)
+{
+    sensor_evt_t evt = { .type = SENSOR_EVT_SAVED, .requested = requested };
+
+    if (!sensor_save_config() && !requested)
+    {
+        return;
+    }
+    if (!sensor_worker_send(&evt))
+    {
+        TLOG_WARNING("sensor worker: event queue full, save not reported");
+    }
+}
+
+/* UART input is ready, from the read callback */
+static void sensor_worker_rx_wake(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    vTaskNotifyGiveFromISR(worker_task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+/* Records how long a configuration transaction held the worker */
+static void sensor_worker_timed(TickType_t start)
+{
+    uint32_t ms = (uint32_t)(xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+
+    stats.config_last_ms = ms > 0xFFFFU ? 0xFFFFU : (uint16_t)ms;
+    if (stats.config_last_ms > stats.config_max_ms)
+    {
+        stats.config_max_ms = stats.config_last_ms;
+    }
+}
+
+static void sensor_worker_handle(const sensor_req_t *req)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    switch (req->type)
+    {
+        case SENSOR_REQ_CONFIGURE:
+            sensor_configure_delta(&current_config, &req->config);
+            last_change = xTaskGetTickCount();
+            break;
+        case SENSOR_REQ_APPLY:
+            sensor_apply((sensor_cmd_t)req->cmd, &req->config);
+            last_change = xTaskGetTickCount();
+            break;
+        case SENSOR_REQ_SAVE:
+            sensor_worker_save(ZB_TRUE);
+            sensor_worker_timed(start);
+            return;
+        case SENSOR_REQ_SAVE_QUIET:
+            save_quiet_ticks = pdMS_TO_TICKS(req->save_quiet_s * 1000U);
+            return;
+        case SENSOR_REQ_REFRESH:
+        default:
+            break;
+    }
+    sensor_worker_post_config();
+    sensor_worker_timed(start);
+}
+
+/* Heartbeat watchdog: in change-only mode even an empty room sends a frame every heartbeat */
+static void sensor_worker_watchdog(void)
+{
+    static uint32_t seen_frames;
+    static TickType_t last_frame;
+    TickType_t now = xTaskGetTickCount();
+
+    if (sensor_get_rx_stats()->presence_frames != seen_frames)
+    {
+        seen_frames = sensor_get_rx_stats()->presence_frames;
+        last_frame = now;
+    }
+    else if (now - last_frame >= pdMS_TO_TICKS(SENSOR_SILENT_MS))
+    {
+        TLOG_WARNING("sensor worker: radar silent for %d ms, restarting output", SENSOR_SILENT_MS);
+        stats.silences++;
+        sensor_restart_output();
+        last_frame = xTaskGetTickCount();
+    }
+}
+
+static void sensor_worker_task(void *arg)
+{
+    sensor_req_t req;
+    sensor_evt_t edge = { .type = SENSOR_EVT_PRESENCE };
+    zb_bool_t edge_pending = ZB_FALSE;
+
+    (void)arg;
+
+    sensor_set_rx_wake(sensor_worker_rx_wake);
+    sensor_init(&start_config);
+    last_change = xTaskGetTickCount();
+    sensor_worker_post_config();
+
+    for (;;)
+    {
+        /* Sleeps until a request or UART input arrives; the UART is not polled. A held edge is retried soon */
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(edge_pending ? SENSOR_RX_POLL_MS : SENSOR_WORKER_TICK_MS));
+        while (xQueueReceive(req_queue, &req, 0) == pdPASS)
+        {
+            sensor_worker_handle(&req);
+        }
+
+        sensor_poll();
+        sensor_worker_watchdog();
+
+        if (sensor_config_unsaved() && xTaskGetTickCount() - last_change >= save_quiet_ticks)
+        {
+            sensor_worker_save(ZB_FALSE);
+        }
+
+        /* Every edge is forwarded in order, including those seen during a config session */
+        while (edge_pending || sensor_next_presence(&edge.presence))
+        {
+            edge_pending = ZB_TRUE;
+            /* On a full queue hold the edge and retry on the next pass */
+            if (!sensor_worker_send(&edge))
+            {
+                break;
+            }
+            edge_pending = ZB_FALSE;
+        }
+    }
+}
+
+void sensor_worker_start(const sensor_presence_config_t *defaults)
+{
+    start_config = *defaults;
+
+    req_queue = xQueueCreateStatic(SENSOR_WORKER_REQ_DEPTH, sizeof(sensor_req_t),
+                                   req_queue_storage, &req_queue_buf);
+    evt_queue = xQueueCreateStatic(SENSOR_WORKER_EVT_DEPTH, sizeof(sensor_evt_t),
+                                   evt_queue_storage, &evt_queue_buf);
+
+    worker_task = xTaskCreateStatic(sensor_worker_task, SENSOR_WORKER_NAME, SENSOR_WORKER_STACK_WORDS, NULL,
+                                    SENSOR_WORKER_PRIORITY, worker_stack, &worker_tcb);
+}
+
+zb_bool_t sensor_worker_post(const sensor_req_t *req)
+{
+    if (xQueueSend(req_queue, req, 0) != pdPASS)
+    {
+        return ZB_FALSE;
+    }
+    xTaskNotifyGive(worker_task);
+    return ZB_TRUE;
+}
+
+zb_bool_t sensor_worker_get_event(sensor_evt_t *evt)
+{
+    return xQueueReceive(evt_queue, evt, 0) == pdPASS ? ZB_TRUE : ZB_FALSE;
+}
+
+zb_bool_t sensor_worker_has_events(void)
+{
+    return uxQueueMessagesWaiting(evt_queue) > 0 ? ZB_TRUE : ZB_FALSE;
+}
+
+const sensor_worker_stats_t *sensor_worker_get_stats(void)
+{
+    return &stats;
+}
@@ -0,0 +1,83 @@
+#ifndef SENSOR_WORKER_H
+#define SENSOR_WORKER_H
+
+#include "zboss_api.h"
+#include "sensor.h"
+
+/*
+ * The worker task owns CONFIG_UART2_0 and is the only caller of the
+ * sensor_* functions. The ZBOSS thread talks to it through two bounded
+ * queues and never blocks on the sensor.
+ */
+
+/*
+ * Priorities. The radio runs in HWI/SWI context above every task. The
+ * worker runs one priority below the ZBOSS thread (sched_priority in
+ * osif/ti_f3_main.c), so the stack preempts it whenever it has work and
+ * equal-priority time slicing never hands the worker a turn ahead of it.
+ * That only holds while the ZBOSS thread blocks when idle: it must never
+ * poll in my_main_loop(), or the worker below it is starved and the UART
+ * is not drained. So every event the worker queues is followed by
+ * stack_wake(), and the ZBOSS thread takes events from a scheduled
+ * callback once woken. The worker spends nearly all of its time blocked
+ * on its task notification or in ClockP_usleep().
+ */
+#define SENSOR_WORKER_NAME          "sensor"    /* FreeRTOS task name, see stack_mon.c */
+#define SENSOR_WORKER_PRIORITY      1
+#define SENSOR_WORKER_STACK_SIZE    1536    /* bytes */
+#define SENSOR_WORKER_REQ_DEPTH     4
+#define SENSOR_WORKER_EVT_DEPTH     8
+/* Longest the worker sleeps with nothing to do; the silence watchdog and the quiet-period
+ * save run at this pace. Requests and UART input wake it at once */
+#define SENSOR_WORKER_TICK_MS       1000
+/* Unsaved settings are committed with saveConfig once no change came for this long */
+#define SENSOR_SAVE_QUIET_S         30
+#define SENSOR_SAVE_QUIET_MAX_S     3600
+/* Longest wait for the SENSOR_EVT_SAVED of a save before a planned reset; covers
+ * the save (stop, save, start) behind one configuration session with read-back */
+#define SENSOR_SAVE_FLUSH_MS        5000
+
+typedef enum {
+    SENSOR_REQ_CONFIGURE,       /* Push the whole config, sending only what changed */
+    SENSOR_REQ_APPLY,           /* Push the fields behind one sensor command */
+    SENSOR_REQ_REFRESH,         /* Read the config back */
+    SENSOR_REQ_SAVE,            /* saveConfig now if anything is unsaved; always answered with SENSOR_EVT_SAVED */
+    SENSOR_REQ_SAVE_QUIET,      /* Set the quiet period before an automatic save */
+} sensor_req_type_t;
+
+typedef struct {
+    uint8_t type;               /* sensor_req_type_t */
+    uint8_t cmd;                /* sensor_cmd_t for SENSOR_REQ_APPLY */
+    uint16_t save_quiet_s;      /* For SENSOR_REQ_SAVE_QUIET; 0 saves after every change */
+    sensor_presence_config_t config;
+} sensor_req_t;
+
+typedef enum {
+    SENSOR_EVT_PRESENCE,        /* Parsed presence changed */
+    SENSOR_EVT_CONFIG,          /* Config read back after a request */
+    SENSOR_EVT_SAVED,           /* Nothing is unsaved any more: a save ran or was not needed */
+} sensor_evt_type_t;
+
+typedef struct {
+    uint8_t type;               /* sensor_evt_type_t */
+    uint8_t presence;
+    uint8_t unsaved;            /* Settings pending a saveConfig, for SENSOR_EVT_CONFIG */
+    uint8_t requested;          /* SENSOR_EVT_SAVED answering a SENSOR_REQ_SAVE, not a quiet-period save */
+    sensor_presence_config_t config;
+} sensor_evt_t;
+
+/* Written by the worker task; each field is read atomically */
+typedef struct {
+    uint16_t config_last_ms;    /* Duration of the last request, read-back included */
+    uint16_t config_max_ms;
+    uint16_t silences;          /* Times no $DFHPD arrived for SENSOR_SILENT_MS */
+} sensor_worker_stats_t;
+
+void sensor_worker_start(const sensor_presence_config_t *defaults);
+zb_bool_t sensor_worker_post(const sensor_req_t *req);
+zb_bool_t sensor_worker_get_event(sensor_evt_t *evt);
+/* Whether an event is queued; callable from the ZBOSS thread without taking it */
+zb_bool_t sensor_worker_has_events(void);
+const sensor_worker_stats_t *sensor_worker_get_stats(void);
+
+#endif /* SENSOR_WORKER_H */
@@ -0,0 +1,134 @@
+#include "stack_mon.h"
+#include "sensor_worker.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <string.h>
+#include "tlog.h"
+
+/* Kernel defaults, unless FreeRTOSConfig.h renames the tasks */
+#ifndef configIDLE_TASK_NAME
+#define configIDLE_TASK_NAME            "IDLE"
+#endif
+#ifndef configTIMER_SERVICE_TASK_NAME
+#define configTIMER_SERVICE_TASK_NAME   "Tmr Svc"
+#endif
+
+static TaskHandle_t zboss_task;
+static TaskStatus_t task_status[STACK_MON_MAX_TASKS];
+static stack_mon_stats_t stats;
+static uint8_t stack_low_logged;        /* Bit per stack_task_t */
+static uint8_t heap_low_logged;
+static uint8_t block_low;
+
+static stack_task_t stack_mon_classify(const TaskStatus_t *task)
+{
+    if (task->xHandle == zboss_task)
+    {
+        return STACK_TASK_ZBOSS;
+    }
+    if (strcmp(task->pcTaskName, SENSOR_WORKER_NAME) == 0)
+    {
+        return STACK_TASK_WORKER;
+    }
+    if (strcmp(task->pcTaskName, configIDLE_TASK_NAME) == 0)
+    {
+        return STACK_TASK_IDLE;
+    }
+    if (strcmp(task->pcTaskName, configTIMER_SERVICE_TASK_NAME) == 0)
+    {
+        return STACK_TASK_TIMER;
+    }
+    return STACK_TASK_OTHER;
+}
+
+static uint16_t stack_mon_bytes(uint32_t bytes)
+{
+    return bytes < STACK_MON_UNKNOWN ? (uint16_t)bytes : (uint16_t)(STACK_MON_UNKNOWN - 1U);
+}
+
+static void stack_mon_heap(void)
+{
+    HeapStats_t heap;
+
+    vPortGetHeapStats(&heap);
+    stats.heap_min_free = stack_mon_bytes(heap.xMinimumEverFreeBytesRemaining);
+    stats.heap_largest = stack_mon_bytes(heap.xSizeOfLargestFreeBlockInBytes);
+
+    if (!heap_low_logged && stats.heap_min_free < STACK_MON_HEAP_LOW_BYTES)
+    {
+        heap_low_logged = 1;
+        TLOG_WARNING("stack: heap low, %d bytes free at worst", stats.heap_min_free);
+    }
+    if (!block_low && stats.heap_largest < STACK_MON_BLOCK_LOW_BYTES)
+    {
+        block_low = 1;
+        TLOG_WARNING("stack: heap fragmented, largest block %d of %d free",
+                     stats.heap_largest, heap.xAvailableHeapSpaceInBytes);
+    }
+    else if (block_low && stats.heap_largest >= STACK_MON_BLOCK_LOW_BYTES)
+    {
+        block_low = 0;
+        TLOG_INFO("stack: heap largest block back to %d", stats.heap_largest);
+    }
+}
+
+void stack_mon_init(void)
+{
+    uint8_t i;
+
+    zboss_task = xTaskGetCurrentTaskHandle();
+    for (i = 0; i < STACK_TASK_COUNT; i++)
+    {
+        stats.free[i] = STACK_MON_UNKNOWN;
+    }
+    stats.min_free = STACK_MON_UNKNOWN;
+    stats.heap_min_free = STACK_MON_UNKNOWN;
+    stats.heap_largest = STACK_MON_UNKNOWN;
+}
+
+void stack_mon_sample(void)
+{
+    UBaseType_t n;
+    UBaseType_t i;
+
+    /* Returns 0 when there are more tasks than slots */
+    n = uxTaskGetSystemState(task_status, STACK_MON_MAX_TASKS, NULL);
+    if (n == 0)
+    {
+        TLOG_WARNING("stack: more than %d tasks", STACK_MON_MAX_TASKS);
+    }
+    stats.tasks = (uint8_t)n;
+
+    for (i = 0; i < n; i++)
+    {
+        stack_task_t id = stack_mon_classify(&task_status[i]);
+        uint16_t free = stack_mon_bytes((uint32_t)task_status[i].usStackHighWaterMark * sizeof(StackType_t));
+
+        if (free >= stats.free[id])
+        {
+            continue;
+        }
+        stats.free[id] = free;
+        if (free < stats.min_free)
+        {
+            stats.min_free = free;
+        }
+        if (free < STACK_MON_LOW_BYTES && !(stack_low_logged & (1U << id)))
+        {
+            stack_low_logged |= (uint8_t)(1U << id);
+            TLOG_WARNING("stack: task %d low, %d bytes free", id, free);
+        }
+        else
+        {
+            TLOG_INFO("stack: task %d %d bytes free", id, free);
+        }
+    }
+
+    stack_mon_heap();
+}
+
+const stack_mon_stats_t *stack_mon_get_stats(void)
+{
+    return &stats;
+}
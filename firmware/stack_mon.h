@@ -0,0 +1,57 @@
+#ifndef STACK_MON_H
+#define STACK_MON_H
+
+#include <stdint.h>
+
+/*
+ * Stack and heap high-water marks. FreeRTOS fills every task stack with a
+ * known byte when the task is created (tskSET_NEW_STACKS_TO_KNOWN_VALUE,
+ * on because the TI FreeRTOSConfig.h enables uxTaskGetStackHighWaterMark
+ * and the trace facility). stack_mon_sample() walks all tasks with
+ * uxTaskGetSystemState() and keeps, per task, the fewest stack bytes that
+ * have never been written. The ZBOSS thread (the pthread that runs MAIN()),
+ * the sensor worker, idle and the timer service have their own slot; any
+ * other task shares STACK_TASK_OTHER. The heap figures come from
+ * vPortGetHeapStats() (heap_4).
+ *
+ * Marks only ever fall. Each new low is logged through tlog ("stack: task
+ * %d %d bytes free", task numbers as in stack_task_t), so a soak shows how
+ * close every stack came to its end. A task dropping below
+ * STACK_MON_LOW_BYTES, and the heap dropping below its thresholds, are
+ * logged as warnings once. The largest free block can recover, so that is
+ * logged again when it does.
+ *
+ * The walk reads the untouched part of each stack with the scheduler
+ * suspended; diag_refresh() runs it once a minute.
+ */
+
+typedef enum {
+    STACK_TASK_ZBOSS,
+    STACK_TASK_WORKER,
+    STACK_TASK_IDLE,
+    STACK_TASK_TIMER,
+    STACK_TASK_OTHER,
+    STACK_TASK_COUNT
+} stack_task_t;
+
+/* Below this an exception frame and one more call level may overflow */
+#define STACK_MON_LOW_BYTES         128
+#define STACK_MON_HEAP_LOW_BYTES    512     /* Minimum ever free */
+#define STACK_MON_BLOCK_LOW_BYTES   256     /* Largest free block */
+#define STACK_MON_MAX_TASKS         8       /* Tasks walked per sample */
+#define STACK_MON_UNKNOWN           0xFFFF  /* Task not seen yet */
+
+typedef struct {
+    uint16_t free[STACK_TASK_COUNT];        /* Bytes never used, at most UINT16_MAX - 1 */
+    uint16_t min_free;                      /* Over all tasks */
+    uint16_t heap_min_free;                 /* Since boot */
+    uint16_t heap_largest;                  /* At the last sample */
+    uint8_t tasks;                          /* Seen at the last sample */
+} stack_mon_stats_t;
+
+/* Call once from the ZBOSS thread, before the first sample */
+void stack_mon_init(void);
+void stack_mon_sample(void);
+const stack_mon_stats_t *stack_mon_get_stats(void);
+
+#endif /* STACK_MON_H */
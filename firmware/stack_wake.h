@@ -0,0 +1,16 @@
+#ifndef STACK_WAKE_H
+#define STACK_WAKE_H
+
+/*
+ * Ends the ZBOSS thread's idle wait on wakeSem (osif/ti_f3_main.c) so
+ * my_main_loop() runs now instead of at the stack's next timeout. Callable
+ * from a task or an ISR; a post that finds the thread awake only costs one
+ * more loop iteration.
+ *
+ * zb_osif_wake_up() cannot do this: the stack calls it itself on the way
+ * out of every sleep, and a post there would leave wakeSem set and the
+ * thread spinning.
+ */
+void stack_wake(void);
+
+#endif /* STACK_WAKE_H */
@@ -0,0 +1,49 @@
+#include "tlog.h"
+#include "app_clock.h"
+
+#include <ti/drivers/dpl/HwiP.h>
+
+/* Zero-initialised, so a dump taken before the first write shows no magic */
+tlog_t tlog;
+
+static uint32_t tlog_used(void)
+{
+    return (tlog.head + TLOG_RING_WORDS - tlog.tail) % TLOG_RING_WORDS;
+}
+
+void tlog_write(const char *fmt, uint32_t nargs, const uint32_t *args)
+{
+    /* Record: token | nargs, timestamp (ms), args */
+    uint32_t len = 2U + nargs;
+    uint32_t now = app_time_ms();
+    uintptr_t key;
+    uint32_t i;
+
+    key = HwiP_disable();
+
+    if (tlog.magic != TLOG_MAGIC)
+    {
+        tlog.magic = TLOG_MAGIC;
+        tlog.head = 0;
+        tlog.tail = 0;
+    }
+
+    /* Evict whole records from the tail; head == tail only when empty */
+    while (TLOG_RING_WORDS - tlog_used() <= len)
+    {
+        tlog.tail = (tlog.tail + 2U + (tlog.ring[tlog.tail] & TLOG_MAX_ARGS)) % TLOG_RING_WORDS;
+        tlog.dropped++;
+    }
+
+    tlog.ring[tlog.head] = (uint32_t)(uintptr_t)fmt | nargs;
+    tlog.head = (tlog.head + 1U) % TLOG_RING_WORDS;
+    tlog.ring[tlog.head] = now;
+    tlog.head = (tlog.head + 1U) % TLOG_RING_WORDS;
+    for (i = 0; i < nargs; i++)
+    {
+        tlog.ring[tlog.head] = args[i];
+        tlog.head = (tlog.head + 1U) % TLOG_RING_WORDS;
+    }
+
+    HwiP_restore(key);
+}
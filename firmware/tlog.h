@@ -0,0 +1,84 @@
+#ifndef TLOG_H
+#define TLOG_H
+
+#include <stdint.h>
+
+/*
+ * Tokenized logging. A call site stores only the address of its format
+ * string, a timestamp and up to 7 raw 32-bit arguments in a RAM ring. The
+ * strings go to .tlog_fmt, a COPY section that is kept in the ELF but not
+ * flashed. tools/tlog_decode.py turns a dump of `tlog` back into text.
+ *
+ *   TLOG_INFO("send_on_req %d", param);
+ *
+ * Arguments are stored as uint32_t: integers only, no %s and no floats.
+ */
+
+#define TLOG_LEVEL_DEBUG            0
+#define TLOG_LEVEL_INFO             1
+#define TLOG_LEVEL_WARNING          2
+#define TLOG_LEVEL_ERROR            3
+#define TLOG_LEVEL_NONE             4
+
+/* Sites below this level compile to nothing; override from the build flags */
+#ifndef TLOG_LEVEL
+#define TLOG_LEVEL                  TLOG_LEVEL_INFO
+#endif
+
+#define TLOG_RING_WORDS             512     /* 2 KB of SRAM */
+#define TLOG_MAX_ARGS               7
+
+/* Exported for the debugger: dump sizeof(tlog) bytes from &tlog */
+typedef struct {
+    uint32_t magic;             /* TLOG_MAGIC once initialised */
+    uint32_t head;              /* Next word to write */
+    uint32_t tail;              /* First word of the oldest record */
+    uint32_t dropped;           /* Records evicted to make room */
+    uint32_t ring[TLOG_RING_WORDS];
+} tlog_t;
+
+#define TLOG_MAGIC                  0x474F4C54U     /* "TLOG" */
+
+extern tlog_t tlog;
+
+/* Use the TLOG_* macros: fmt must be 8-byte aligned so nargs fits in the token's low bits */
+void tlog_write(const char *fmt, uint32_t nargs, const uint32_t *args);
+
+#define TLOG_STR_(x)                #x
+#define TLOG_STR(x)                 TLOG_STR_(x)
+/* Counts 1..8: the TLOG_* wrappers append a 0 so empty argument lists work */
+#define TLOG_NARGS_(_1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+#define TLOG_NARGS(...)             TLOG_NARGS_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+
+/* The record is "<level>|<file>:<line>|<format>", 8-byte aligned so the token keeps 3 spare bits */
+#define TLOG_SITE(lvl, fmt, ...)                                                        \
+    do                                                                                  \
+    {                                                                                   \
+        static const char tlog_fmt_[] __attribute__((section(".tlog_fmt"), aligned(8), used)) = \
+            lvl "|" __FILE__ ":" TLOG_STR(__LINE__) "|" fmt;                           \
+        const uint32_t tlog_args_[TLOG_MAX_ARGS + 1] = { __VA_ARGS__ };                 \
+        tlog_write(tlog_fmt_, TLOG_NARGS(__VA_ARGS__) - 1U, tlog_args_);                \
+    } while (0)
+
+#if TLOG_LEVEL <= TLOG_LEVEL_DEBUG
+#define TLOG_DEBUG(...)             TLOG_SITE("D", __VA_ARGS__, 0)
+#else
+#define TLOG_DEBUG(...)             ((void)0)
+#endif
+#if TLOG_LEVEL <= TLOG_LEVEL_INFO
+#define TLOG_INFO(...)              TLOG_SITE("I", __VA_ARGS__, 0)
+#else
+#define TLOG_INFO(...)              ((void)0)
+#endif
+#if TLOG_LEVEL <= TLOG_LEVEL_WARNING
+#define TLOG_WARNING(...)           TLOG_SITE("W", __VA_ARGS__, 0)
+#else
+#define TLOG_WARNING(...)           ((void)0)
+#endif
+#if TLOG_LEVEL <= TLOG_LEVEL_ERROR
+#define TLOG_ERROR(...)             TLOG_SITE("E", __VA_ARGS__, 0)
+#else
+#define TLOG_ERROR(...)             ((void)0)
+#endif
+
+#endif /* TLOG_H */
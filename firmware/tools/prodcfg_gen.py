@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Generate production config blocks (firmware/prodcfg.h) for flashing.
+
+A block makes a unit steer only on the given channels, join only the given
+extended PAN, use its install code and bind straight to fixed targets. Write
+it next to the application image; the flash programmer must only erase the
+sectors it writes, or the block and the application erase each other.
+
+    tools/prodcfg_gen.py --elf Debug/on_off_switch.out --channel 15 \\
+        --ext-pan 00124b0001020304 --install-code random \\
+        --bind 00124b0012345678:1 -o unit.hex
+
+    # 200 units, each with its own random install code, plus manifest.csv
+    tools/prodcfg_gen.py --elf Debug/on_off_switch.out --channel 15 \\
+        --install-code random --units 200 --out-dir prodcfg/
+
+Addresses are written MSB first, as Z2M and sniffers show them. Register the
+install codes from the manifest with the coordinator before powering the units.
+"""
+
+import argparse
+import csv
+import os
+import secrets
+import struct
+import sys
+import zlib
+
+PRODCFG_MAGIC = 0x47464350
+PRODCFG_VERSION = 1
+PRODCFG_TARGETS = 4
+PRODCFG_IC_MAX = 18
+PRODCFG_SYMBOL = "prodcfg_block"
+IC_SIZES = (6, 8, 12, 16)
+CLUSTER_ON_OFF = 0x0006
+
+# magic, version, target_count, ic_len, reserved, channel_mask, ext_pan_id, install_code, reserved2
+HEADER = struct.Struct(f"<IBBBBI8s{PRODCFG_IC_MAX}s2x")
+TARGET = struct.Struct("<8sBxH")
+
+
+def ic_crc(code):
+    """CRC-16/X-25 of an install code, as the Zigbee spec defines it."""
+    crc = 0xFFFF
+    for byte in code:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8408 if crc & 1 else crc >> 1
+    return crc ^ 0xFFFF
+
+
+def parse_hex(text, what):
+    try:
+        return bytes.fromhex(text.replace(":", "").replace("-", ""))
+    except ValueError:
+        sys.exit(f"{what}: not a hex string: {text}")
+
+
+def parse_install_code(text):
+    """Returns the install code with its CRC appended, checking a CRC already present."""
+    if text == "random" or text.startswith("random:"):
+        bits = text[7:] or "128"
+        if not bits.isdigit() or int(bits) % 8 or int(bits) // 8 not in IC_SIZES:
+            sys.exit(f"install code: random:<48|64|96|128>, not {text}")
+        code = secrets.token_bytes(int(bits) // 8)
+    else:
+        code = parse_hex(text, "install code")
+        if len(code) - 2 in IC_SIZES:
+            crc, = struct.unpack_from("<H", code, len(code) - 2)
+            if crc != ic_crc(code[:-2]):
+                sys.exit(f"install code {text}: CRC is {crc:04x}, expected {ic_crc(code[:-2]):04x}")
+            return code
+        if len(code) not in IC_SIZES:
+            sys.exit(f"install code {text}: must be 6, 8, 12 or 16 bytes (plus an optional CRC)")
+    return code + struct.pack("<H", ic_crc(code))
+
+
+def parse_target(text):
+    """IEEE:EP[:CLUSTER] -> (ieee LSB first, ep, cluster)."""
+    parts = text.split(":")
+    if len(parts) not in (2, 3):
+        sys.exit(f"bind target: IEEE:EP[:CLUSTER], not {text}")
+    ieee = parse_hex(parts[0], "bind target")
+    if len(ieee) != 8:
+        sys.exit(f"bind target {text}: the IEEE address takes 16 hex digits")
+    ep = int(parts[1], 0)
+    cluster = int(parts[2], 0) if len(parts) > 2 else CLUSTER_ON_OFF
+    if not 1 <= ep <= 240 or not 0 <= cluster <= 0xFFFF:
+        sys.exit(f"bind target {text}: endpoint or cluster out of range")
+    return ieee[::-1], ep, cluster
+
+
+def build_block(channels, ext_pan, install_code, targets):
+    mask = 0
+    for channel in channels:
+        mask |= 1 << channel
+    body = HEADER.pack(PRODCFG_MAGIC, PRODCFG_VERSION, len(targets), len(install_code), 0,
+                       mask, ext_pan[::-1], install_code)
+    for i in range(PRODCFG_TARGETS):
+        body += TARGET.pack(*targets[i]) if i < len(targets) else TARGET.pack(b"\0" * 8, 0, 0)
+    return body + struct.pack("<I", zlib.crc32(body))
+
+
+def intel_hex(address, data):
+    """Intel HEX records for data at address, 16 bytes per line."""
+    def record(kind, offset, payload):
+        raw = struct.pack(">BHB", len(payload), offset, kind) + payload
+        return f":{raw.hex().upper()}{(-sum(raw)) & 0xFF:02X}\n"
+
+    lines = []
+    upper = None
+    for offset in range(0, len(data), 16):
+        at = address + offset
+        if at >> 16 != upper:
+            upper = at >> 16
+            lines.append(record(4, 0, struct.pack(">H", upper)))
+        lines.append(record(0, at & 0xFFFF, data[offset:offset + 16]))
+    lines.append(record(1, 0, b""))
+    return "".join(lines)
+
+
+def find_symbol(elf_path, name):
+    """Address of a symbol in a little-endian ELF32 image."""
+    with open(elf_path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF" or elf[4] != 1 or elf[5] != 1:
+        sys.exit(f"{elf_path}: not a little-endian ELF32 file")
+    shoff, = struct.unpack_from("<I", elf, 0x20)
+    shentsize, shnum = struct.unpack_from("<2H", elf, 0x2E)
+    sections = [struct.unpack_from("<IIIIIIIIII", elf, shoff + i * shentsize) for i in range(shnum)]
+
+    for _, sh_type, _, _, sh_offset, sh_size, sh_link, _, _, sh_entsize in sections:
+        if sh_type != 2:        # SHT_SYMTAB
+            continue
+        strtab = sections[sh_link][4]
+        for pos in range(sh_offset, sh_offset + sh_size, sh_entsize):
+            st_name, st_value = struct.unpack_from("<II", elf, pos)
+            start = strtab + st_name
+            if elf[start:elf.index(b"\0", start)].decode() == name:
+                return st_value
+    sys.exit(f"{elf_path}: no {name} symbol, is this an OTA build?")
+
+
+def write_block(path, base, block):
+    if path.endswith(".bin"):
+        with open(path, "wb") as f:
+            f.write(block)
+    else:
+        with open(path, "w") as f:
+            f.write(intel_hex(base, block))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    place = parser.add_mutually_exclusive_group(required=True)
+    place.add_argument("--elf", help="application image; the block goes to its prodcfg_block symbol")
+    place.add_argument("--base", type=lambda s: int(s, 0), help="flash address of the block")
+    parser.add_argument("--channel", type=int, action="append", required=True,
+                        help="channel to steer on (11-26), repeat for several")
+    parser.add_argument("--ext-pan", default="0" * 16, help="extended PAN ID to join, default any")
+    parser.add_argument("--install-code", help="hex code with or without CRC, or random[:48|64|96|128]")
+    parser.add_argument("--bind", action="append", default=[], metavar="IEEE:EP[:CLUSTER]",
+                        help=f"binding target, cluster defaults to On/Off; up to {PRODCFG_TARGETS}")
+    parser.add_argument("-o", "--output", help="output file, .hex or .bin")
+    parser.add_argument("--units", type=int, help="write this many blocks to --out-dir, with a manifest")
+    parser.add_argument("--out-dir", help="directory for --units")
+    args = parser.parse_args()
+
+    if any(not 11 <= channel <= 26 for channel in args.channel):
+        sys.exit("channels are 11-26")
+    ext_pan = parse_hex(args.ext_pan, "extended PAN ID")
+    if len(ext_pan) != 8:
+        sys.exit("the extended PAN ID takes 16 hex digits")
+    if len(args.bind) > PRODCFG_TARGETS:
+        sys.exit(f"at most {PRODCFG_TARGETS} binding targets")
+    targets = [parse_target(text) for text in args.bind]
+    base = find_symbol(args.elf, PRODCFG_SYMBOL) if args.elf else args.base
+
+    if args.units is None:
+        if not args.output:
+            sys.exit("give -o, or --units with --out-dir")
+        install_code = parse_install_code(args.install_code) if args.install_code else b""
+        write_block(args.output, base, build_block(args.channel, ext_pan, install_code, targets))
+        if install_code:
+            print(f"install code {install_code.hex().upper()}")
+        return
+
+    if not args.out_dir:
+        sys.exit("--units needs --out-dir")
+    if args.install_code and not args.install_code.startswith("random"):
+        sys.exit("--units needs --install-code random, or none: units must not share a code")
+    os.makedirs(args.out_dir, exist_ok=True)
+    with open(os.path.join(args.out_dir, "manifest.csv"), "w", newline="") as f:
+        manifest = csv.writer(f)
+        manifest.writerow(["file", "install_code"])
+        for unit in range(1, args.units + 1):
+            install_code = parse_install_code(args.install_code) if args.install_code else b""
+            name = f"unit-{unit:04d}.hex"
+            write_block(os.path.join(args.out_dir, name), base,
+                        build_block(args.channel, ext_pan, install_code, targets))
+            manifest.writerow([name, install_code.hex().upper()])
+    print(f"{args.units} blocks at 0x{base:08x} in {args.out_dir}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""RAM budget from TI linker map files (tiarmclang / tiarmlnk -m).
+
+Sums every input section placed in RAM by owner:
+
+- ZBOSS pools: the gc_* arrays that zb_mem_config_*.h defines in the
+  application's translation unit
+- ZBOSS: the rest of the stack libraries
+- FreeRTOS, other libraries, the application's own objects
+- stack/heap: the .stack and heap sections
+- padding: alignment holes
+
+    tools/ram_report.py Debug/on_off_switch.map
+    # before and after a memory configuration change
+    tools/ram_report.py before.map after.map
+
+With two maps each group is shown for both, with the difference, followed by
+the application objects and ZBOSS pools that changed most.
+"""
+
+import argparse
+import collections
+import re
+import sys
+
+MEMORY_RE = re.compile(r"^\s+(\S+)\s+([0-9a-fA-F]{8})\s+([0-9a-fA-F]{8})\s+([0-9a-fA-F]{8})\s+([0-9a-fA-F]{8})")
+OUTPUT_RE = re.compile(r"^(\.\S+|\S+)\s+(?:\d+\s+)?([0-9a-fA-F]{8})\s+([0-9a-fA-F]{8})")
+INPUT_RE = re.compile(r"^\s+([0-9a-fA-F]{8})\s+([0-9a-fA-F]{8})\s+(.*?)\s*$")
+OBJECT_RE = re.compile(r"^(?:(\S+)\s+:\s+)?(\S+)\s+\((\S+)\)$")
+STACK_HEAP = (".stack", ".sysmem", ".heap", ".ucHeap")
+
+
+class RamMap:
+    def __init__(self, path):
+        self.path = path
+        self.regions = []           # (name, origin, length, used)
+        self.groups = collections.Counter()
+        self.objects = collections.Counter()
+        self.pools = collections.Counter()
+        self.parse()
+
+    def in_ram(self, addr):
+        return any(origin <= addr < origin + length for _, origin, length, _ in self.regions)
+
+    def parse(self):
+        with open(self.path, errors="replace") as f:
+            lines = f.read().splitlines()
+
+        part = None
+        output = None
+        for line in lines:
+            if line.startswith("MEMORY CONFIGURATION"):
+                part = "memory"
+                continue
+            if line.startswith("SEGMENT ALLOCATION MAP"):
+                part = None
+                continue
+            if line.startswith("SECTION ALLOCATION MAP"):
+                part = "sections"
+                continue
+            if line.startswith(("MODULE SUMMARY", "GLOBAL SYMBOLS", "LINKER GENERATED")):
+                part = None
+                continue
+
+            if part == "memory":
+                m = MEMORY_RE.match(line)
+                if m and "RAM" in m.group(1).upper():
+                    self.regions.append((m.group(1), int(m.group(2), 16), int(m.group(3), 16),
+                                         int(m.group(4), 16)))
+            elif part == "sections":
+                m = OUTPUT_RE.match(line)
+                if m and not line[0].isspace():
+                    output = m.group(1)
+                    continue
+                m = INPUT_RE.match(line)
+                if m and self.in_ram(int(m.group(1), 16)):
+                    self.add(output, int(m.group(2), 16), m.group(3))
+
+        if not self.regions:
+            sys.exit(f"{self.path}: no RAM region in MEMORY CONFIGURATION, is this a TI linker map?")
+
+    def add(self, output, size, what):
+        if output in STACK_HEAP:
+            self.groups["stack/heap"] += size
+            return
+        if what.startswith("--HOLE--"):
+            self.groups["padding"] += size
+            return
+
+        m = OBJECT_RE.match(what)
+        if m is None:
+            self.groups["other"] += size
+            return
+        lib, obj, section = m.groups()
+        symbol = section.split(":")[-1].split(".")[-1]
+
+        if symbol.startswith("gc_"):
+            self.groups["ZBOSS pools"] += size
+            self.pools[symbol] += size
+        elif lib is None:
+            self.groups["application"] += size
+            self.objects[obj] += size
+        elif "zb" in lib.lower() or "zigbee" in lib.lower():
+            self.groups["ZBOSS"] += size
+        elif "freertos" in lib.lower():
+            self.groups["FreeRTOS"] += size
+        else:
+            self.groups[lib.rsplit("/", 1)[-1].rsplit("\\", 1)[-1]] += size
+
+    def summary(self):
+        return ", ".join(f"{name} {length} bytes, {used} used, {length - used} free"
+                         for name, _, length, used in self.regions)
+
+
+def table(rows, headers):
+    widths = [max(len(str(row[i])) for row in rows + [headers]) for i in range(len(headers))]
+    out = ["  ".join(str(h).ljust(w) if i == 0 else str(h).rjust(w)
+                     for i, (h, w) in enumerate(zip(headers, widths)))]
+    for row in rows:
+        out.append("  ".join(str(c).ljust(w) if i == 0 else str(c).rjust(w)
+                             for i, (c, w) in enumerate(zip(row, widths))))
+    return "\n".join(out)
+
+
+def signed(n):
+    return f"{n:+d}" if n else "0"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("map", help="linker map file")
+    parser.add_argument("after", nargs="?", help="second map to compare against the first")
+    parser.add_argument("--top", type=int, default=10, help="objects and pools to list (default 10)")
+    args = parser.parse_args()
+
+    before = RamMap(args.map)
+    if args.after is None:
+        print(f"{before.path}: {before.summary()}\n")
+        rows = [(name, size) for name, size in before.groups.most_common()]
+        rows.append(("total", sum(before.groups.values())))
+        print(table(rows, ("group", "bytes")))
+        for title, counter in (("application objects", before.objects), ("ZBOSS pools", before.pools)):
+            if counter:
+                print(f"\n{title}\n" + table(counter.most_common(args.top), ("name", "bytes")))
+        return
+
+    after = RamMap(args.after)
+    print(f"before {before.path}: {before.summary()}")
+    print(f"after  {after.path}: {after.summary()}\n")
+    names = sorted(set(before.groups) | set(after.groups), key=lambda n: -max(before.groups[n], after.groups[n]))
+    rows = [(n, before.groups[n], after.groups[n], signed(after.groups[n] - before.groups[n])) for n in names]
+    total_before, total_after = sum(before.groups.values()), sum(after.groups.values())
+    rows.append(("total", total_before, total_after, signed(total_after - total_before)))
+    print(table(rows, ("group", "before", "after", "delta")))
+
+    for title, b, a in (("application objects", before.objects, after.objects),
+                        ("ZBOSS pools", before.pools, after.pools)):
+        changed = [(n, b[n], a[n], signed(a[n] - b[n])) for n in set(b) | set(a) if a[n] != b[n]]
+        if changed:
+            changed.sort(key=lambda r: -abs(r[2] - r[1]))
+            print(f"\n{title}, largest changes\n" + table(changed[:args.top], ("name", "before", "after", "delta")))
+
+
+if __name__ == "__main__":
+    main()
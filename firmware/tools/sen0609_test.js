@@ -0,0 +1,228 @@
+#!/usr/bin/env node
+/*
+ * Tests the write coalescing and reconciliation in firmware/sen0609.js, and
+ * its light-rule encoding, with plain node and no packages: the
+ * zigbee-herdsman modules are replaced by inert stubs and the device by a
+ * mock endpoint that records every write, read and command. Exits with
+ * status 1 if any test failed.
+ *
+ *   node firmware/tools/sen0609_test.js
+ */
+const assert = require('assert');
+const Module = require('module');
+const path = require('path');
+
+/* Any property, call or number conversion of a stub yields another stub (or 0) */
+const stub = () => new Proxy(function () {}, {
+    get: (target, prop) => {
+        if (prop === Symbol.toPrimitive) return () => 0;
+        if (prop === 'then') return undefined;
+        return stub();
+    },
+    apply: () => stub(),
+});
+const load = Module._load;
+Module._load = function (request, ...rest) {
+    if (request.startsWith('zigbee-herdsman')) return stub();
+    return load.call(this, request, ...rest);
+};
+const definition = require(path.join(__dirname, '..', 'sen0609.js'));
+
+const tzConfig = definition.toZigbee.find((c) => c.key.includes('assert_dwell'));
+const fzConfig = definition.fromZigbee.find((c) => c.cluster === 'msOccupancySensing' &&
+    c.type.includes('readResponse'));
+
+const ID = {range_min: 0xE000, range_max: 0xE001, assert_dwell: 0xE009, release_dwell: 0xE00A,
+    min_hold: 0xE00B, active_profile: 0xE00F, snapshot: 0xE00E, light_rules: 0xE022};
+/* Radar settings as the snapshot carries them, and as the device reports them */
+const RADAR = {range_min: 30, range_max: 600, trigger_range: 600, trigger_sensitivity: 7,
+    keep_sensitivity: 7, trigger_delay: 0, keep_timeout: 60, io_polarity: 1, fretting: true};
+const SNAPSHOT = Buffer.from([30, 0, 0x58, 2, 0x58, 2, 7, 7, 0, 60, 0, 1, 1]);
+
+/*
+ * A device endpoint. `fail` maps an attribute id to the number of writes of
+ * it to refuse (Infinity: always); the other attributes of the frame still
+ * apply, as with a ZCL Write Attributes.
+ */
+const mockEndpoint = (fail = {}) => {
+    const endpoint = {
+        writes: [],
+        reads: [],
+        commands: [],
+        attrs: {},
+        write: async (cluster, payload) => {
+            endpoint.writes.push(Object.keys(payload).map(Number));
+            let failed = false;
+            for (const [id, {value}] of Object.entries(payload)) {
+                if (fail[id] > 0) {
+                    fail[id]--;
+                    failed = true;
+                } else {
+                    endpoint.attrs[id] = value;
+                }
+            }
+            if (failed) throw new Error('Status FAILURE');
+        },
+        read: async (cluster, ids) => {
+            endpoint.reads.push(ids);
+            const result = {};
+            for (const id of ids) {
+                if (endpoint.attrs[id] !== undefined) result[id] = endpoint.attrs[id];
+            }
+            return result;
+        },
+        command: async (cluster, name, payload) => {
+            endpoint.commands.push({name, config: payload.config});
+        },
+    };
+    return endpoint;
+};
+
+let devices = 0;
+
+/* A device that has reported every radar setting plus the given MCU-side attributes */
+const reportedDevice = (attrs = {}) => {
+    const device = {ieeeAddr: `0x00124b00000000${String(++devices).padStart(2, '0')}`};
+    const data = {[ID.snapshot]: SNAPSHOT};
+    for (const [key, value] of Object.entries(attrs)) data[ID[key]] = value;
+    const result = fzConfig.convert({}, {device, data}, () => {}, {}, {});
+    assert.deepStrictEqual(result, {...RADAR, ...attrs});
+    return device;
+};
+
+const set = (endpoint, device, key, value) =>
+    tzConfig.convertSet(endpoint, key, value, {device, state: {}, logger: console});
+
+const tests = {
+    'a value the device already reports is not written': async () => {
+        const endpoint = mockEndpoint();
+        const device = reportedDevice({assert_dwell: 5});
+        await set(endpoint, device, 'assert_dwell', 5);
+        assert.deepStrictEqual(endpoint.writes, []);
+        assert.deepStrictEqual(endpoint.commands, []);
+    },
+    'a burst of one key sends only its last value': async () => {
+        const endpoint = mockEndpoint();
+        const device = reportedDevice({assert_dwell: 5});
+        await Promise.all([10, 20, 30].map((v) => set(endpoint, device, 'assert_dwell', v)));
+        assert.deepStrictEqual(endpoint.writes, [[ID.assert_dwell]]);
+        assert.strictEqual(endpoint.attrs[ID.assert_dwell], 30);
+    },
+    'keys set together go out in one Write Attributes frame': async () => {
+        const endpoint = mockEndpoint();
+        const device = reportedDevice();
+        await Promise.all([set(endpoint, device, 'assert_dwell', 10), set(endpoint, device, 'min_hold', 50)]);
+        assert.deepStrictEqual(endpoint.writes, [[ID.assert_dwell, ID.min_hold]]);
+    },
+    'writes after the coalescing window are separate': async () => {
+        const endpoint = mockEndpoint();
+        const device = reportedDevice();
+        await set(endpoint, device, 'assert_dwell', 10);
+        await set(endpoint, device, 'assert_dwell', 20);
+        assert.deepStrictEqual(endpoint.writes, [[ID.assert_dwell], [ID.assert_dwell]]);
+    },
+    'two radar settings go as one sen0609SetConfig': async () => {
+        const endpoint = mockEndpoint();
+        const device = reportedDevice();
+        await Promise.all([set(endpoint, device, 'range_min', 50), set(endpoint, device, 'range_max', 800)]);
+        assert.deepStrictEqual(endpoint.writes, []);
+        assert.strictEqual(endpoint.commands.length, 1);
+        const {name, config} = endpoint.commands[0];
+        assert.strictEqual(name, 'sen0609SetConfig');
+        const expected = Buffer.from(SNAPSHOT);
+        expected.writeUInt16LE(50, 0);
+        expected.writeUInt16LE(800, 2);
+        assert.deepStrictEqual(config, expected);
+    },
+    'one radar setting goes as an attribute write': async () => {
+        const endpoint = mockEndpoint();
+        const device = reportedDevice();
+        await set(endpoint, device, 'range_min', 50);
+        assert.deepStrictEqual(endpoint.writes, [[ID.range_min]]);
+        assert.deepStrictEqual(endpoint.commands, []);
+    },
+    'an action key is written even when unchanged': async () => {
+        const endpoint = mockEndpoint();
+        const device = reportedDevice({active_profile: 1});
+        await set(endpoint, device, 'active_profile', 1);
+        assert.deepStrictEqual(endpoint.writes, [[ID.active_profile]]);
+    },
+    'only the attribute that failed is retried': async () => {
+        const endpoint = mockEndpoint({[ID.release_dwell]: 1});
+        const device = reportedDevice();
+        await Promise.all([set(endpoint, device, 'assert_dwell', 10), set(endpoint, device, 'release_dwell', 20)]);
+        assert.deepStrictEqual(endpoint.writes, [[ID.assert_dwell, ID.release_dwell], [ID.release_dwell]]);
+        assert.deepStrictEqual(endpoint.reads, [[ID.assert_dwell, ID.release_dwell]]);
+        assert.strictEqual(endpoint.attrs[ID.release_dwell], 20);
+    },
+    'a key the device keeps refusing rejects only its own set': async () => {
+        const endpoint = mockEndpoint({[ID.release_dwell]: Infinity});
+        const device = reportedDevice();
+        const results = await Promise.allSettled([set(endpoint, device, 'assert_dwell', 10),
+            set(endpoint, device, 'release_dwell', 20)]);
+        assert.strictEqual(results[0].status, 'fulfilled');
+        assert.strictEqual(results[1].status, 'rejected');
+        assert.match(results[1].reason.message, /release_dwell/);
+    },
+    'a value once written is not written again': async () => {
+        const endpoint = mockEndpoint({[ID.release_dwell]: Infinity});
+        const device = reportedDevice();
+        await Promise.allSettled([set(endpoint, device, 'assert_dwell', 10),
+            set(endpoint, device, 'release_dwell', 20)]);
+        endpoint.writes = [];
+        await Promise.allSettled([set(endpoint, device, 'assert_dwell', 10),
+            set(endpoint, device, 'release_dwell', 20)]);
+        assert.deepStrictEqual(endpoint.writes, [[ID.release_dwell], [ID.release_dwell]]);
+    },
+    'a rule carries a 16-bit group ID both ways': async () => {
+        const endpoint = mockEndpoint();
+        const device = reportedDevice();
+        await set(endpoint, device, 'light_rules', 'occupied scene 3 group=4660; vacant+300 level 40 fade=600');
+        const rules = endpoint.attrs[ID.light_rules];
+        assert.strictEqual(rules.length, 26);
+        assert.strictEqual(rules.readUInt16LE(11), 4660);
+        assert.strictEqual(rules.readUInt16LE(13 + 11), 600);
+        const result = fzConfig.convert({}, {device, data: {[ID.light_rules]: rules}}, () => {}, {}, {});
+        assert.strictEqual(result.light_rules, 'occupied scene 3 group=4660; vacant+300 level 40 fade=600');
+    },
+    'a rule option that does not apply to its action is refused': async () => {
+        const endpoint = mockEndpoint();
+        const device = reportedDevice();
+        for (const rules of ['occupied on fade=20', 'occupied level 40 group=5', 'vacant off group=5',
+            'occupied scene 3 fade=20', 'occupied scene 3 group=65528']) {
+            await assert.rejects(set(endpoint, device, 'light_rules', rules), /does not apply|out of range/, rules);
+        }
+        assert.deepStrictEqual(endpoint.writes, []);
+    },
+    'vacant_for is reported on a change of a minute, the other statistics on any change': async () => {
+        const reports = {};
+        const endpoint = {
+            ...mockEndpoint(),
+            configureReporting: async (cluster, attrs) => {
+                for (const a of attrs) reports[a.attribute.ID ?? a.attribute] = a;
+            },
+        };
+        await definition.configure({getEndpoint: () => endpoint}, {}, definition);
+        assert.strictEqual(reports[0xE01F].reportableChange, 60);
+        for (const id of [0xE01A, 0xE01B, 0xE01C, 0xE01D, 0xE01E]) {
+            assert.strictEqual(reports[id].reportableChange, 1);
+            assert.strictEqual(reports[id].minimumReportInterval, 300);
+        }
+    },
+};
+
+const main = async () => {
+    let failed = 0;
+    for (const [name, test] of Object.entries(tests)) {
+        try {
+            await test();
+            console.log(`ok      ${name}`);
+        } catch (error) {
+            failed++;
+            console.log(`FAILED  ${name}\n${error.stack}`);
+        }
+    }
+    process.exit(failed > 0 ? 1 : 0);
+};
+
+main();
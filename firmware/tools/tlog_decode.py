@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Decode a tlog ring buffer dump using the token table of the same build.
+
+Dump sizeof(tlog) bytes starting at &tlog to a raw binary file (CCS: Memory
+Browser -> Save Memory, or `mem save` in your debugger), then:
+
+    tools/tlog_decode.py --elf Debug/on_off_switch.out tlog.bin
+    tools/tlog_decode.py --elf Debug/on_off_switch.out --list
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+TLOG_MAGIC = 0x474F4C54
+TLOG_NARGS_MASK = 7
+LEVELS = {"D": "DEBUG", "I": "INFO", "W": "WARN", "E": "ERROR"}
+CONVERSION = re.compile(r"%[-+ #0]*\d*(?:\.\d+)?(?:hh|h|ll|l)?([diouxXc%])")
+
+
+def read_section(elf_path, name):
+    """Returns (address, contents) of a section in a little-endian ELF32/ELF64 image."""
+    with open(elf_path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF" or elf[5] != 1:
+        sys.exit(f"{elf_path}: not a little-endian ELF file")
+    if elf[4] == 1:
+        shoff, = struct.unpack_from("<I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<3H", elf, 0x2E)
+        header = "<IIIIII"
+    else:
+        shoff, = struct.unpack_from("<Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from("<3H", elf, 0x3A)
+        header = "<IIQQQQ"
+
+    sections = [struct.unpack_from(header, elf, shoff + i * shentsize) for i in range(shnum)]
+    names = sections[shstrndx]
+    for sh_name, _, _, sh_addr, sh_offset, sh_size in sections:
+        start = names[4] + sh_name
+        if elf[start:elf.index(b"\0", start)].decode() == name:
+            return sh_addr, elf[sh_offset:sh_offset + sh_size]
+    sys.exit(f"{elf_path}: no {name} section, is this a tlog build?")
+
+
+def load_tokens(elf_path):
+    """Maps token address -> (level, site, format) from the .tlog_fmt section."""
+    base, data = read_section(elf_path, ".tlog_fmt")
+
+    tokens = {}
+    offset = 0
+    while offset < len(data):
+        end = data.find(b"\0", offset)
+        if end < 0:
+            break
+        text = data[offset:end].decode("utf-8", "replace")
+        if text:
+            level, site, fmt = text.split("|", 2)
+            tokens[base + offset] = (LEVELS.get(level, level), os.path.basename(site), fmt)
+        # Every site is 8-byte aligned
+        offset = (end + 8) & ~7
+    return tokens
+
+
+def format_record(fmt, args):
+    out = []
+    pos = 0
+    args = list(args)
+    for m in CONVERSION.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        conv = m.group(1)
+        if conv == "%":
+            out.append("%")
+            continue
+        value = args.pop(0) if args else 0
+        if conv in "di":
+            value = struct.unpack("<i", struct.pack("<I", value))[0]
+        spec = re.sub(r"(hh|h|ll|l)", "", m.group(0))
+        if conv == "u":
+            spec = spec[:-1] + "d"
+        out.append(spec % value)
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def decode(dump, tokens):
+    magic, head, tail, dropped = struct.unpack_from("<4I", dump, 0)
+    if magic != TLOG_MAGIC:
+        sys.exit("dump does not start with the tlog magic; nothing logged yet or wrong address")
+    ring = struct.unpack_from(f"<{(len(dump) - 16) // 4}I", dump, 16)
+    size = len(ring)
+
+    if dropped:
+        print(f"# {dropped} older records were overwritten")
+
+    i = tail
+    while i != head:
+        word = ring[i]
+        nargs = word & TLOG_NARGS_MASK
+        stamp = ring[(i + 1) % size]
+        args = [ring[(i + 2 + n) % size] for n in range(nargs)]
+        i = (i + 2 + nargs) % size
+
+        token = word & ~TLOG_NARGS_MASK
+        if token in tokens:
+            level, site, fmt = tokens[token]
+            text = format_record(fmt, args)
+        else:
+            level, site, text = "?", f"0x{token:08x}", " ".join(f"0x{a:x}" for a in args)
+        print(f"[{stamp / 1000:10.3f}] {level:5} {site:24} {text}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--elf", required=True, help="linked image of the build that produced the dump")
+    parser.add_argument("--list", action="store_true", help="print the token table and exit")
+    parser.add_argument("dump", nargs="?", help="raw binary dump of the tlog struct")
+    args = parser.parse_args()
+
+    tokens = load_tokens(args.elf)
+    if args.list:
+        for token, (level, site, fmt) in sorted(tokens.items()):
+            print(f"0x{token:08x} {level:5} {site:24} {fmt}")
+        return
+    if args.dump is None:
+        parser.error("a dump file is required unless --list is given")
+
+    with open(args.dump, "rb") as f:
+        decode(f.read(), tokens)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,94 @@
+#ifndef ZB_MEM_CONFIG_SENSOR_H
+#define ZB_MEM_CONFIG_SENSOR_H
+
+/*
+ * ZBOSS memory configuration for the end device build, used in place of
+ * zb_mem_config_lprf3.h when ZB_CONFIGURABLE_MEM is defined. It starts from
+ * the smallest ZBOSS preset and then sizes the pools this application
+ * touches from what it actually does:
+ * - one endpoint
+ * - up to LIGHTS_MAX bound lights, plus the coordinator's reporting bindings
+ * - one parent
+ * - no groups of its own
+ *
+ * Build with ZB_MEM_PROFILE (mem_profile.h) and soak the device to check
+ * the peaks against these sizes before changing them. tools/ram_report.py
+ * shows what the change does to the RAM budget.
+ */
+
+#define ZB_CONFIG_ROLE_ZED
+#define ZB_CONFIG_OVERALL_NETWORK_SIZE      32
+#define ZB_CONFIG_LIGHT_TRAFFIC
+#define ZB_CONFIG_APPLICATION_SIMPLE
+
+#include "zb_mem_config_common.h"
+#include "lights.h"
+
+/*
+ * Buffers. A frame sent through the light bindings holds the original plus
+ * one copy per light. At most this many are in flight after an edge:
+ * - the poll
+ * - the stack's own APS ack and incoming frames: 3
+ * - On/Off through the bindings: 1 + LIGHTS_MAX. Sent to known lights one
+ *   at a time, it takes one.
+ * - a Level or Scene rule through the bindings: 1 + LIGHTS_MAX
+ * - the occupancy report and its copy for the coordinator: 2
+ * - the diagnostics or clock read
+ * set_tx_power() takes one buffer per channel in the channel mask, all at
+ * once, whenever the stack starts or steering begins. Sixteen channels is
+ * the whole 2.4 GHz mask.
+ */
+#define SENSOR_IOBUF_BOUND                  (1 + LIGHTS_MAX)
+#define SENSOR_IOBUF_EDGE                   (1 + 3 + 2 * SENSOR_IOBUF_BOUND + 2 + 1)
+#define SENSOR_IOBUF_CHANNELS               16
+#undef ZB_CONFIG_IOBUF_POOL_SIZE
+#define ZB_CONFIG_IOBUF_POOL_SIZE           (SENSOR_IOBUF_EDGE + SENSOR_IOBUF_CHANNELS)
+
+/* About 15 application alarms (each one pending at most once) and the stack's own */
+#undef ZB_CONFIG_SCHEDULER_Q_SIZE
+#define ZB_CONFIG_SCHEDULER_Q_SIZE          24
+
+/*
+ * Bindings. finding_binding_cb() binds the On/Off, Level and Scenes clients,
+ * and only to the LIGHTS_MAX lights the table holds. Z2M's configure binds
+ * Occupancy Sensing and Diagnostics reporting to the coordinator. ZBOSS keeps
+ * a source entry per cluster and a destination entry per (cluster,
+ * destination) pair. A production config binds at most PRODCFG_TARGETS
+ * (cluster, light) pairs in place of finding & binding; they fit as long as
+ * their clusters are among these three.
+ */
+#define SENSOR_LIGHT_CLUSTERS               3
+#define SENSOR_COORD_BINDS                  2
+#undef ZB_CONFIG_APS_SRC_BINDING_TABLE_SIZE
+#define ZB_CONFIG_APS_SRC_BINDING_TABLE_SIZE (SENSOR_LIGHT_CLUSTERS + SENSOR_COORD_BINDS)
+#undef ZB_CONFIG_APS_DST_BINDING_TABLE_SIZE
+#define ZB_CONFIG_APS_DST_BINDING_TABLE_SIZE (SENSOR_LIGHT_CLUSTERS * LIGHTS_MAX + SENSOR_COORD_BINDS)
+/*
+ * Frames going out through the bindings at once:
+ * - the occupancy report
+ * - a Diagnostics report
+ * - a Level or Scene rule
+ * - On/Off sent through the bindings, before the lights are relearned after a reboot
+ * - two more Occupancy Sensing statistics reports due in the same pass
+ */
+#undef ZB_CONFIG_APS_BIND_TRANS_TABLE_SIZE
+#define ZB_CONFIG_APS_BIND_TRANS_TABLE_SIZE 6
+
+/* No Groups server: scenes are only recalled on groups, never stored */
+#undef ZB_CONFIG_APS_GROUP_TABLE_SIZE
+#define ZB_CONFIG_APS_GROUP_TABLE_SIZE      1
+
+/* Parent, coordinator, four lights and room for devices that address us */
+#undef ZB_CONFIG_IEEE_ADDR_TABLE_SIZE
+#define ZB_CONFIG_IEEE_ADDR_TABLE_SIZE      16
+
+/* APS-acked frames in flight: a report, an On/Off and a Level or Scene rule
+ * to each light through the bindings, and the clock read */
+#undef ZB_CONFIG_N_APS_RETRANS_ENTRIES
+#define ZB_CONFIG_N_APS_RETRANS_ENTRIES     (2 * LIGHTS_MAX + 2)
+#undef ZB_CONFIG_APS_DUPS_TABLE_SIZE
+#define ZB_CONFIG_APS_DUPS_TABLE_SIZE       8
+
+#include "zb_mem_config_context.h"
+
+#endif /* ZB_MEM_CONFIG_SENSOR_H */
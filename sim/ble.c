@@ -0,0 +1,161 @@
+#include "ble.h"
+#include "dmm_policy.h"
+#include "radio.h"
+#include "stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    dmm_policy_t policy;
+    uint8_t zigbee_tx;          /* Transmissions in progress; the model does not serialise them */
+    uint8_t edge_pending;       /* The current sequence number has not been on air yet */
+    uint32_t gen;               /* Stale service and event-end events are ignored */
+    sim_time_t edge;
+    sim_time_t on_air_from;     /* Last BLE event */
+    sim_time_t on_air_until;
+} ble_node_t;
+
+static ble_node_t *ble_nodes;
+static uint32_t ble_count;
+
+static uint32_t ble_now(void)
+{
+    return (uint32_t)sched_now();
+}
+
+static void ble_service(void *ctx, uint32_t arg);
+
+static void ble_reschedule(ble_node_t *b, sim_time_t delay)
+{
+    sched_after(delay, ble_service, b, ++b->gen);
+}
+
+static void ble_event_end(void *ctx, uint32_t arg)
+{
+    ble_node_t *b = ctx;
+
+    if (arg != b->gen)
+    {
+        return;
+    }
+    dmm_policy_ble_done(&b->policy, 1, ble_now());
+    stats.ble_events++;
+    if (b->edge_pending && b->policy.air_seq == b->policy.seq)
+    {
+        b->edge_pending = 0;
+        stats_latency(STATS_LAT_BLE_E2E, sched_now() - b->edge);
+    }
+    ble_service(b, b->gen);
+}
+
+static void ble_service(void *ctx, uint32_t arg)
+{
+    ble_node_t *b = ctx;
+    uint32_t deferred = b->policy.deferred;
+    uint32_t wait_us;
+
+    if (arg != b->gen)
+    {
+        return;
+    }
+    wait_us = dmm_policy_ble_request(&b->policy, ble_now());
+    stats.ble_deferred += b->policy.deferred - deferred;
+    if (wait_us == 0)
+    {
+        b->on_air_from = sched_now();
+        b->on_air_until = b->on_air_from + SIM_US(DMM_BLE_EVENT_US);
+        sched_after(SIM_US(DMM_BLE_EVENT_US), ble_event_end, b, ++b->gen);
+    }
+    else if (wait_us != DMM_NOTHING)
+    {
+        ble_reschedule(b, SIM_US(wait_us));
+    }
+}
+
+static void ble_zigbee(uint16_t node, int busy)
+{
+    ble_node_t *b;
+
+    if (node >= ble_count)
+    {
+        return;
+    }
+    b = &ble_nodes[node];
+    if (busy)
+    {
+        if (b->zigbee_tx++ == 0 && dmm_policy_zigbee(&b->policy, 1, ble_now()))
+        {
+            /* RCL_Command_stop(): the event ends now and is retried */
+            stats.ble_preempted++;
+            b->on_air_until = sched_now();
+            dmm_policy_ble_done(&b->policy, 0, ble_now());
+            ble_reschedule(b, SIM_US(DMM_ZB_GUARD_US));
+        }
+    }
+    else if (b->zigbee_tx > 0 && --b->zigbee_tx == 0)
+    {
+        dmm_policy_zigbee(&b->policy, 0, ble_now());
+    }
+}
+
+static int ble_overlaps(uint16_t node, sim_time_t from, sim_time_t to)
+{
+    const ble_node_t *b;
+
+    if (node >= ble_count)
+    {
+        return 0;
+    }
+    b = &ble_nodes[node];
+    return b->on_air_from < to && from < b->on_air_until;
+}
+
+static const radio_dmm_t ble_dmm = {
+    .zigbee = ble_zigbee,
+    .ble_overlaps = ble_overlaps,
+};
+
+void ble_init(uint32_t nodes)
+{
+    uint32_t i;
+
+    ble_nodes = calloc(nodes, sizeof(*ble_nodes));
+    if (ble_nodes == NULL)
+    {
+        fprintf(stderr, "sim: out of memory\n");
+        exit(1);
+    }
+    ble_count = nodes;
+    for (i = 0; i < nodes; i++)
+    {
+        /* ble_adv_init() seeds from the IEEE address: any per-device value */
+        dmm_policy_init(&ble_nodes[i].policy, i + 1U, 0);
+    }
+    radio_set_dmm(&ble_dmm);
+}
+
+void ble_occupancy(uint16_t node, uint8_t occupied, sim_time_t edge)
+{
+    ble_node_t *b;
+    uint8_t first;
+
+    if (node >= ble_count)
+    {
+        return;
+    }
+    b = &ble_nodes[node];
+    first = !b->policy.valid;
+    if (dmm_policy_occupancy(&b->policy, occupied, ble_now()))
+    {
+        /* The first update only starts advertising; it is not an edge */
+        b->edge = edge;
+        b->edge_pending = !first;
+        if (!b->policy.ble_on_air)
+        {
+            /* ble_adv_update() runs the service at once, ahead of the report */
+            b->gen++;
+            ble_service(b, b->gen);
+        }
+    }
+}
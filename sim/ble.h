@@ -0,0 +1,21 @@
+#ifndef BLE_H
+#define BLE_H
+
+#include "sim.h"
+
+/*
+ * BLE occupancy advertiser of firmware/ble_adv.c (sim --ble), driving the
+ * real firmware/dmm_policy.c. Each sensor's radio is the stand-in RCL:
+ * - radio.c reports the sensor's Zigbee transmissions, and a transmission
+ *   stops a BLE event on air
+ * - a frame for the sensor is lost (no MAC ack) if a BLE event overlapped it
+ * - granted events hold the radio for DMM_BLE_EVENT_US
+ * BLE advertising channels are not the Zigbee channel, so BLE events cost
+ * Zigbee only what they take from the sensor's own radio.
+ */
+
+void ble_init(uint32_t nodes);
+/* occupancy_update(): every update; edge is the radar edge behind it */
+void ble_occupancy(uint16_t node, uint8_t occupied, sim_time_t edge);
+
+#endif /* BLE_H */
@@ -0,0 +1,511 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ble.h"
+#include "node.h"
+#include "on_off_switch.h"
+#include "radio.h"
+#include "sim.h"
+#include "stats.h"
+
+/* Mirrors the filter defaults in firmware/sensor_attrs.c */
+static const presence_filter_config_t default_filter = {
+    .assert_dwell  = 0,
+    .release_dwell = 20,
+    .min_hold      = 50,
+    .flap_limit    = 6,
+};
+
+typedef struct {
+    const char *scenario;
+    const char *trace;
+    uint32_t nodes;
+    uint32_t routers;
+    uint32_t max_hops;
+    uint32_t duration_s;
+    uint32_t seed;
+    int router_build;
+    int no_jitter;
+    int no_backoff;
+    int ble;
+    int check;
+    uint32_t outage_s;
+} sim_options_t;
+
+static sim_node_t *nodes;
+
+static void usage(FILE *out)
+{
+    fprintf(out,
+        "usage: sim [options]\n"
+        "  --scenario NAME   rush (default), powercut or outage\n"
+        "  --trace FILE      occupancy trace: lines of `seconds node state`, node `*` = all\n"
+        "  --nodes N         sensors (default 300)\n"
+        "  --routers N       infrastructure routers relaying broadcasts (default 20)\n"
+        "  --hops N          maximum route length to the coordinator (default 3)\n"
+        "  --duration S      simulated seconds (default: 3600 rush, outage + 300 outage, 120 otherwise)\n"
+        "  --outage S        outage: seconds the coordinator stays down (default 600)\n"
+        "  --router-build    sensors run the router build and relay broadcasts too\n"
+        "  --no-jitter       boot without the NET_* offsets (firmware before boot-storm spreading)\n"
+        "  --no-backoff      fixed 1 s / 3 s rejoin retries (firmware before retry backoff)\n"
+        "  --ble             sensors also advertise occupancy over BLE (BLE_ADV_ENABLE build)\n"
+        "  --check           assert the expected behaviour after the run; exit status 1 if any check fails\n"
+        "  --seed N          PRNG seed (default 1)\n");
+}
+
+static void raw_event(void *ctx, uint32_t arg)
+{
+    node_set_raw(ctx, (uint8_t)arg);
+}
+
+static void set_raw_at(sim_node_t *node, double t_s, uint8_t raw)
+{
+    sched_at((sim_time_t)(t_s * 1e6), raw_event, node, raw);
+}
+
+/* Radar drop-outs while someone sits still: brief absences */
+static void add_dropouts(sim_node_t *node, double from_s, double to_s)
+{
+    double t = from_s + sim_rand_exp(120.0);
+
+    while (t < to_s)
+    {
+        double gap = 1.0 + sim_rand_range(3000) / 1000.0;
+        set_raw_at(node, t, 0);
+        set_raw_at(node, t + gap, 1);
+        t += gap + sim_rand_exp(120.0);
+    }
+}
+
+/* Offices fill up over half an hour; corridors see passers-by */
+static void scenario_rush(const sim_options_t *opt)
+{
+    double end_s = opt->duration_s;
+    uint32_t i;
+
+    for (i = 0; i < opt->nodes; i++)
+    {
+        sim_node_t *node = &nodes[i];
+
+        /* Already running when the morning starts */
+        node_boot(node, SIM_MS(sim_rand_range(10000)));
+
+        if (sim_rand_range(100) < 80)
+        {
+            double arrive = 300.0 + sim_rand_range(1800);
+            set_raw_at(node, arrive, 1);
+            add_dropouts(node, arrive, end_s);
+        }
+        else
+        {
+            double t = 20.0 + sim_rand_exp(45.0);
+            while (t < end_s)
+            {
+                double stay = 3.0 + sim_rand_range(7000) / 1000.0;
+                set_raw_at(node, t, 1);
+                set_raw_at(node, t + stay, 0);
+                t += stay + sim_rand_exp(45.0);
+            }
+        }
+    }
+}
+
+/* Mains returns: every sensor boots at once, half of the rooms are occupied */
+static void scenario_powercut(const sim_options_t *opt)
+{
+    uint32_t i;
+
+    for (i = 0; i < opt->nodes; i++)
+    {
+        nodes[i].raw = sim_rand_range(2) ? 1 : 0;
+        node_boot(&nodes[i], 0);
+        if (nodes[i].raw)
+        {
+            add_dropouts(&nodes[i], 1.0, opt->duration_s);
+        }
+    }
+}
+
+/* As powercut, but the coordinator stays down and every rejoin goes unanswered */
+static void scenario_outage(const sim_options_t *opt)
+{
+    uint32_t i;
+
+    node_set_coordinator_down(SIM_S(opt->outage_s));
+
+    for (i = 0; i < opt->nodes; i++)
+    {
+        nodes[i].raw = sim_rand_range(2) ? 1 : 0;
+        node_boot(&nodes[i], 0);
+        if (nodes[i].raw)
+        {
+            add_dropouts(&nodes[i], 1.0, opt->duration_s);
+        }
+    }
+}
+
+static int load_trace(const sim_options_t *opt)
+{
+    FILE *f = fopen(opt->trace, "r");
+    char line[128];
+    unsigned lineno = 0;
+    uint32_t i;
+
+    if (f == NULL)
+    {
+        perror(opt->trace);
+        return -1;
+    }
+
+    for (i = 0; i < opt->nodes; i++)
+    {
+        node_boot(&nodes[i], 0);
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        char who[16];
+        double t;
+        unsigned state;
+
+        lineno++;
+        if (line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+        if (sscanf(line, "%lf %15s %u", &t, who, &state) != 3)
+        {
+            fprintf(stderr, "%s:%u: expected `seconds node state`\n", opt->trace, lineno);
+            fclose(f);
+            return -1;
+        }
+        if (strcmp(who, "*") == 0)
+        {
+            for (i = 0; i < opt->nodes; i++)
+            {
+                set_raw_at(&nodes[i], t, (uint8_t)state);
+            }
+        }
+        else
+        {
+            unsigned long idx = strtoul(who, NULL, 10);
+            if (idx >= opt->nodes)
+            {
+                fprintf(stderr, "%s:%u: node %lu out of range\n", opt->trace, lineno, idx);
+                fclose(f);
+                return -1;
+            }
+            set_raw_at(&nodes[idx], t, (uint8_t)state);
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+/* ----- --check ----- */
+
+static int check_failed;
+
+static void check(int ok, const char *what)
+{
+    printf("check %-52s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok)
+    {
+        check_failed = 1;
+    }
+}
+
+/* Lights whose last command is settled must match the sensor's occupancy, unless given up on */
+static uint32_t lights_out_of_sync(const sim_options_t *opt)
+{
+    uint32_t n = 0;
+    uint32_t i;
+
+    for (i = 0; i < opt->nodes; i++)
+    {
+        const sim_node_t *node = &nodes[i];
+        uint8_t want = node->occupancy ? NODE_LIGHT_ON : NODE_LIGHT_OFF;
+
+        if (node->joined && !node->cmd_in_progress && node->light_timeouts < NODE_LIGHT_MAX_TIMEOUTS &&
+            node->light_state != want)
+        {
+            n++;
+        }
+    }
+    return n;
+}
+
+static uint32_t lights_given_up(const sim_options_t *opt)
+{
+    uint32_t n = 0;
+    uint32_t i;
+
+    for (i = 0; i < opt->nodes; i++)
+    {
+        n += nodes[i].light_timeouts >= NODE_LIGHT_MAX_TIMEOUTS;
+    }
+    return n;
+}
+
+static uint32_t nodes_joined(const sim_options_t *opt)
+{
+    uint32_t n = 0;
+    uint32_t i;
+
+    for (i = 0; i < opt->nodes; i++)
+    {
+        n += nodes[i].joined;
+    }
+    return n;
+}
+
+/* Attempts one sensor makes in span_ms if every retry drew the shortest delay */
+static uint32_t backoff_max_attempts(uint32_t span_ms)
+{
+    backoff_t backoff = BACKOFF_INIT(NET_REJOIN_BACKOFF_MS, NET_BACKOFF_CAP_MS);
+    uint64_t t = 0;
+    uint32_t attempts = 1;
+
+    while (t < span_ms)
+    {
+        uint32_t window = NET_REJOIN_BACKOFF_MS;
+        uint8_t i;
+
+        for (i = 0; i < backoff.attempts && window < NET_BACKOFF_CAP_MS; i++)
+        {
+            window <<= 1;
+        }
+        t += (window < NET_BACKOFF_CAP_MS ? window : NET_BACKOFF_CAP_MS) / 2U;
+        backoff.attempts++;
+        attempts++;
+    }
+    return attempts;
+}
+
+/* Retries while the coordinator is down must follow the backoff and stay spread out */
+static void check_outage(const sim_options_t *opt)
+{
+    uint64_t spread = 0;
+    int even;
+    /* From here on every sensor retries at the cap, once per 3/4 cap on average */
+    sim_time_t capped = SIM_S(300);
+    uint32_t capped_rate = (uint32_t)(opt->nodes * 1000ULL / (NET_BACKOFF_CAP_MS * 3U / 4U));
+    unsigned i;
+
+    for (i = 0; i < 4; i++)
+    {
+        spread += stats.rejoin_spread[i];
+    }
+    even = spread > 0;
+    for (i = 0; i < 4; i++)
+    {
+        even = even && stats.rejoin_spread[i] * 5U >= spread;
+    }
+
+    check(spread > 0 && stats.rejoin_outside == 0, "every retry waited half to all of its window");
+    check(even, "retries spread over every quarter of their range");
+    check(stats_rejoin_peak(capped) <= 5U * (capped_rate + 1U),
+          "no rejoin burst above 5x the capped mean rate");
+    check(stats.rejoin_attempts <= (uint64_t)opt->nodes * (backoff_max_attempts(opt->outage_s * 1000U) + 1U),
+          "rejoin attempts within the backoff's upper bound");
+}
+
+static void run_checks(const sim_options_t *opt)
+{
+    check(nodes_joined(opt) == opt->nodes, "every sensor joined");
+    check(stats_latency_count(STATS_LAT_REPORT_NET) * 100U >= stats.reports * 98U,
+          "at least 98 % of reports reached the coordinator");
+    check(stats.light_acked * 100U >= stats.light_cmds * 95U,
+          "at least 95 % of On/Off commands reached the light");
+    check(lights_out_of_sync(opt) == 0, "every idle light matches its sensor's occupancy");
+    check(lights_given_up(opt) * 100U <= opt->nodes, "at most 1 % of lights given up as unreachable");
+
+    /* Routers resume their stored network without the coordinator: no rejoins to check */
+    if (strcmp(opt->scenario, "outage") == 0 && !opt->no_backoff && !opt->router_build)
+    {
+        check_outage(opt);
+    }
+    if (opt->router_build)
+    {
+        /* The pools are sized for this many devices; a bigger run tests something else */
+        check(1U + opt->routers + opt->nodes <= NET_ROUTER_NETWORK_SIZE,
+              "network fits the router build's memory preset");
+    }
+}
+
+static int parse_args(int argc, char **argv, sim_options_t *opt)
+{
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--router-build") == 0)
+        {
+            opt->router_build = 1;
+            continue;
+        }
+        if (strcmp(arg, "--no-jitter") == 0)
+        {
+            opt->no_jitter = 1;
+            continue;
+        }
+        if (strcmp(arg, "--no-backoff") == 0)
+        {
+            opt->no_backoff = 1;
+            continue;
+        }
+        if (strcmp(arg, "--ble") == 0)
+        {
+            opt->ble = 1;
+            continue;
+        }
+        if (strcmp(arg, "--check") == 0)
+        {
+            opt->check = 1;
+            continue;
+        }
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+        {
+            usage(stdout);
+            exit(0);
+        }
+        if (val == NULL)
+        {
+            usage(stderr);
+            return -1;
+        }
+        i++;
+        if (strcmp(arg, "--scenario") == 0)        opt->scenario = val;
+        else if (strcmp(arg, "--trace") == 0)      opt->trace = val;
+        else if (strcmp(arg, "--nodes") == 0)      opt->nodes = (uint32_t)strtoul(val, NULL, 10);
+        else if (strcmp(arg, "--routers") == 0)    opt->routers = (uint32_t)strtoul(val, NULL, 10);
+        else if (strcmp(arg, "--hops") == 0)       opt->max_hops = (uint32_t)strtoul(val, NULL, 10);
+        else if (strcmp(arg, "--duration") == 0)   opt->duration_s = (uint32_t)strtoul(val, NULL, 10);
+        else if (strcmp(arg, "--outage") == 0)     opt->outage_s = (uint32_t)strtoul(val, NULL, 10);
+        else if (strcmp(arg, "--seed") == 0)       opt->seed = (uint32_t)strtoul(val, NULL, 10);
+        else
+        {
+            usage(stderr);
+            return -1;
+        }
+    }
+
+    if (opt->nodes == 0 || opt->nodes >= RADIO_PARENT || opt->max_hops == 0 || opt->max_hops > 15)
+    {
+        fprintf(stderr, "sim: need 1..%u nodes and 1..15 hops\n", RADIO_PARENT - 1);
+        return -1;
+    }
+    if (opt->duration_s == 0)
+    {
+        if (opt->trace != NULL)
+        {
+            opt->duration_s = 120;
+        }
+        else if (strcmp(opt->scenario, "rush") == 0)
+        {
+            opt->duration_s = 3600;
+        }
+        else if (strcmp(opt->scenario, "outage") == 0)
+        {
+            opt->duration_s = opt->outage_s + 300;
+        }
+        else
+        {
+            opt->duration_s = 120;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    sim_options_t opt = {
+        .scenario = "rush",
+        .nodes = 300,
+        .routers = 20,
+        .max_hops = 3,
+        .seed = 1,
+        .outage_s = 600,
+    };
+    sim_time_t duration;
+    uint64_t events;
+    uint32_t i;
+
+    if (parse_args(argc, argv, &opt) != 0)
+    {
+        return 2;
+    }
+
+    duration = SIM_S(opt.duration_s);
+    sim_seed(opt.seed);
+    sched_init();
+    stats_init(duration);
+    radio_init(opt.routers + 1 + (opt.router_build ? opt.nodes : 0));
+    node_set_jitter(!opt.no_jitter);
+    node_set_backoff(!opt.no_backoff);
+    node_set_ble(opt.ble);
+    node_set_router(opt.router_build);
+
+    nodes = calloc(opt.nodes, sizeof(*nodes));
+    if (nodes == NULL)
+    {
+        fprintf(stderr, "sim: out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < opt.nodes; i++)
+    {
+        node_init(&nodes[i], (uint16_t)i, (uint8_t)(1 + sim_rand_range(opt.max_hops)),
+                  (uint8_t)(1 + sim_rand_range(2)), &default_filter);
+    }
+    if (opt.ble)
+    {
+        ble_init(opt.nodes);
+    }
+
+    if (opt.trace != NULL)
+    {
+        if (load_trace(&opt) != 0)
+        {
+            return 1;
+        }
+    }
+    else if (strcmp(opt.scenario, "rush") == 0)
+    {
+        scenario_rush(&opt);
+    }
+    else if (strcmp(opt.scenario, "powercut") == 0)
+    {
+        scenario_powercut(&opt);
+    }
+    else if (strcmp(opt.scenario, "outage") == 0)
+    {
+        scenario_outage(&opt);
+    }
+    else
+    {
+        fprintf(stderr, "sim: unknown scenario '%s'\n", opt.scenario);
+        return 2;
+    }
+
+    events = sched_run_until(duration);
+
+    printf("%s: %u sensors (%s build%s%s), %u routers, up to %u hops, %u s, seed %u, %llu events\n",
+           opt.trace != NULL ? opt.trace : opt.scenario, opt.nodes,
+           opt.router_build ? "router" : "end device", opt.no_jitter ? ", no jitter" : "",
+           opt.no_backoff ? ", no backoff" : "",
+           opt.routers, opt.max_hops,
+           opt.duration_s, opt.seed, (unsigned long long)events);
+    stats_print(stdout, duration);
+    if (opt.check)
+    {
+        run_checks(&opt);
+    }
+
+    stats_free();
+    free(nodes);
+    return check_failed;
+}
@@ -0,0 +1,501 @@
+#include "node.h"
+#include "ble.h"
+#include "on_off_switch.h"
+#include "radio.h"
+#include "stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    sim_node_t *node;
+    sim_time_t created;
+    sim_time_t edge;            /* 0 for periodic reports */
+} node_msg_t;
+
+static int node_jitter = 1;
+static int node_backoff = 1;
+static int node_ble;
+static int node_router;
+static sim_time_t coord_up_at;
+
+void node_set_jitter(int enabled)
+{
+    node_jitter = enabled;
+}
+
+void node_set_backoff(int enabled)
+{
+    node_backoff = enabled;
+}
+
+void node_set_ble(int enabled)
+{
+    node_ble = enabled;
+}
+
+void node_set_router(int enabled)
+{
+    node_router = enabled;
+}
+
+void node_set_coordinator_down(sim_time_t until)
+{
+    coord_up_at = until;
+}
+
+static sim_time_t node_jitter_ms(sim_node_t *node, uint32_t max_ms)
+{
+    return node_jitter ? SIM_MS(backoff_jitter_ms(&node->rng, max_ms)) : 0;
+}
+
+static uint32_t node_ms(void)
+{
+    return (uint32_t)(sched_now() / 1000U);
+}
+
+static node_msg_t *node_msg(sim_node_t *node, sim_time_t edge)
+{
+    node_msg_t *msg = malloc(sizeof(*msg));
+
+    if (msg == NULL)
+    {
+        fprintf(stderr, "sim: out of memory\n");
+        exit(1);
+    }
+    msg->node = node;
+    msg->created = sched_now();
+    msg->edge = edge;
+    return msg;
+}
+
+static void node_send(sim_node_t *node, uint16_t dst, uint8_t hops, uint8_t payload,
+                      radio_done_cb_t done, void *ctx)
+{
+    radio_unicast_t req = {
+        .src = node->id,
+        .dst = dst,
+        .hops = hops,
+        .payload = payload,
+        .aps_ack = 1,
+        .done = done,
+        .ctx = ctx,
+    };
+    radio_unicast(&req);
+}
+
+/* ----- Reporting ----- */
+
+static void node_report_done(void *ctx, int ok)
+{
+    node_msg_t *msg = ctx;
+
+    if (ok)
+    {
+        stats_latency(STATS_LAT_REPORT_NET, sched_now() - msg->created);
+        if (msg->edge != 0)
+        {
+            stats_latency(STATS_LAT_REPORT_E2E, sched_now() - msg->edge);
+        }
+    }
+    free(msg);
+}
+
+static void node_report(sim_node_t *node, sim_time_t edge)
+{
+    stats.reports++;
+    node_send(node, RADIO_COORD, node->hops, NODE_REPORT_LEN,
+              node_report_done, node_msg(node, edge));
+}
+
+static void node_report_tick(void *ctx, uint32_t arg)
+{
+    sim_node_t *node = ctx;
+
+    (void)arg;
+    node_report(node, 0);
+    sched_after(SIM_S(NODE_REPORT_MAX_S), node_report_tick, node, 0);
+}
+
+/* ----- On/Off ----- */
+
+static void node_cmd_timeout(void *ctx, uint32_t arg)
+{
+    sim_node_t *node = ctx;
+
+    if (arg == node->cmd_seq && node->cmd_in_progress)
+    {
+        /* send_cmd_timeout -> lights_cmd_timeout(): the state is unknown again */
+        node->cmd_in_progress = 0;
+        node->light_state = NODE_LIGHT_UNKNOWN;
+        node->light_timeouts++;
+    }
+}
+
+static void node_default_resp_done(void *ctx, int ok)
+{
+    node_msg_t *msg = ctx;
+    sim_node_t *node = msg->node;
+
+    if (ok && node->cmd_in_progress)
+    {
+        /* lights_cmd_done() */
+        node->cmd_in_progress = 0;
+        node->cmd_seq++;
+        node->light_state = node->light_pending;
+        node->light_timeouts = 0;
+    }
+    free(msg);
+}
+
+static void node_onoff_done(void *ctx, int ok)
+{
+    node_msg_t *msg = ctx;
+    sim_node_t *node = msg->node;
+
+    if (ok)
+    {
+        stats.light_acked++;
+        if (msg->edge != 0)
+        {
+            stats_latency(STATS_LAT_LIGHT_E2E, sched_now() - msg->edge);
+        }
+        /* The light answers with a ZCL default response */
+        radio_unicast_t resp = {
+            .src = RADIO_LIGHT,
+            .dst = node->id,
+            .hops = node->light_hops,
+            .payload = NODE_DEFAULT_RESP_LEN,
+            .aps_ack = 1,
+            .done = node_default_resp_done,
+            .ctx = node_msg(node, 0),
+        };
+        radio_unicast(&resp);
+    }
+    free(msg);
+}
+
+static void node_send_onoff(sim_node_t *node, uint8_t on)
+{
+    node->cmd_in_progress = 1;
+    node->light_pending = on ? NODE_LIGHT_ON : NODE_LIGHT_OFF;
+    node->cmd_seq++;
+    stats.light_cmds++;
+    sched_after(SIM_MS(NODE_CMD_TIMEOUT_MS), node_cmd_timeout, node, node->cmd_seq);
+    node_send(node, RADIO_LIGHT, node->light_hops, NODE_ONOFF_LEN,
+              node_onoff_done, node_msg(node, node->raw_edge));
+}
+
+/* occupancy_update() */
+static void node_occupancy_update(sim_node_t *node)
+{
+    uint8_t present = node->presence.filter.output;
+
+    if (node_ble)
+    {
+        ble_occupancy(node->id, present, node->raw_edge);
+    }
+    uint8_t want = present ? NODE_LIGHT_ON : NODE_LIGHT_OFF;
+
+    if (present != node->occupancy)
+    {
+        node->occupancy = present;
+        node_report(node, node->raw_edge);
+        /* lights_presence_edge() */
+        node->light_timeouts = 0;
+    }
+    /* lights_drive() */
+    if (want != node->light_state && !node->cmd_in_progress && node->light_timeouts < NODE_LIGHT_MAX_TIMEOUTS)
+    {
+        node_send_onoff(node, present);
+    }
+}
+
+static void node_poll(void *ctx, uint32_t arg)
+{
+    sim_node_t *node = ctx;
+
+    (void)arg;
+    node_occupancy_update(node);
+    sched_after(SIM_MS(NODE_POLL_MS), node_poll, node, 0);
+}
+
+/* ----- Presence ----- */
+
+static void node_recheck(void *ctx, uint32_t arg);
+
+/* presence_update(): runs on each pin edge and re-arms itself while presence_step() asks */
+static void node_evaluate(sim_node_t *node)
+{
+    uint32_t recheck_ms;
+
+    node->recheck_seq++;
+    if (presence_step(&node->presence, node->raw, node_ms(), &recheck_ms) && node->joined && node->settled)
+    {
+        node_occupancy_update(node);
+    }
+    if (recheck_ms != 0)
+    {
+        sched_after(SIM_MS(recheck_ms), node_recheck, node, node->recheck_seq);
+    }
+}
+
+static void node_recheck(void *ctx, uint32_t arg)
+{
+    sim_node_t *node = ctx;
+
+    if (arg == node->recheck_seq)
+    {
+        node_evaluate(node);
+    }
+}
+
+void node_set_raw(sim_node_t *node, uint8_t raw)
+{
+    raw = raw ? 1 : 0;
+    if (raw != node->raw)
+    {
+        node->raw = raw;
+        node->raw_edge = sched_now();
+        /* The UART frames agree with the pin; the cross-check has nothing to count */
+        node->presence.uart = raw;
+        node_evaluate(node);
+    }
+}
+
+/* ----- Boot and rejoin ----- */
+
+static void node_clock_resp_done(void *ctx, int ok)
+{
+    (void)ctx;
+    (void)ok;
+}
+
+static void node_clock_req_done(void *ctx, int ok)
+{
+    sim_node_t *node = ctx;
+
+    if (ok)
+    {
+        /* Time cluster read response from the coordinator */
+        radio_unicast_t resp = {
+            .src = RADIO_COORD,
+            .dst = node->id,
+            .hops = node->hops,
+            .payload = NODE_READ_RESP_LEN,
+            .aps_ack = 1,
+            .done = node_clock_resp_done,
+            .ctx = node,
+        };
+        radio_unicast(&resp);
+    }
+}
+
+static void node_clock_sync(void *ctx, uint32_t arg)
+{
+    sim_node_t *node = ctx;
+
+    (void)arg;
+    node_send(node, RADIO_COORD, node->hops, NODE_READ_REQ_LEN,
+              node_clock_req_done, node);
+}
+
+static void node_settle_done(void *ctx, uint32_t arg)
+{
+    sim_node_t *node = ctx;
+
+    (void)arg;
+    node->settled = 1;
+}
+
+/* start_app_alarms() */
+static void node_joined(sim_node_t *node)
+{
+    node->joined = 1;
+    stats.joins++;
+    stats.last_join = sched_now();
+    radio_broadcast(NODE_ANNCE_LEN);
+    if (node_jitter)
+    {
+        sched_after(SIM_MS(NET_SETTLE_MS), node_settle_done, node, 0);
+    }
+    else
+    {
+        node->settled = 1;
+    }
+    sched_after(SIM_MS(NODE_POLL_MS) + node_jitter_ms(node, NET_SETTLE_MS), node_poll, node, 0);
+    sched_after(SIM_MS(NODE_CLOCK_SYNC_MS) + node_jitter_ms(node, NET_CLOCK_JITTER_MS),
+                node_clock_sync, node, 0);
+    sched_after(SIM_S(NODE_REPORT_MAX_S), node_report_tick, node, 0);
+}
+
+static void node_rejoin(void *ctx, uint32_t arg);
+
+/* min(cap, base * 2^n) for the next retry, worked out independently of backoff.c to check it */
+static uint32_t node_backoff_window(const backoff_t *backoff)
+{
+    uint64_t window = (uint64_t)backoff->base_ms << (backoff->attempts < 32U ? backoff->attempts : 32U);
+
+    return window < backoff->cap_ms ? (uint32_t)window : backoff->cap_ms;
+}
+
+/* net_retry(): the firmware's TC rejoin path after a failed rejoin */
+static void node_rejoin_failed(sim_node_t *node)
+{
+    uint32_t delay_ms;
+
+    if (node_backoff)
+    {
+        uint32_t window = node_backoff_window(&node->retry.backoff[NET_RETRY_REJOIN]);
+
+        delay_ms = net_retry_failed(&node->retry, NET_RETRY_REJOIN, &node->rng, node_ms() / 1000U);
+        if (delay_ms < window / 2U || delay_ms > window)
+        {
+            stats.rejoin_outside++;
+        }
+        else
+        {
+            stats.rejoin_spread[(delay_ms - window / 2U) * 4U / (window - window / 2U + 1U)]++;
+        }
+    }
+    else
+    {
+        /* Before backoff: TC rejoin 1 s after the failed reboot, then every 3 s */
+        delay_ms = node->rejoin_fails ? 3000U : 1000U;
+    }
+    node->rejoin_fails++;
+    stats.rejoin_retries++;
+    sched_after(SIM_MS(delay_ms), node_rejoin, node, 0);
+}
+
+static void node_rejoin_timeout(void *ctx, uint32_t arg)
+{
+    (void)arg;
+    node_rejoin_failed(ctx);
+}
+
+static void node_rejoin_resp_done(void *ctx, int ok)
+{
+    sim_node_t *node = ctx;
+
+    if (ok)
+    {
+        net_retry_joined(&node->retry);
+        node->rejoin_fails = 0;
+        node_joined(node);
+    }
+    else
+    {
+        node_rejoin_failed(node);
+    }
+}
+
+static void node_rejoin_req_done(void *ctx, int ok)
+{
+    sim_node_t *node = ctx;
+
+    if (!ok)
+    {
+        node_rejoin_failed(node);
+    }
+    else if (sched_now() < coord_up_at)
+    {
+        /* The parent cannot reach the trust center: no response comes */
+        sched_after(SIM_MS(NODE_REJOIN_WAIT_MS), node_rejoin_timeout, node, 0);
+    }
+    else
+    {
+        /* NWK rejoin response from the parent, one hop, MAC-acked only */
+        radio_unicast_t resp = {
+            .src = node->hops == 1 ? RADIO_COORD : RADIO_PARENT,
+            .dst = node->id,
+            .hops = 1,
+            .payload = NODE_REJOIN_LEN,
+            .done = node_rejoin_resp_done,
+            .ctx = node,
+        };
+        radio_unicast(&resp);
+    }
+}
+
+static void node_rejoin_send(void *ctx, uint32_t arg)
+{
+    sim_node_t *node = ctx;
+    radio_unicast_t req = {
+        .src = node->id,
+        .dst = node->hops == 1 ? RADIO_COORD : RADIO_PARENT,
+        .hops = 1,
+        .payload = NODE_REJOIN_LEN,
+        .done = node_rejoin_req_done,
+        .ctx = node,
+    };
+
+    (void)arg;
+    radio_unicast(&req);
+}
+
+/* Router build: the network is restored from NVRAM, announced, and no parent is needed */
+static void node_resume(void *ctx, uint32_t arg)
+{
+    (void)arg;
+    node_joined(ctx);
+}
+
+/* One rejoin attempt: active scan for a parent, then the rejoin request */
+static void node_rejoin(void *ctx, uint32_t arg)
+{
+    (void)arg;
+    stats_rejoin(sched_now());
+    radio_beacon_scan();
+    sched_after(SIM_MS(RADIO_SCAN_MS), node_rejoin_send, ctx, 0);
+}
+
+void node_init(sim_node_t *node, uint16_t id, uint8_t hops, uint8_t light_hops,
+               const presence_filter_config_t *filter)
+{
+    /* TI OUI, then the node index: sequential addresses as off a reel */
+    const uint8_t ieee_addr[8] = { 0x00, 0x12, 0x4B, 0x00, 0x2A, 0x00,
+                                   (uint8_t)(id >> 8), (uint8_t)id };
+
+    node->id = id;
+    node->hops = hops;
+    node->light_hops = light_hops;
+    node->joined = 0;
+    node->raw = 0;
+    node->occupancy = 0;
+    /* lights_subscribe() reads the light's state once bound; it starts off */
+    node->light_state = NODE_LIGHT_OFF;
+    node->light_pending = NODE_LIGHT_OFF;
+    node->light_timeouts = 0;
+    node->cmd_in_progress = 0;
+    node->settled = 0;
+    node->cmd_seq = 0;
+    node->recheck_seq = 0;
+    node->raw_edge = 0;
+    node->rejoin_fails = 0;
+    net_retry_init(&node->retry);
+    presence_init(&node->presence, 0, 0);
+    presence_filter_set_config(&node->presence.filter, filter);
+    backoff_rng_seed(&node->rng, ieee_addr);
+}
+
+static void node_power_up(void *ctx, uint32_t arg)
+{
+    sim_node_t *node = ctx;
+    presence_filter_config_t config = node->presence.filter.config;
+
+    (void)arg;
+    /* MAIN(): presence_init(..., 0, ...), the configured filter, then one presence_update() */
+    presence_init(&node->presence, 0, node_ms());
+    node->presence.uart = node->raw;
+    presence_filter_set_config(&node->presence.filter, &config);
+    node_evaluate(node);
+    /* SKIP_STARTUP: zboss_start_continue() after NET_START_JITTER_MS */
+    sched_after(node_jitter_ms(node, NET_START_JITTER_MS), node_router ? node_resume : node_rejoin, node, 0);
+}
+
+void node_boot(sim_node_t *node, sim_time_t when)
+{
+    sched_at(when + SIM_MS(NODE_BOOT_MS) + SIM_US(sim_rand_range(NODE_BOOT_SPREAD_MS * 1000U)),
+             node_power_up, node, 0);
+}
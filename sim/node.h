@@ -0,0 +1,82 @@
+#ifndef NODE_H
+#define NODE_H
+
+#include "sim.h"
+#include "backoff.h"
+#include "net_retry.h"
+#include "presence.h"
+
+/*
+ * One sensor running firmware/on_off_switch.c. The firmware's own code
+ * decides: presence.c filters the radar output and says when to look
+ * again, net_retry.c spaces the rejoin retries, backoff.c spreads the
+ * boot. This file only models what ZBOSS and the radio do around it: the
+ * 1 s poll, occupancy reports to the coordinator, On/Off commands to one
+ * light tracked as lights.c does, and the rejoin exchange.
+ * Timings mirror the firmware; see the NODE_* defines and the NET_*
+ * boot-storm offsets shared with firmware/on_off_switch.h.
+ */
+
+#define NODE_BOOT_MS            300U        /* Power-up to ZBOSS REBOOT signal */
+#define NODE_BOOT_SPREAD_MS     20U         /* Supply ramp and crystal start-up */
+#define NODE_REJOIN_WAIT_MS     1000U       /* Rejoin response timeout */
+#define NODE_POLL_MS            1000U       /* sensor_poll_handler */
+#define NODE_CLOCK_SYNC_MS      2000U       /* First app_clock_sync after joining */
+#define NODE_CMD_TIMEOUT_MS     5000U       /* send_cmd_timeout */
+#define NODE_REPORT_MAX_S       300U        /* maximumReportInterval in sen0609.js */
+#define NODE_LIGHT_MAX_TIMEOUTS 3U          /* LIGHTS_MAX_TIMEOUTS in lights.h */
+
+/* light_state_t in lights.h */
+#define NODE_LIGHT_UNKNOWN      0U
+#define NODE_LIGHT_OFF          1U
+#define NODE_LIGHT_ON           2U
+
+/* ZCL/ZDO payload sizes in bytes */
+#define NODE_REPORT_LEN         7U
+#define NODE_ONOFF_LEN          3U
+#define NODE_DEFAULT_RESP_LEN   5U
+#define NODE_READ_REQ_LEN       7U
+#define NODE_READ_RESP_LEN      17U
+#define NODE_REJOIN_LEN         4U
+#define NODE_ANNCE_LEN          12U
+
+typedef struct {
+    uint16_t id;
+    uint8_t hops;               /* Route length to the coordinator */
+    uint8_t light_hops;         /* Route length to the bound light */
+    uint8_t joined;
+    uint8_t raw;                /* Radar output */
+    uint8_t occupancy;          /* attr_occupancy */
+    uint8_t light_state;        /* lights.c cache of the bound light, NODE_LIGHT_* */
+    uint8_t light_pending;      /* State the outstanding command asked for */
+    uint8_t light_timeouts;     /* Unanswered commands in a row */
+    uint8_t cmd_in_progress;
+    uint8_t settled;            /* net_settled */
+    uint32_t cmd_seq;           /* Stale send_cmd_timeout alarms are ignored */
+    uint32_t recheck_seq;       /* Stale presence_update alarms are ignored, as if cancelled */
+    sim_time_t raw_edge;        /* Time of the last radar edge */
+    presence_t presence;
+    backoff_rng_t rng;
+    net_retry_t retry;
+    uint16_t rejoin_fails;      /* Failures in a row, for --no-backoff */
+} sim_node_t;
+
+/* 0 reproduces the firmware before boot-storm spreading, for comparison */
+void node_set_jitter(int enabled);
+/* 0 reproduces the fixed 1 s / 3 s TC rejoin retries before backoff */
+void node_set_backoff(int enabled);
+/* 1 runs the BLE occupancy advertiser (ble.h) next to Zigbee */
+void node_set_ble(int enabled);
+/* 1 runs the router build: a reboot resumes the stored network instead of rejoining */
+void node_set_router(int enabled);
+/* Rejoins get no response before `until`: the coordinator is down */
+void node_set_coordinator_down(sim_time_t until);
+
+void node_init(sim_node_t *node, uint16_t id, uint8_t hops, uint8_t light_hops,
+               const presence_filter_config_t *filter);
+/* Powers the node up at `when`; it rejoins as after a reboot */
+void node_boot(sim_node_t *node, sim_time_t when);
+/* Radar output change at the current virtual time */
+void node_set_raw(sim_node_t *node, uint8_t raw);
+
+#endif /* NODE_H */
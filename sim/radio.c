@@ -0,0 +1,437 @@
+#include "radio.h"
+#include "stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RADIO_MAX_ACTIVE 64
+
+typedef struct {
+    radio_unicast_t req;
+    uint8_t tries;
+    uint8_t delivered;          /* done() already called */
+    uint8_t finished;           /* Acked or given up */
+    uint8_t refs;               /* Frames in flight plus the pending ack timeout */
+} aps_tx_t;
+
+typedef struct {
+    aps_tx_t *aps;              /* NULL for broadcasts */
+    uint8_t is_ack;             /* APS ack on its way back */
+    uint8_t hop;
+    uint8_t hops;
+    uint8_t len;                /* MPDU bytes */
+    uint8_t nb;
+    uint8_t be;
+    uint8_t retries;
+    uint8_t collided;           /* 1: collision, 2: the receiver was on BLE */
+    uint8_t broadcast;          /* No MAC ack, no retries */
+    uint8_t dmm_busy;           /* Reported to dmm->zigbee() */
+    sim_time_t started;         /* Start of the current transmission */
+} mac_tx_t;
+
+static mac_tx_t *active[RADIO_MAX_ACTIVE];
+static uint32_t active_count;
+static uint32_t relay_count;
+static uint32_t bcast_active;
+static const radio_dmm_t *dmm;
+
+static void mac_backoff(mac_tx_t *tx);
+static void aps_attempt(aps_tx_t *aps);
+
+static sim_time_t radio_airtime(uint8_t len)
+{
+    return SIM_US((RADIO_PHY_OVERHEAD + len) * RADIO_BYTE_US);
+}
+
+static void aps_release(aps_tx_t *aps)
+{
+    if (--aps->refs == 0)
+    {
+        free(aps);
+    }
+}
+
+static void aps_finish(aps_tx_t *aps, int ok)
+{
+    if (aps->finished)
+    {
+        return;
+    }
+    aps->finished = 1;
+    if (!ok && aps->req.aps_ack)
+    {
+        stats.aps_failures++;
+    }
+    if (!aps->delivered && aps->req.done != NULL)
+    {
+        aps->delivered = 1;
+        aps->req.done(aps->req.ctx, ok);
+    }
+}
+
+static mac_tx_t *mac_new(aps_tx_t *aps, uint8_t len, uint8_t hops)
+{
+    mac_tx_t *tx = calloc(1, sizeof(*tx));
+
+    if (tx == NULL)
+    {
+        fprintf(stderr, "sim: out of memory\n");
+        exit(1);
+    }
+    tx->aps = aps;
+    tx->len = len;
+    tx->hops = hops ? hops : 1;
+    if (aps != NULL)
+    {
+        aps->refs++;
+    }
+    return tx;
+}
+
+/* The originating sensor's radio is busy with this frame until its first hop is acked */
+static void mac_dmm_busy(mac_tx_t *tx, int busy)
+{
+    if (dmm == NULL || tx->aps == NULL || tx->dmm_busy == busy)
+    {
+        return;
+    }
+    tx->dmm_busy = (uint8_t)busy;
+    dmm->zigbee(tx->is_ack ? tx->aps->req.dst : tx->aps->req.src, busy);
+}
+
+/* The final receiver's radio was on BLE while the frame was on air */
+static int mac_ble_missed(const mac_tx_t *tx)
+{
+    uint16_t dst;
+
+    if (dmm == NULL || tx->aps == NULL || tx->hop + 1 != tx->hops)
+    {
+        return 0;
+    }
+    dst = tx->is_ack ? tx->aps->req.src : tx->aps->req.dst;
+    return dmm->ble_overlaps(dst, tx->started, sched_now());
+}
+
+static void mac_free(mac_tx_t *tx)
+{
+    mac_dmm_busy(tx, 0);
+    if (tx->aps != NULL)
+    {
+        aps_release(tx->aps);
+    }
+    free(tx);
+}
+
+static void mac_start(mac_tx_t *tx)
+{
+    tx->nb = 0;
+    tx->be = RADIO_MIN_BE;
+    if (tx->hop == 0)
+    {
+        mac_dmm_busy(tx, 1);
+    }
+    mac_backoff(tx);
+}
+
+/* The frame reached the last hop */
+static void mac_arrived(mac_tx_t *tx)
+{
+    aps_tx_t *aps = tx->aps;
+    uint16_t dst = tx->is_ack ? aps->req.src : aps->req.dst;
+
+    if (dst == RADIO_COORD)
+    {
+        stats_inbound(sched_now());
+    }
+
+    if (tx->is_ack)
+    {
+        aps_finish(aps, 1);
+    }
+    else
+    {
+        if (!aps->delivered && aps->req.done != NULL)
+        {
+            aps->delivered = 1;
+            aps->req.done(aps->req.ctx, 1);
+        }
+        if (aps->req.aps_ack)
+        {
+            mac_tx_t *ack = mac_new(aps, RADIO_MPDU_OVERHEAD, aps->req.hops);
+            ack->is_ack = 1;
+            mac_start(ack);
+        }
+        else
+        {
+            aps_finish(aps, 1);
+        }
+    }
+    mac_free(tx);
+}
+
+static void mac_dropped(mac_tx_t *tx)
+{
+    stats.mac_drops++;
+    if (tx->aps != NULL && !tx->aps->req.aps_ack)
+    {
+        aps_finish(tx->aps, 0);
+    }
+    mac_free(tx);
+}
+
+static void mac_next_hop(void *ctx, uint32_t arg)
+{
+    (void)arg;
+    mac_start(ctx);
+}
+
+static void mac_tx_end(void *ctx, uint32_t arg)
+{
+    mac_tx_t *tx = ctx;
+    uint32_t i;
+
+    (void)arg;
+
+    for (i = 0; i < active_count; i++)
+    {
+        if (active[i] == tx)
+        {
+            active[i] = active[--active_count];
+            break;
+        }
+    }
+
+    if (tx->broadcast)
+    {
+        mac_free(tx);
+        return;
+    }
+
+    if (!tx->collided && mac_ble_missed(tx))
+    {
+        /* No MAC ack from a receiver on BLE: retried like a collision */
+        stats.ble_rx_lost++;
+        tx->collided = 2;
+    }
+
+    if (tx->collided)
+    {
+        if (tx->collided == 1)
+        {
+            stats.collisions++;
+        }
+        if (++tx->retries > RADIO_MAX_FRAME_RETRIES)
+        {
+            mac_dropped(tx);
+            return;
+        }
+        stats.mac_retries++;
+        tx->collided = 0;
+        mac_start(tx);
+        return;
+    }
+
+    mac_dmm_busy(tx, 0);
+    if (++tx->hop >= tx->hops)
+    {
+        mac_arrived(tx);
+    }
+    else
+    {
+        tx->retries = 0;
+        sched_after(SIM_US(RADIO_HOP_DELAY_US), mac_next_hop, tx, 0);
+    }
+}
+
+static void mac_tx_start(void *ctx, uint32_t arg)
+{
+    mac_tx_t *tx = ctx;
+    sim_time_t now = sched_now();
+    sim_time_t airtime = radio_airtime(tx->len);
+    uint32_t i;
+
+    (void)arg;
+
+    /* Data frame plus turnaround and MAC ack occupy the channel */
+    if (!tx->broadcast)
+    {
+        airtime += SIM_US(RADIO_TURNAROUND_US) + radio_airtime(RADIO_MAC_ACK_LEN);
+    }
+
+    for (i = 0; i < active_count; i++)
+    {
+        active[i]->collided = 1;
+        tx->collided = 1;
+    }
+    if (active_count < RADIO_MAX_ACTIVE)
+    {
+        active[active_count++] = tx;
+    }
+
+    tx->started = now;
+    stats.frames++;
+    stats_busy(now, now + airtime);
+    sched_after(airtime, mac_tx_end, tx, 0);
+}
+
+static void mac_cca(void *ctx, uint32_t arg)
+{
+    mac_tx_t *tx = ctx;
+
+    (void)arg;
+
+    if (active_count == 0)
+    {
+        /* RX->TX turnaround: another node's CCA in this window will collide */
+        sched_after(SIM_US(RADIO_TURNAROUND_US), mac_tx_start, tx, 0);
+        return;
+    }
+
+    tx->nb++;
+    if (tx->be < RADIO_MAX_BE)
+    {
+        tx->be++;
+    }
+    if (tx->nb > RADIO_MAX_CSMA_BACKOFFS)
+    {
+        stats.cca_failures++;
+        if (tx->broadcast)
+        {
+            mac_free(tx);
+        }
+        else
+        {
+            mac_dropped(tx);
+        }
+        return;
+    }
+    mac_backoff(tx);
+}
+
+static void mac_backoff(mac_tx_t *tx)
+{
+    uint32_t slots = sim_rand_range(1U << tx->be);
+    sched_after(SIM_US(slots * RADIO_BACKOFF_US), mac_cca, tx, 0);
+}
+
+static void aps_timeout(void *ctx, uint32_t arg)
+{
+    aps_tx_t *aps = ctx;
+
+    (void)arg;
+
+    if (!aps->finished)
+    {
+        if (aps->tries <= RADIO_APS_MAX_RETRIES)
+        {
+            stats.aps_retries++;
+            aps_attempt(aps);
+        }
+        else
+        {
+            aps_finish(aps, 0);
+        }
+    }
+    aps_release(aps);
+}
+
+static void aps_attempt(aps_tx_t *aps)
+{
+    mac_tx_t *tx = mac_new(aps, (uint8_t)(RADIO_MPDU_OVERHEAD + aps->req.payload), aps->req.hops);
+
+    aps->tries++;
+    if (aps->req.aps_ack)
+    {
+        aps->refs++;
+        sched_after(SIM_MS(RADIO_APS_ACK_WAIT_MS), aps_timeout, aps, 0);
+    }
+    mac_start(tx);
+}
+
+void radio_init(uint32_t relays)
+{
+    active_count = 0;
+    relay_count = relays;
+    bcast_active = 0;
+}
+
+void radio_set_dmm(const radio_dmm_t *hooks)
+{
+    dmm = hooks;
+}
+
+void radio_unicast(const radio_unicast_t *req)
+{
+    aps_tx_t *aps = calloc(1, sizeof(*aps));
+
+    if (aps == NULL)
+    {
+        fprintf(stderr, "sim: out of memory\n");
+        exit(1);
+    }
+    aps->req = *req;
+    /* Held until the first attempt is scheduled */
+    aps->refs = 1;
+    if (req->aps_ack)
+    {
+        stats.aps_sent++;
+    }
+    aps_attempt(aps);
+    aps_release(aps);
+}
+
+static void bcast_expire(void *ctx, uint32_t arg)
+{
+    (void)ctx;
+    (void)arg;
+    bcast_active--;
+}
+
+/* One-hop frame without MAC ack: broadcasts, beacons */
+static void radio_send_unacked(void *ctx, uint32_t arg)
+{
+    mac_tx_t *tx = mac_new(NULL, (uint8_t)arg, 1);
+
+    (void)ctx;
+
+    tx->broadcast = 1;
+    mac_start(tx);
+}
+
+void radio_broadcast(uint8_t payload)
+{
+    uint8_t len = (uint8_t)(RADIO_MPDU_OVERHEAD + payload);
+    uint32_t i;
+
+    if (bcast_active >= RADIO_BTT_SIZE)
+    {
+        stats.bcast_dropped++;
+        return;
+    }
+    bcast_active++;
+    sched_after(SIM_MS(RADIO_BCAST_LIFETIME_MS), bcast_expire, NULL, 0);
+    stats.bcast_originated++;
+
+    radio_send_unacked(NULL, len);
+
+    /* Every router rebroadcasts once after nwkcMaxBroadcastJitter */
+    for (i = 0; i < relay_count; i++)
+    {
+        stats.bcast_relayed++;
+        sched_after(radio_airtime(len) + SIM_US(sim_rand_range(RADIO_BCAST_JITTER_MS * 1000U)),
+                    radio_send_unacked, NULL, len);
+    }
+}
+
+void radio_beacon_scan(void)
+{
+    uint32_t i;
+
+    stats.beacons += 1U + relay_count;
+    radio_send_unacked(NULL, RADIO_BEACON_REQ_LEN);
+    for (i = 0; i < relay_count; i++)
+    {
+        sched_after(radio_airtime(RADIO_BEACON_REQ_LEN) + SIM_US(sim_rand_range(RADIO_SCAN_MS * 1000U)),
+                    radio_send_unacked, NULL, RADIO_BEACON_LEN);
+    }
+}
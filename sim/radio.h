@@ -0,0 +1,77 @@
+#ifndef RADIO_H
+#define RADIO_H
+
+#include "sim.h"
+
+/*
+ * One 2.4 GHz channel shared by every node (a single collision domain,
+ * the worst case for one floor), IEEE 802.15.4 unslotted CSMA-CA with MAC
+ * acks and retries, multi-hop unicast with end-to-end APS acks, and
+ * broadcasts relayed once by every router.
+ */
+
+#define RADIO_COORD             0xFFFFU
+#define RADIO_LIGHT             0xFFFEU     /* The light bound to a sensor */
+#define RADIO_PARENT            0xFFFDU     /* A sensor's parent router */
+
+/* PHY: 250 kbit/s, 32 us per byte, 6 bytes of SHR + PHR */
+#define RADIO_BYTE_US           32U
+#define RADIO_PHY_OVERHEAD      6U
+#define RADIO_TURNAROUND_US     192U
+#define RADIO_BACKOFF_US        320U
+#define RADIO_MAC_ACK_LEN       5U
+#define RADIO_MIN_BE            3U
+#define RADIO_MAX_BE            5U
+#define RADIO_MAX_CSMA_BACKOFFS 4U
+#define RADIO_MAX_FRAME_RETRIES 3U
+#define RADIO_HOP_DELAY_US      2000U       /* Relay processing per hop */
+/* MAC + NWK + NWK security + APS headers around the ZCL/ZDO payload */
+#define RADIO_MPDU_OVERHEAD     45U
+
+/* APS: ZBOSS defaults */
+#define RADIO_APS_ACK_WAIT_MS   1600U
+#define RADIO_APS_MAX_RETRIES   3U
+
+/* NWK broadcast: relay jitter and broadcast transaction table */
+#define RADIO_BCAST_JITTER_MS   64U
+#define RADIO_BTT_SIZE          9U
+#define RADIO_BCAST_LIFETIME_MS 9000U
+
+/* Active scan on this channel: beacon request, one beacon per router */
+#define RADIO_BEACON_REQ_LEN    10U
+#define RADIO_BEACON_LEN        28U
+#define RADIO_SCAN_MS           250U
+
+/* ok = 1 when the payload reached the destination, 0 when the stack gave up */
+typedef void (*radio_done_cb_t)(void *ctx, int ok);
+
+typedef struct {
+    uint16_t src;
+    uint16_t dst;               /* Node index, RADIO_COORD or RADIO_LIGHT */
+    uint8_t hops;
+    uint8_t payload;            /* ZCL/ZDO payload bytes */
+    uint8_t aps_ack;
+    radio_done_cb_t done;       /* May be NULL */
+    void *ctx;
+} radio_unicast_t;
+
+/*
+ * Sensors sharing their radio with BLE (sim --ble, ble.h): zigbee() marks
+ * a sensor's own transmission from its first CSMA backoff to its MAC ack,
+ * ble_overlaps() says whether BLE held the radio of a sensor while a frame
+ * for it was on air.
+ */
+typedef struct {
+    void (*zigbee)(uint16_t node, int busy);
+    int (*ble_overlaps)(uint16_t node, sim_time_t from, sim_time_t to);
+} radio_dmm_t;
+
+/* Routers that relay broadcasts: infrastructure routers, the coordinator,
+ * and the sensors themselves in a router build */
+void radio_init(uint32_t relays);
+void radio_unicast(const radio_unicast_t *req);
+void radio_broadcast(uint8_t payload);
+void radio_beacon_scan(void);
+void radio_set_dmm(const radio_dmm_t *dmm);
+
+#endif /* RADIO_H */
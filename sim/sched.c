@@ -0,0 +1,155 @@
+#include "sim.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    sim_time_t when;
+    uint64_t seq;               /* Tie-break: FIFO at equal times */
+    sim_cb_t cb;
+    void *ctx;
+    uint32_t arg;
+} sched_event_t;
+
+static sched_event_t *heap;
+static size_t heap_len;
+static size_t heap_cap;
+static uint64_t next_seq;
+static sim_time_t now;
+static uint64_t rng_state;
+
+static int sched_before(const sched_event_t *a, const sched_event_t *b)
+{
+    return a->when < b->when || (a->when == b->when && a->seq < b->seq);
+}
+
+static void sched_swap(size_t i, size_t j)
+{
+    sched_event_t tmp = heap[i];
+    heap[i] = heap[j];
+    heap[j] = tmp;
+}
+
+void sched_init(void)
+{
+    free(heap);
+    heap = NULL;
+    heap_len = 0;
+    heap_cap = 0;
+    next_seq = 0;
+    now = 0;
+}
+
+sim_time_t sched_now(void)
+{
+    return now;
+}
+
+void sched_at(sim_time_t when, sim_cb_t cb, void *ctx, uint32_t arg)
+{
+    size_t i;
+
+    if (when < now)
+    {
+        when = now;
+    }
+    if (heap_len == heap_cap)
+    {
+        heap_cap = heap_cap ? heap_cap * 2 : 1024;
+        heap = realloc(heap, heap_cap * sizeof(*heap));
+        if (heap == NULL)
+        {
+            fprintf(stderr, "sim: out of memory\n");
+            exit(1);
+        }
+    }
+
+    i = heap_len++;
+    heap[i].when = when;
+    heap[i].seq = next_seq++;
+    heap[i].cb = cb;
+    heap[i].ctx = ctx;
+    heap[i].arg = arg;
+
+    while (i > 0 && sched_before(&heap[i], &heap[(i - 1) / 2]))
+    {
+        sched_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+void sched_after(sim_time_t delay, sim_cb_t cb, void *ctx, uint32_t arg)
+{
+    sched_at(now + delay, cb, ctx, arg);
+}
+
+static sched_event_t sched_pop(void)
+{
+    sched_event_t top = heap[0];
+    size_t i = 0;
+
+    heap[0] = heap[--heap_len];
+    for (;;)
+    {
+        size_t l = 2 * i + 1;
+        size_t r = l + 1;
+        size_t min = i;
+
+        if (l < heap_len && sched_before(&heap[l], &heap[min]))
+        {
+            min = l;
+        }
+        if (r < heap_len && sched_before(&heap[r], &heap[min]))
+        {
+            min = r;
+        }
+        if (min == i)
+        {
+            break;
+        }
+        sched_swap(i, min);
+        i = min;
+    }
+    return top;
+}
+
+uint64_t sched_run_until(sim_time_t end)
+{
+    uint64_t count = 0;
+
+    while (heap_len > 0 && heap[0].when <= end)
+    {
+        sched_event_t ev = sched_pop();
+        now = ev.when;
+        ev.cb(ev.ctx, ev.arg);
+        count++;
+    }
+    now = end;
+    return count;
+}
+
+void sim_seed(uint32_t seed)
+{
+    rng_state = ((uint64_t)seed << 1) | 1U;
+}
+
+uint32_t sim_rand(void)
+{
+    /* xorshift64* */
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 2685821657736338717ULL) >> 32);
+}
+
+uint32_t sim_rand_range(uint32_t n)
+{
+    return n ? sim_rand() % n : 0;
+}
+
+double sim_rand_exp(double mean)
+{
+    double u = (sim_rand() + 1.0) / 4294967297.0;
+    return -mean * log(u);
+}
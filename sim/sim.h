@@ -0,0 +1,33 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+/* Virtual time in microseconds since the start of the run */
+typedef uint64_t sim_time_t;
+
+#define SIM_US(x)   ((sim_time_t)(x))
+#define SIM_MS(x)   ((sim_time_t)(x) * 1000U)
+#define SIM_S(x)    ((sim_time_t)(x) * 1000000U)
+
+/*
+ * Event queue on a virtual clock, the stand-in for the ZBOSS scheduler
+ * (ZB_SCHEDULE_APP_CALLBACK / ZB_SCHEDULE_APP_ALARM). Events at the same
+ * time run in the order they were scheduled.
+ */
+typedef void (*sim_cb_t)(void *ctx, uint32_t arg);
+
+void sched_init(void);
+sim_time_t sched_now(void);
+void sched_at(sim_time_t when, sim_cb_t cb, void *ctx, uint32_t arg);
+void sched_after(sim_time_t delay, sim_cb_t cb, void *ctx, uint32_t arg);
+/* Runs events up to and including `end`; returns the number run */
+uint64_t sched_run_until(sim_time_t end);
+
+/* Deterministic PRNG so runs are reproducible from --seed */
+void sim_seed(uint32_t seed);
+uint32_t sim_rand(void);
+uint32_t sim_rand_range(uint32_t n);            /* 0 .. n-1 */
+double sim_rand_exp(double mean);               /* Exponential, for Poisson arrivals */
+
+#endif /* SIM_H */
@@ -0,0 +1,209 @@
+#include "stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    sim_time_t *v;
+    size_t len;
+    size_t cap;
+} stats_series_t;
+
+stats_counters_t stats;
+
+static sim_time_t busy_until;
+static sim_time_t busy_total;
+/* Per-second bins for the peak figures */
+static sim_time_t *busy_bins;
+static uint32_t *inbound_bins;
+static uint32_t *rejoin_bins;
+static size_t bin_count;
+static stats_series_t series[STATS_LAT_COUNT];
+
+static const char *const series_names[STATS_LAT_COUNT] = {
+    "report, network",
+    "report, radar edge",
+    "on/off, radar edge",
+    "BLE, radar edge",
+};
+
+void stats_init(sim_time_t duration)
+{
+    stats_free();
+    memset(&stats, 0, sizeof(stats));
+    busy_until = 0;
+    busy_total = 0;
+    bin_count = (size_t)(duration / SIM_S(1)) + 1;
+    busy_bins = calloc(bin_count, sizeof(*busy_bins));
+    inbound_bins = calloc(bin_count, sizeof(*inbound_bins));
+    rejoin_bins = calloc(bin_count, sizeof(*rejoin_bins));
+}
+
+void stats_free(void)
+{
+    size_t i;
+
+    free(busy_bins);
+    free(inbound_bins);
+    free(rejoin_bins);
+    busy_bins = NULL;
+    inbound_bins = NULL;
+    rejoin_bins = NULL;
+    for (i = 0; i < STATS_LAT_COUNT; i++)
+    {
+        free(series[i].v);
+        memset(&series[i], 0, sizeof(series[i]));
+    }
+}
+
+void stats_busy(sim_time_t from, sim_time_t to)
+{
+    if (from < busy_until)
+    {
+        from = busy_until;
+    }
+    if (to <= from)
+    {
+        return;
+    }
+    busy_until = to;
+    busy_total += to - from;
+
+    while (from < to)
+    {
+        size_t bin = (size_t)(from / SIM_S(1));
+        sim_time_t bin_end = (sim_time_t)(bin + 1) * SIM_S(1);
+        sim_time_t end = to < bin_end ? to : bin_end;
+
+        if (bin < bin_count)
+        {
+            busy_bins[bin] += end - from;
+        }
+        from = end;
+    }
+}
+
+void stats_inbound(sim_time_t when)
+{
+    size_t bin = (size_t)(when / SIM_S(1));
+
+    stats.coord_inbound++;
+    if (bin < bin_count)
+    {
+        inbound_bins[bin]++;
+    }
+}
+
+void stats_rejoin(sim_time_t when)
+{
+    size_t bin = (size_t)(when / SIM_S(1));
+
+    stats.rejoin_attempts++;
+    if (bin < bin_count)
+    {
+        rejoin_bins[bin]++;
+    }
+}
+
+uint32_t stats_rejoin_peak(sim_time_t from)
+{
+    uint32_t peak = 0;
+    size_t i;
+
+    for (i = (size_t)(from / SIM_S(1)); i < bin_count; i++)
+    {
+        if (rejoin_bins[i] > peak) peak = rejoin_bins[i];
+    }
+    return peak;
+}
+
+void stats_latency(stats_latency_t s, sim_time_t latency)
+{
+    stats_series_t *ser = &series[s];
+
+    if (ser->len == ser->cap)
+    {
+        ser->cap = ser->cap ? ser->cap * 2 : 256;
+        ser->v = realloc(ser->v, ser->cap * sizeof(*ser->v));
+    }
+    ser->v[ser->len++] = latency;
+}
+
+static int stats_cmp(const void *a, const void *b)
+{
+    sim_time_t x = *(const sim_time_t *)a;
+    sim_time_t y = *(const sim_time_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double stats_pct_ms(const stats_series_t *ser, unsigned pct)
+{
+    size_t idx = (ser->len * pct + 99) / 100;
+    return ser->v[idx ? idx - 1 : 0] / 1000.0;
+}
+
+size_t stats_latency_count(stats_latency_t s)
+{
+    return series[s].len;
+}
+
+void stats_print(FILE *out, sim_time_t duration)
+{
+    sim_time_t peak_busy = 0;
+    uint32_t peak_inbound = 0;
+    double secs = duration / 1e6;
+    size_t i;
+
+    for (i = 0; i < bin_count; i++)
+    {
+        if (busy_bins[i] > peak_busy) peak_busy = busy_bins[i];
+        if (inbound_bins[i] > peak_inbound) peak_inbound = inbound_bins[i];
+    }
+
+    fprintf(out, "channel utilisation   mean %.2f %%, peak 1 s %.1f %%\n",
+            100.0 * busy_total / duration, 100.0 * peak_busy / SIM_S(1));
+    fprintf(out, "MAC                   %llu frames, %llu collisions, %llu retries, %llu CCA failures, %llu hops dropped\n",
+            (unsigned long long)stats.frames, (unsigned long long)stats.collisions,
+            (unsigned long long)stats.mac_retries, (unsigned long long)stats.cca_failures,
+            (unsigned long long)stats.mac_drops);
+    fprintf(out, "APS                   %llu sent, %llu retries, %llu failed\n",
+            (unsigned long long)stats.aps_sent, (unsigned long long)stats.aps_retries,
+            (unsigned long long)stats.aps_failures);
+    fprintf(out, "broadcasts            %llu originated, %llu relayed, %llu dropped (BTT full)\n",
+            (unsigned long long)stats.bcast_originated, (unsigned long long)stats.bcast_relayed,
+            (unsigned long long)stats.bcast_dropped);
+    fprintf(out, "coordinator inbound   mean %.2f frames/s, peak 1 s %u frames\n",
+            stats.coord_inbound / secs, peak_inbound);
+    fprintf(out, "rejoin                %llu attempts (peak 1 s %u), %llu retries, %llu beacon frames, last join at %.1f s\n",
+            (unsigned long long)stats.rejoin_attempts, stats_rejoin_peak(0), (unsigned long long)stats.rejoin_retries,
+            (unsigned long long)stats.beacons, stats.last_join / 1e6);
+    fprintf(out, "application           %llu joins, %llu reports, %llu on/off commands\n",
+            (unsigned long long)stats.joins, (unsigned long long)stats.reports,
+            (unsigned long long)stats.light_cmds);
+
+    if (stats.ble_events != 0)
+    {
+        fprintf(out, "BLE                   %llu adv events, %llu deferred, %llu stopped by Zigbee, %llu Zigbee frames missed\n",
+                (unsigned long long)stats.ble_events, (unsigned long long)stats.ble_deferred,
+                (unsigned long long)stats.ble_preempted, (unsigned long long)stats.ble_rx_lost);
+    }
+
+    for (i = 0; i < STATS_LAT_COUNT; i++)
+    {
+        stats_series_t *ser = &series[i];
+
+        if (ser->len == 0 && i == STATS_LAT_BLE_E2E)
+        {
+            continue;
+        }
+        if (ser->len == 0)
+        {
+            fprintf(out, "latency %-19s no samples\n", series_names[i]);
+            continue;
+        }
+        qsort(ser->v, ser->len, sizeof(*ser->v), stats_cmp);
+        fprintf(out, "latency %-19s p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.1f ms (%zu)\n",
+                series_names[i], stats_pct_ms(ser, 50), stats_pct_ms(ser, 90),
+                stats_pct_ms(ser, 99), ser->v[ser->len - 1] / 1000.0, ser->len);
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include "sim.h"
+
+typedef enum {
+    STATS_LAT_REPORT_NET,       /* Report handed to the stack -> at the coordinator */
+    STATS_LAT_REPORT_E2E,       /* Radar edge -> report at the coordinator */
+    STATS_LAT_LIGHT_E2E,        /* Radar edge -> On/Off at the light */
+    STATS_LAT_BLE_E2E,          /* Radar edge -> first BLE advertisement (--ble) */
+    STATS_LAT_COUNT,
+} stats_latency_t;
+
+typedef struct {
+    uint64_t frames;            /* MAC transmissions, including retries and relays */
+    uint64_t collisions;
+    uint64_t cca_failures;      /* Channel access failures (macMaxCSMABackoffs) */
+    uint64_t mac_retries;
+    uint64_t mac_drops;         /* Hops abandoned after retries or channel access failure */
+    uint64_t aps_sent;
+    uint64_t aps_retries;
+    uint64_t aps_failures;
+    uint64_t bcast_originated;
+    uint64_t bcast_relayed;
+    uint64_t bcast_dropped;     /* Broadcast transaction table full */
+    uint64_t coord_inbound;     /* Frames whose final hop is the coordinator */
+    uint64_t reports;
+    uint64_t light_cmds;
+    uint64_t light_acked;       /* On/Off commands that reached the light */
+    uint64_t joins;
+    uint64_t rejoin_attempts;
+    uint64_t rejoin_retries;
+    uint64_t rejoin_spread[4];  /* Backoff retries by quarter of their jitter range */
+    uint64_t rejoin_outside;    /* Backoff retries outside half..all of the window */
+    uint64_t beacons;           /* Beacon requests and beacons */
+    uint64_t ble_events;        /* BLE advertising events completed */
+    uint64_t ble_deferred;      /* Requests the DMM policy refused */
+    uint64_t ble_preempted;     /* Events stopped by a Zigbee transmission */
+    uint64_t ble_rx_lost;       /* Frames missed while the receiver was on BLE */
+    sim_time_t last_join;
+} stats_counters_t;
+
+extern stats_counters_t stats;
+
+void stats_init(sim_time_t duration);
+void stats_free(void);
+/* Channel busy from `from` to `to`; overlapping intervals are merged */
+void stats_busy(sim_time_t from, sim_time_t to);
+void stats_inbound(sim_time_t when);
+void stats_rejoin(sim_time_t when);
+void stats_latency(stats_latency_t series, sim_time_t latency);
+void stats_print(FILE *out, sim_time_t duration);
+/* For sim --check */
+size_t stats_latency_count(stats_latency_t series);
+/* Most rejoin attempts in one second from `from` on */
+uint32_t stats_rejoin_peak(sim_time_t from);
+
+#endif /* STATS_H */
@@ -0,0 +1,17 @@
+#ifndef TI_DRIVERS_GPIO_H
+#define TI_DRIVERS_GPIO_H
+
+/* Host stand-in: the calls sensor_gpio.c makes, implemented by the test */
+#include <stdint.h>
+
+typedef void (*GPIO_CallbackFxn)(uint_least8_t index);
+
+#define GPIO_CFG_IN_NOPULL          0x01U
+#define GPIO_CFG_IN_INT_BOTH_EDGES  0x02U
+
+void GPIO_setConfig(uint_least8_t index, uint32_t config);
+void GPIO_setCallback(uint_least8_t index, GPIO_CallbackFxn callback);
+void GPIO_enableInt(uint_least8_t index);
+uint_fast8_t GPIO_read(uint_least8_t index);
+
+#endif /* TI_DRIVERS_GPIO_H */
@@ -0,0 +1,39 @@
+#ifndef TI_DRIVERS_UART2_H
+#define TI_DRIVERS_UART2_H
+
+/* Host stand-in: the calls sensor.c makes, implemented by the test */
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct UART2_Config *UART2_Handle;
+
+typedef enum {
+    UART2_Mode_BLOCKING,
+    UART2_Mode_CALLBACK,
+    UART2_Mode_NONBLOCKING
+} UART2_Mode;
+
+typedef enum {
+    UART2_ReadReturnMode_FULL,
+    UART2_ReadReturnMode_PARTIAL
+} UART2_ReadReturnMode;
+
+typedef void (*UART2_Callback)(UART2_Handle handle, void *buf, size_t count, void *userArg, int_fast16_t status);
+
+typedef struct {
+    UART2_Mode readMode;
+    UART2_Mode writeMode;
+    UART2_Callback readCallback;
+    UART2_ReadReturnMode readReturnMode;
+    uint32_t baudRate;
+} UART2_Params;
+
+#define UART2_STATUS_SUCCESS    0
+
+void UART2_Params_init(UART2_Params *params);
+UART2_Handle UART2_open(unsigned int index, UART2_Params *params);
+void UART2_rxEnable(UART2_Handle handle);
+int_fast16_t UART2_read(UART2_Handle handle, void *buffer, size_t size, size_t *bytesRead);
+int_fast16_t UART2_write(UART2_Handle handle, const void *buffer, size_t size, size_t *bytesWritten);
+
+#endif /* TI_DRIVERS_UART2_H */
@@ -0,0 +1,9 @@
+#ifndef TI_DRIVERS_DPL_CLOCKP_H
+#define TI_DRIVERS_DPL_CLOCKP_H
+
+/* Host stand-in: the test advances its virtual clock here */
+#include <stdint.h>
+
+void ClockP_usleep(uint32_t usec);
+
+#endif /* TI_DRIVERS_DPL_CLOCKP_H */
@@ -0,0 +1,8 @@
+#ifndef TI_DRIVERS_CONFIG_H
+#define TI_DRIVERS_CONFIG_H
+
+/* Host stand-in for the SysConfig output */
+#define CONFIG_UART2_0 0
+#define CONFIG_GPIO_SEN_OUT 6
+
+#endif /* TI_DRIVERS_CONFIG_H */
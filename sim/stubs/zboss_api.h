@@ -0,0 +1,15 @@
+#ifndef ZBOSS_API_H
+#define ZBOSS_API_H
+
+/* Host stand-in: only the ZBOSS types the firmware modules under test use */
+#include <stdint.h>
+
+typedef uint8_t zb_bool_t;
+typedef uint8_t zb_uint8_t;
+typedef uint16_t zb_uint16_t;
+typedef uint32_t zb_uint32_t;
+
+#define ZB_FALSE 0U
+#define ZB_TRUE  1U
+
+#endif /* ZBOSS_API_H */
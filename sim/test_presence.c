@@ -0,0 +1,199 @@
+/*
+ * Host test of the presence fast path: firmware/sensor_gpio.c and
+ * firmware/presence.c, with GPIO stubbed (stubs/) and the ZBOSS thread
+ * modelled as it runs on the device. The thread sleeps until its next alarm
+ * or until stack_wake() is called, then runs what my_main_loop() and
+ * presence_update() in on_off_switch.c do: a pin edge schedules the update,
+ * and the update re-arms itself while a change is pending. The sensor poll
+ * alarm every second is the only other wakeup, so an edge that does not wake
+ * the thread waits for it.
+ *
+ * Measures the time from each radar output edge to the filtered change that
+ * starts the occupancy report and the light command.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "presence.h"
+#include "sensor_gpio.h"
+#include "stack_wake.h"
+#include <ti/drivers/GPIO.h>
+#include "ti_drivers_config.h"
+
+#define POLL_MS         1000U   /* sensor_poll_handler */
+#define EDGES           200U
+#define NONE            0xFFFFFFFFU
+
+static uint32_t now_ms;
+
+/* Radar output pin and its interrupt */
+static uint8_t pin;
+static GPIO_CallbackFxn pin_isr;
+
+/* ZBOSS thread */
+static int woken;
+static uint32_t poll_at;
+static uint32_t recheck_at;     /* presence_update alarm, NONE when not armed */
+static presence_t presence;
+static uint32_t changed_at;     /* Last filtered change, NONE before the first */
+
+static int check_failed;
+
+static void check(int ok, const char *what)
+{
+    printf("check %-52s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok)
+    {
+        check_failed = 1;
+    }
+}
+
+void GPIO_setConfig(uint_least8_t index, uint32_t config)
+{
+    (void)index;
+    (void)config;
+}
+
+void GPIO_setCallback(uint_least8_t index, GPIO_CallbackFxn callback)
+{
+    (void)index;
+    pin_isr = callback;
+}
+
+void GPIO_enableInt(uint_least8_t index)
+{
+    (void)index;
+}
+
+uint_fast8_t GPIO_read(uint_least8_t index)
+{
+    (void)index;
+    return pin;
+}
+
+void stack_wake(void)
+{
+    woken = 1;
+}
+
+/* presence_update() in on_off_switch.c, io_polarity 1 */
+static void presence_update(void)
+{
+    uint32_t recheck_ms;
+
+    if (presence_step(&presence, sensor_gpio_level(), now_ms, &recheck_ms))
+    {
+        changed_at = now_ms;
+    }
+    recheck_at = recheck_ms != 0 ? now_ms + recheck_ms : NONE;
+}
+
+/* One pass of my_main_loop(): due alarms, then a pin edge */
+static void zboss_iteration(void)
+{
+    if (now_ms >= poll_at)
+    {
+        poll_at = now_ms + POLL_MS;
+    }
+    if (recheck_at != NONE && now_ms >= recheck_at)
+    {
+        presence_update();
+    }
+    if (sensor_gpio_take_edge())
+    {
+        presence_update();
+    }
+}
+
+/* Runs the thread up to `until`: it only runs when an alarm falls due or it is woken */
+static void zboss_run_until(uint32_t until)
+{
+    while (now_ms < until)
+    {
+        uint32_t next = poll_at;
+
+        if (recheck_at != NONE && recheck_at < next)
+        {
+            next = recheck_at;
+        }
+        if (next > until)
+        {
+            now_ms = until;
+            break;
+        }
+        now_ms = next;
+        zboss_iteration();
+    }
+}
+
+static void radar_edge(void)
+{
+    pin ^= 1U;
+    pin_isr(CONFIG_GPIO_SEN_OUT);
+    if (woken)
+    {
+        woken = 0;
+        zboss_iteration();
+    }
+}
+
+/*
+ * Edges at uneven times, each held for longer than the filter needs, so
+ * every edge should pass it; returns the worst edge-to-change latency
+ */
+static uint32_t run_edges(const presence_filter_config_t *config, uint32_t *missed)
+{
+    uint32_t worst = 0;
+    uint32_t i;
+
+    pin = 0;
+    woken = 0;
+    now_ms = 1000;
+    poll_at = now_ms + POLL_MS;
+    recheck_at = NONE;
+    presence_init(&presence, 0, now_ms);
+    presence_filter_set_config(&presence.filter, config);
+    sensor_gpio_start();
+    *missed = 0;
+
+    for (i = 0; i < EDGES; i++)
+    {
+        uint32_t edge_at = now_ms + 4000U + (i * 7919U) % 3000U;
+
+        zboss_run_until(edge_at);
+        changed_at = NONE;
+        radar_edge();
+        zboss_run_until(edge_at + 3500U);
+        if (changed_at == NONE || presence.filter.output != pin)
+        {
+            (*missed)++;
+        }
+        else if (changed_at - edge_at > worst)
+        {
+            worst = changed_at - edge_at;
+        }
+    }
+    return worst;
+}
+
+int main(void)
+{
+    static const presence_filter_config_t direct = { 0 };
+    static const presence_filter_config_t dwell = { .assert_dwell = 5, .release_dwell = 20 };
+    uint32_t missed;
+    uint32_t worst;
+    char what[64];
+
+    worst = run_edges(&direct, &missed);
+    check(missed == 0, "no filter: every edge changes presence");
+    snprintf(what, sizeof(what), "no filter: edge to change <= 1 ms (worst %u ms)", (unsigned)worst);
+    check(worst <= 1U, what);
+
+    worst = run_edges(&dwell, &missed);
+    check(missed == 0, "dwell: every edge changes presence");
+    snprintf(what, sizeof(what), "dwell: edge to change <= dwell + %u ms (worst %u ms)",
+             (unsigned)PRESENCE_RECHECK_MS, (unsigned)worst);
+    check(worst <= dwell.release_dwell * 100U + PRESENCE_RECHECK_MS, what);
+
+    return check_failed;
+}
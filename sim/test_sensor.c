@@ -0,0 +1,455 @@
+/*
+ * Host test of the radar UART path in firmware/sensor.c. UART2 and ClockP
+ * are stubbed (stubs/): a virtual clock in 1 ms steps, a 32-byte RX ring
+ * filled at 9600 baud, callback reads that complete once the line idles or
+ * the read fills, and a radar that sends a $DFHPD frame on a fixed period
+ * and answers commands with an echo, a Response line for get*, and "Done".
+ * The radar keeps its settings live and saved, as saveConfig leaves them.
+ * The test plays the worker: it sleeps until the read callback wakes it or
+ * SENSOR_WORKER_TICK_MS passes, then routes the input and takes presence
+ * edges as sensor_worker.c does.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "sensor.h"
+#include "sensor_worker.h"
+#include <ti/drivers/UART2.h>
+#include <ti/drivers/dpl/ClockP.h>
+
+#define BYTE_US         1042U   /* 10 bits at 9600 baud */
+#define RX_IDLE_US      3333U   /* Read timeout: 32 bit times without a byte */
+#define RX_RING_LEN     32U     /* UART2 driver ring */
+#define RADAR_OUT_LEN   1024U
+
+/* Radar side */
+static uint64_t now_us;
+static uint64_t wire_free_us;               /* When the byte on the wire completes */
+static char radar_out[RADAR_OUT_LEN];
+static uint32_t out_head;
+static uint32_t out_count;
+static char radar_cmd[64];
+static size_t radar_cmd_len;
+static uint8_t radar_level;
+static uint32_t frame_ms = 100;
+static uint32_t edge_ms;                    /* 0: the level only changes by hand */
+static uint32_t radar_edges;
+static uint32_t radar_frames;
+static uint32_t radar_saves;
+
+/* Radar settings as set* arguments; get* answers with the same, after `prefix` */
+typedef struct {
+    const char *set;
+    const char *get;
+    const char *prefix;
+    char live[24];
+    char saved[24];
+} radar_setting_t;
+
+/* The test's defaults in main() */
+static radar_setting_t radar_settings[] = {
+    { "setRange",       "getRange",       "",   "0.3 6.0",  "0.3 6.0" },
+    { "setTrigRange",   "getTrigRange",   "",   "6.0",      "6.0" },
+    { "setSensitivity", "getSensitivity", "",   "7 7",      "7 7" },
+    { "setLatency",     "getLatency",     "",   "0.0 30.0", "0.0 30.0" },
+    { "setGpioLevel",   "getGpioMode 1",  "1 ", "1",        "1" },
+    { "setMicroMotion", "getMicroMotion", "",   "1",        "1" },
+};
+#define RADAR_SETTINGS  (sizeof(radar_settings) / sizeof(radar_settings[0]))
+
+/* UART2 RX ring and the callback read in progress */
+static char rx_ring[RX_RING_LEN];
+static uint32_t rx_head;
+static uint32_t rx_count;
+static uint32_t overruns;
+static uint64_t rx_last_us;                 /* When the last byte landed */
+static UART2_Callback read_cb;
+static char *read_buf;                      /* NULL: no read in progress */
+static size_t read_size;
+
+/* Worker side */
+static int worker_woken;
+static uint64_t worker_pass_us;
+static uint32_t rx_wakes;
+static uint8_t worker_level;
+static uint32_t worker_edges;
+static uint32_t worker_repeats;             /* Edges that did not change the level */
+
+static int check_failed;
+
+static void check(int ok, const char *what)
+{
+    printf("check %-52s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok)
+    {
+        check_failed = 1;
+    }
+}
+
+static void radar_send(const char *s)
+{
+    if (out_count == 0 && wire_free_us < now_us)
+    {
+        wire_free_us = now_us;
+    }
+    for (; *s != '\0' && out_count < RADAR_OUT_LEN; s++)
+    {
+        radar_out[(out_head + out_count) % RADAR_OUT_LEN] = *s;
+        out_count++;
+    }
+}
+
+static void radar_frame(void)
+{
+    char frame[24];
+
+    snprintf(frame, sizeof(frame), "$DFHPD,%u, , , *\r\n", (unsigned)radar_level);
+    radar_send(frame);
+    radar_frames++;
+}
+
+static void radar_command(const char *cmd)
+{
+    size_t i;
+
+    radar_send(cmd);
+    radar_send("\r\n");
+    for (i = 0; i < RADAR_SETTINGS; i++)
+    {
+        radar_setting_t *setting = &radar_settings[i];
+        size_t len = strlen(setting->set);
+
+        if (strcmp(cmd, setting->get) == 0)
+        {
+            radar_send("Response ");
+            radar_send(setting->prefix);
+            radar_send(setting->live);
+            radar_send("\r\n");
+        }
+        else if (strncmp(cmd, setting->set, len) == 0 && cmd[len] == ' ')
+        {
+            snprintf(setting->live, sizeof(setting->live), "%s", &cmd[len + 1]);
+        }
+    }
+    if (strcmp(cmd, "saveConfig") == 0)
+    {
+        radar_saves++;
+        for (i = 0; i < RADAR_SETTINGS; i++)
+        {
+            memcpy(radar_settings[i].saved, radar_settings[i].live, sizeof(radar_settings[i].saved));
+        }
+    }
+    radar_send("Done\r\n");
+    radar_send("leapMMW:/>");
+}
+
+/* Completes the read in progress with what the ring holds, as the driver's callback does */
+static void rx_complete(void)
+{
+    char *buf = read_buf;
+    size_t n = 0;
+
+    while (n < read_size && rx_count > 0)
+    {
+        buf[n++] = rx_ring[rx_head];
+        rx_head = (rx_head + 1U) % RX_RING_LEN;
+        rx_count--;
+    }
+    read_buf = NULL;
+    read_cb(NULL, buf, n, NULL, UART2_STATUS_SUCCESS);
+}
+
+/* A partial read returns once it is full or the line has been idle for the read timeout */
+static int rx_due(void)
+{
+    return read_buf != NULL && rx_count > 0 && (rx_count >= read_size || now_us - rx_last_us >= RX_IDLE_US);
+}
+
+/* Advances the virtual clock, running the radar and the wire */
+static void advance_us(uint64_t us)
+{
+    uint64_t end = now_us + us;
+
+    while (now_us < end)
+    {
+        now_us += 1000U;
+        if (edge_ms != 0 && now_us % (edge_ms * 1000ULL) == 0)
+        {
+            radar_level ^= 1U;
+            radar_edges++;
+        }
+        if (now_us % (frame_ms * 1000ULL) == 0)
+        {
+            radar_frame();
+        }
+        while (out_count > 0 && wire_free_us + BYTE_US <= now_us)
+        {
+            wire_free_us += BYTE_US;
+            if (rx_count == RX_RING_LEN)
+            {
+                overruns++;
+            }
+            else
+            {
+                rx_ring[(rx_head + rx_count) % RX_RING_LEN] = radar_out[out_head];
+                rx_count++;
+            }
+            rx_last_us = wire_free_us;
+            out_head = (out_head + 1U) % RADAR_OUT_LEN;
+            out_count--;
+        }
+        if (rx_due())
+        {
+            rx_complete();
+        }
+    }
+}
+
+void ClockP_usleep(uint32_t usec)
+{
+    advance_us(usec);
+}
+
+void UART2_Params_init(UART2_Params *params)
+{
+    memset(params, 0, sizeof(*params));
+}
+
+UART2_Handle UART2_open(unsigned int index, UART2_Params *params)
+{
+    static int uart;
+
+    (void)index;
+    if (params->readMode != UART2_Mode_CALLBACK || params->readReturnMode != UART2_ReadReturnMode_PARTIAL)
+    {
+        return NULL;
+    }
+    read_cb = params->readCallback;
+    return (UART2_Handle)&uart;
+}
+
+void UART2_rxEnable(UART2_Handle handle)
+{
+    (void)handle;
+}
+
+int_fast16_t UART2_read(UART2_Handle handle, void *buffer, size_t size, size_t *bytesRead)
+{
+    (void)handle;
+    (void)bytesRead;
+    read_buf = buffer;
+    read_size = size;
+    /* Input already waiting completes the read before it returns */
+    if (rx_due())
+    {
+        rx_complete();
+    }
+    return UART2_STATUS_SUCCESS;
+}
+
+int_fast16_t UART2_write(UART2_Handle handle, const void *buffer, size_t size, size_t *bytesWritten)
+{
+    const char *in = buffer;
+    size_t i;
+
+    (void)handle;
+    for (i = 0; i < size; i++)
+    {
+        if (in[i] == '\n')
+        {
+            radar_cmd[radar_cmd_len] = '\0';
+            radar_command(radar_cmd);
+            radar_cmd_len = 0;
+        }
+        else if (in[i] != '\r' && radar_cmd_len < sizeof(radar_cmd) - 1)
+        {
+            radar_cmd[radar_cmd_len++] = in[i];
+        }
+    }
+    *bytesWritten = size;
+    return UART2_STATUS_SUCCESS;
+}
+
+/* The read callback, in place of sensor_worker.c's task notification */
+static void worker_rx_wake(void)
+{
+    worker_woken = 1;
+    rx_wakes++;
+}
+
+/* One worker pass: route the input, then take every queued edge */
+static void worker_step(int take_edges)
+{
+    uint8_t presence;
+
+    sensor_poll();
+    while (take_edges && sensor_next_presence(&presence))
+    {
+        if (presence == worker_level)
+        {
+            worker_repeats++;
+        }
+        worker_level = presence;
+        worker_edges++;
+    }
+}
+
+/* The worker sleeps until woken or for SENSOR_WORKER_TICK_MS */
+static void run_ms(uint32_t ms, int take_edges)
+{
+    uint32_t t;
+
+    for (t = 0; t < ms; t++)
+    {
+        advance_us(1000U);
+        if (worker_woken || now_us - worker_pass_us >= SENSOR_WORKER_TICK_MS * 1000ULL)
+        {
+            worker_woken = 0;
+            worker_pass_us = now_us;
+            worker_step(take_edges);
+        }
+    }
+}
+
+/* Edges every 700 ms and a config readback every 5 s: nothing may be lost */
+static void test_config_sessions(void)
+{
+    uint32_t dropped = sensor_get_rx_stats()->presence_dropped;
+    uint32_t readbacks = 0;
+    uint32_t readbacks_ok = 0;
+    uint32_t s;
+
+    edge_ms = 700;
+    for (s = 0; s < 600; s += 5)
+    {
+        sensor_presence_config_t config;
+
+        run_ms(5000, 1);
+        config = sensor_refresh_config();
+        readbacks++;
+        if (config.range_min_cm == 30 && config.range_max_cm == 600)
+        {
+            readbacks_ok++;
+        }
+    }
+    edge_ms = 0;
+    run_ms(1000, 1);
+
+    check(worker_edges == radar_edges, "config sessions: every edge delivered");
+    check(sensor_get_rx_stats()->presence_dropped == dropped, "config sessions: no presence frame dropped");
+    check(overruns == 0, "config sessions: no RX ring overrun");
+    check(readbacks_ok == readbacks, "config sessions: every readback answered");
+}
+
+/* The worker stops taking edges; the buffer overflows but must end on the radar's level */
+static void test_stalled_worker(uint32_t edges)
+{
+    const sensor_rx_stats_t *rx = sensor_get_rx_stats();
+    uint32_t dropped = rx->presence_dropped;
+    uint32_t sent = radar_edges;
+    uint32_t taken = worker_edges;
+    uint32_t i;
+    char what[64];
+
+    for (i = 0; i < edges; i++)
+    {
+        radar_level ^= 1U;
+        radar_edges++;
+        radar_frame();
+        run_ms(200, 0);
+    }
+    run_ms(200, 1);
+
+    snprintf(what, sizeof(what), "stalled worker, %u edges: edges dropped", (unsigned)edges);
+    check(rx->presence_dropped > dropped, what);
+    snprintf(what, sizeof(what), "stalled worker, %u edges: delivered + dropped = sent", (unsigned)edges);
+    check((worker_edges - taken) + (rx->presence_dropped - dropped) == radar_edges - sent, what);
+    snprintf(what, sizeof(what), "stalled worker, %u edges: ends on the radar level", (unsigned)edges);
+    check(worker_level == radar_level && worker_repeats == 0, what);
+}
+
+/* Heartbeats only: the worker wakes once per frame, not on a poll period */
+static void test_idle(void)
+{
+    uint32_t frames;
+    uint32_t parsed;
+    uint32_t wakes;
+
+    frame_ms = SENSOR_OUTPUT_HEARTBEAT_MS;
+    run_ms(1000, 1);
+    frames = radar_frames;
+    parsed = sensor_get_rx_stats()->presence_frames;
+    wakes = rx_wakes;
+    /* The extra 100 ms lets the last frame land */
+    run_ms(60100, 1);
+    frames = radar_frames - frames;
+    frame_ms = 100;
+
+    check(frames > 0 && sensor_get_rx_stats()->presence_frames - parsed == frames, "idle: every heartbeat parsed");
+    check(rx_wakes - wakes <= frames, "idle: one worker wake per frame");
+}
+
+/* The radar powers up on its saved settings */
+static void radar_power_cycle(void)
+{
+    size_t i;
+
+    for (i = 0; i < RADAR_SETTINGS; i++)
+    {
+        memcpy(radar_settings[i].live, radar_settings[i].saved, sizeof(radar_settings[i].live));
+    }
+}
+
+/* Only a change from what the radar has saved may cost a flash write */
+static void test_saved_config(const sensor_presence_config_t *defaults)
+{
+    sensor_presence_config_t tuned = *defaults;
+    uint32_t saves = radar_saves;
+
+    check(!sensor_config_unsaved(), "saved config: boot on the saved settings, nothing to save");
+
+    tuned.range_max_cm = 450;
+    tuned.keep_timeout = 120;
+    sensor_configure_delta(defaults, &tuned);
+    check(sensor_config_unsaved(), "saved config: a user change is unsaved");
+    sensor_configure_delta(&tuned, defaults);
+    check(!sensor_config_unsaved(), "saved config: changing it back leaves nothing to save");
+    sensor_apply(SENSOR_CMD_LATENCY, &tuned);
+    check(sensor_config_unsaved(), "saved config: one setting applied is unsaved");
+    check(sensor_save_config() && radar_saves == saves + 1 && !sensor_config_unsaved(),
+          "saved config: one saveConfig persists it");
+    check(!sensor_save_config() && radar_saves == saves + 1, "saved config: nothing left to save");
+
+    /* Rebooted with the tuned settings saved: the defaults pushed at boot differ */
+    radar_power_cycle();
+    sensor_init(defaults);
+    check(sensor_config_unsaved(), "saved config: boot defaults differing from saved are unsaved");
+    sensor_save_config();
+    radar_power_cycle();
+    sensor_init(defaults);
+    check(!sensor_config_unsaved() && radar_saves == saves + 2, "saved config: the next boot saves nothing");
+    run_ms(1000, 1);
+}
+
+int main(void)
+{
+    static const sensor_presence_config_t defaults = {
+        .range_min_cm = 30, .range_max_cm = 600, .trig_range_cm = 600, .keep_timeout = 60,
+        .trig_sensitivity = 7, .keep_sensitivity = 7, .trig_delay = 0, .io_polarity = 1,
+        .fretting = ZB_TRUE,
+    };
+
+    sensor_set_rx_wake(worker_rx_wake);
+    sensor_init(&defaults);
+    run_ms(1000, 1);
+
+    test_saved_config(&defaults);
+
+    test_idle();
+    test_config_sessions();
+    test_stalled_worker(SENSOR_PRESENCE_EDGES + 5);
+    test_stalled_worker(SENSOR_PRESENCE_EDGES + 6);
+    test_stalled_worker(3 * SENSOR_PRESENCE_EDGES);
+
+    return check_failed;
+}